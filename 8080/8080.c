@@ -2,117 +2,602 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 
-int counter;
+#include "8080.h"
+#include "calls.h"
+#include "cover.h"
+#include "debug.h"
+#include "metrics.h"
+#include "profile.h"
+#include "tier.h"
 
-typedef struct ConditionCodes {
-  uint8_t z:1;
-  uint8_t s:1;
-  uint8_t p:1;
-  uint8_t cy:1;
-  uint8_t ac:1;
-  uint8_t pad:3;
-} ConditionCodes;
+static int UnimplementedInstruction(State8080 *state);
 
-typedef struct State8080 {
-  uint8_t a;
-  uint8_t b;
-  uint8_t c;
-  uint8_t d;
-  uint8_t e;
-  uint8_t h;
-  uint8_t l;
-  uint16_t  sp;
-  uint16_t  pc;
-  uint8_t *memory;
-  struct ConditionCodes cc;
-  uint8_t int_enable;
-} State8080;
-
-int Disassemble8080p(unsigned char *buffer, int pc);
-
-void UnimplementedInstruction(State8080 *state);
-void ReadFile(State8080 *state, char *filename);
+int ReadFile(State8080 *state, const char *filename, uint16_t offset)
+{
+  FILE *pfile = fopen(filename, "rb");
+  long fsize = 0;
+  if(pfile == NULL)
+    return EMU_ERR_IO;
+  fseek(pfile, 0L, SEEK_END);
+  fsize = ftell(pfile);
+  fseek(pfile, 0L, SEEK_SET);
 
-int Parity(int x, int size);
+  if(fsize < 0 || fsize > 0x10000 - offset)
+  {
+    fclose(pfile);
+    return EMU_ERR_IO;
+  }
 
-int Emulate8080p(State8080 *state);
+  uint8_t buffer[PAGE_SIZE];
+  int status = EMU_OK;
+  while(status == EMU_OK && fsize > 0)
+  {
+    size_t n = fsize < PAGE_SIZE ? (size_t)fsize : PAGE_SIZE;
+    if(fread(buffer, 1, n, pfile) != n)
+      status = EMU_ERR_IO;
+    else
+      status = WriteBlock8080(state, offset, buffer, n);
+    offset += n;
+    fsize -= n;
+  }
+  fclose(pfile);
+  return status;
+}
 
-State8080 *Init8080(void);
+int LoadCpm8080(State8080 *state, const char *filename, FILE *console)
+{
+  static const uint8_t boot[3] = { 0xc3, 0x00, 0x01 };    // JMP 0100
+  int status = ReadFile(state, filename, 0x100);
+  if(status == EMU_OK)
+    status = WriteBlock8080(state, 0, boot, sizeof(boot));
+  if(status == EMU_OK)
+  {
+    state->cpm = 1;
+    state->console = console;
+  }
+  return status;
+}
 
-int main(int argc, char* argv[])
+State8080 *InitAt8080(void *where, uint8_t *memory)
 {
+  int i;
+  State8080 *state = where;
+  memset(state, 0, sizeof(State8080));
+  state->memory = memory;
+  state->external = 1;
+  for(i = 0; i < PAGES; i++)
+    state->rpage[i] = state->wpage[i] = &state->memory[i * PAGE_SIZE];
+  return state;
+}
 
-  counter = 0;
+State8080 *Init8080(void)
+{
+  State8080 *state = malloc(sizeof(State8080));
+  uint8_t *memory = calloc(1, 0x10000);
+  if(state == NULL || memory == NULL)
+  {
+    free(state);
+    free(memory);
+    return NULL;
+  }
+  InitAt8080(state, memory);
+  state->external = 0;
+  return state;
+}
 
-  State8080 *state = Init8080();
+void Free8080(State8080 *state)
+{
+  int i;
+  if(state == NULL)
+    return;
+  if(running8080 == state)
+    running8080 = NULL;
+  for(i = 0; i < PAGES; i++)
+    if(state->private_page[i >> 3] & (1 << (i & 7)))
+      free(state->rpage[i]);
+  for(i = 0; i < state->nretired; i++)
+    free(state->retired[i]);
+  free(state->retired);
+  if(state->external)
+    return;
+  free(state->memory);
+  free(state);
+}
 
-  ReadFile(state, argv[1]);
-#if TEST
-  state->memory[0] = 0xc3;
-  state->memory[1] = 0;
-  state->memory[2] = 0x01;
+// Forking shares every page between parent and child and clears both
+// write tables, so the first write to a page from either side lands in
+// a private copy and the other side keeps seeing the old contents.
+State8080 *Fork8080(State8080 *parent)
+{
+  int i;
+  State8080 *child = malloc(sizeof(State8080));
+  if(child == NULL)
+    return NULL;
+  *child = *parent;
+  child->memory = NULL;
+  child->external = 0;
+  child->profile = NULL;
+  child->calls = NULL;
+  child->metrics = NULL;
+  child->debug = NULL;
+  child->cover = NULL;
+  child->tier = NULL;
+  child->trace = NULL;
+  if(parent->tier)
+    ForgetWritePages8080(parent->tier);
+  if(parent->debug)
+    ForgetWatchedPages8080(parent->debug);
+  memset(child->private_page, 0, sizeof(child->private_page));
+  child->retired = NULL;
+  child->nretired = child->retired_cap = 0;
+  for(i = 0; i < PAGES; i++)
+    child->wpage[i] = parent->wpage[i] = NULL;
+  return child;
+}
 
-  state->memory[368] = 0x7;
+// A page with a watchpoint doesn't get its write pointer back: the
+// debugger keeps it, so guest writes go on coming to WriteSlow8080.
+static uint8_t *KeepWatched(State8080 *state, int page)
+{
+  uint8_t *p = state->wpage[page];
+  if(state->debug && state->debug->watch[page])
+  {
+    state->debug->saved[page] = p;
+    state->wpage[page] = NULL;
+  }
+  return p;
+}
 
-  state->memory[0x59c] = 0xc3;
-  state->memory[0x59d] = 0xc2;
-  state->memory[0x59e] = 0x05;
-#endif
-#if 0
-  while(pc < fsize) {
-    pc += Disassemble8080p(buffer, pc);
+uint8_t *WritablePage8080(State8080 *state, int page)
+{
+  uint8_t *copy;
+  if(state->wpage[page])
+    return state->wpage[page];
+  // A page with translated code on it: the write throws the code away
+  // and may get the page's own write pointer back.
+  if(state->tier && TierGuarded8080(state->tier, page))
+  {
+    InvalidatePage8080(state, page);
+    if(state->wpage[page])
+      return KeepWatched(state, page);
+  }
+  if(state->debug && state->debug->saved[page])
+    return state->debug->saved[page];
+  copy = malloc(PAGE_SIZE);
+  if(copy == NULL)
+  {
+    state->fault = EMU_ERR_NOMEM;
+    return NULL;
   }
-#endif
-  int done = 0;
-  while(done == 0)
+  memcpy(copy, state->rpage[page], PAGE_SIZE);
+  // A private page that lost its write pointer is being read by a child
+  // forked from us.  It stays allocated until we are freed.
+  if(state->private_page[page >> 3] & (1 << (page & 7)))
   {
-    done = Emulate8080p(state);
-    counter++;
+    if(state->nretired == state->retired_cap)
+    {
+      int cap = state->retired_cap ? 2 * state->retired_cap : 16;
+      uint8_t **r = realloc(state->retired, cap * sizeof(uint8_t *));
+      if(r == NULL)
+      {
+        free(copy);
+        state->fault = EMU_ERR_NOMEM;
+        return NULL;
+      }
+      state->retired = r;
+      state->retired_cap = cap;
+    }
+    state->retired[state->nretired++] = state->rpage[page];
   }
+  state->private_page[page >> 3] |= 1 << (page & 7);
+  state->rpage[page] = state->wpage[page] = copy;
+  return KeepWatched(state, page);
+}
 
-  return 0;
+void WriteSlow8080(State8080 *state, uint16_t addr, uint8_t value)
+{
+  uint8_t *page;
+  if(state->debug)
+    Watched8080(state->debug, addr, value, WATCH_WRITE);
+  page = WritablePage8080(state, addr >> 8);
+  if(page)
+    page[addr & 0xff] = value;
 }
 
-void ReadFile(State8080 *state, char *filename)
+void ReadBlock8080(const State8080 *state, uint16_t addr, void *dst, size_t n)
 {
-  FILE *pfile = fopen(filename, "rb");
-  int fsize = 0;
-  if(pfile == NULL)
+  uint8_t *out = dst;
+  while(n > 0)
   {
-    printf("Error: couldn't open %s\n", filename);
-    exit(1);
+    const uint8_t *src = state->rpage[addr >> 8] + (addr & 0xff);
+    size_t chunk = PAGE_SIZE - (addr & 0xff);
+    // Pages that sit next to each other in host memory go in one copy.
+    while(chunk < n && ((addr + chunk) & 0xffff) != 0 &&
+          state->rpage[(addr + chunk) >> 8] == src + chunk)
+      chunk += PAGE_SIZE;
+    if(chunk > n)
+      chunk = n;
+    memcpy(out, src, chunk);
+    out += chunk;
+    addr += chunk;
+    n -= chunk;
   }
-  fseek(pfile, 0L, SEEK_END);
-  fsize = ftell(pfile);
-  fseek(pfile, 0L, SEEK_SET);
+}
 
-#if TEST
-  uint8_t *buffer = &state->memory[0x100];
-#else
-  uint8_t *buffer = &state->memory[0];
-#endif
-  fread(buffer, fsize, 1, pfile);
-  fclose(pfile);
+int WriteBlock8080(State8080 *state, uint16_t addr, const void *src, size_t n)
+{
+  const uint8_t *in = src;
+  while(n > 0)
+  {
+    uint8_t *page = WritablePage8080(state, addr >> 8);
+    size_t chunk = PAGE_SIZE - (addr & 0xff);
+    if(page == NULL)
+      return EMU_ERR_NOMEM;
+    page += addr & 0xff;
+    while(chunk < n && ((addr + chunk) & 0xffff) != 0 &&
+          state->wpage[(addr + chunk) >> 8] == page + chunk)
+      chunk += PAGE_SIZE;
+    if(chunk > n)
+      chunk = n;
+    memcpy(page, in, chunk);
+    in += chunk;
+    addr += chunk;
+    n -= chunk;
+  }
+  return EMU_OK;
 }
 
-State8080 *Init8080(void)
+const char *StatusString8080(int status)
 {
-  State8080 *state = calloc(1, sizeof(State8080));
-  state->memory = malloc(0x10000);
-  return state;
+  switch(status)
+  {
+    case EMU_OK:            return "ok";
+    case EMU_EXIT:          return "exit";
+    case EMU_UNIMPLEMENTED: return "unimplemented instruction";
+    case EMU_ERR_IO:        return "I/O error";
+    case EMU_ERR_NOMEM:     return "out of memory";
+    case EMU_ERR_FORMAT:    return "bad save state";
+    case EMU_BREAK:         return "breakpoint";
+    case EMU_HALT:          return "halted";
+    default:                return "unknown status";
+  }
+}
+
+// Space Invaders I/O.  Port 3 reads the hardware shift register; OUT 2
+// sets the shift amount and OUT 4 shifts a new byte in.  Everything else
+// is a plain latch the host fills in (inputs) or reads back (sound,
+// watchdog).
+static uint8_t MachineIn(State8080 *state, uint8_t port)
+{
+  Ports8080 *io = &state->io;
+  state->port_in++;
+  if(port == 3)
+    return (io->shift >> (8 - io->shift_offset)) & 0xff;
+  return io->in[port & 7];
 }
 
-void UnimplementedInstruction(State8080 *state)
+static void MachineOut(State8080 *state, uint8_t port, uint8_t value)
 {
-  printf("Error: Unimplemented instruction\n");
+  Ports8080 *io = &state->io;
+  state->port_out++;
+  io->out[port & 7] = value;
+  if(port == 2)
+    io->shift_offset = value & 0x7;
+  else if(port == 4)
+    io->shift = (value << 8) | (io->shift >> 8);
+}
 
+// Leaves pc on the offending opcode so the caller can report it.
+static int UnimplementedInstruction(State8080 *state)
+{
   state->pc--;
-  Disassemble8080p(state->memory, state->pc);
-  printf("\nOPcode: %02x", state->memory[state->pc]);
-  printf("\n");
-  printf("%d\n", counter);
-  exit(1);
+  return EMU_UNIMPLEMENTED;
+}
+
+// Instruction text up to the operand, length, and control flow.  A
+// 2-byte instruction's operand is printed as 2 hex digits, a 3-byte
+// one's as 4.
+const Opcode8080 opcodes8080[256] = {
+  {"NOP", 1, FLOW_NEXT},                // 0x00
+  {"LXI    B,#$", 3, FLOW_NEXT},        // 0x01
+  {"STAX   B", 1, FLOW_NEXT},           // 0x02
+  {"INX    B", 1, FLOW_NEXT},           // 0x03
+  {"INR    B", 1, FLOW_NEXT},           // 0x04
+  {"DCR    B", 1, FLOW_NEXT},           // 0x05
+  {"MVI    B,#$", 2, FLOW_NEXT},        // 0x06
+  {"RLC", 1, FLOW_NEXT},                // 0x07
+  {"NOP", 1, FLOW_NEXT},                // 0x08
+  {"DAD    B", 1, FLOW_NEXT},           // 0x09
+  {"LDAX   B", 1, FLOW_NEXT},           // 0x0a
+  {"DCX    B", 1, FLOW_NEXT},           // 0x0b
+  {"INR    C", 1, FLOW_NEXT},           // 0x0c
+  {"DCR    C", 1, FLOW_NEXT},           // 0x0d
+  {"MVI    C,#$", 2, FLOW_NEXT},        // 0x0e
+  {"RRC", 1, FLOW_NEXT},                // 0x0f
+  {"NOP", 1, FLOW_NEXT},                // 0x10
+  {"LXI    D,#$", 3, FLOW_NEXT},        // 0x11
+  {"STAX   D", 1, FLOW_NEXT},           // 0x12
+  {"INX    D", 1, FLOW_NEXT},           // 0x13
+  {"INR    D", 1, FLOW_NEXT},           // 0x14
+  {"DCR    D", 1, FLOW_NEXT},           // 0x15
+  {"MVI    D,#$", 2, FLOW_NEXT},        // 0x16
+  {"RAL", 1, FLOW_NEXT},                // 0x17
+  {"NOP", 1, FLOW_NEXT},                // 0x18
+  {"DAD    D", 1, FLOW_NEXT},           // 0x19
+  {"LDAX   D", 1, FLOW_NEXT},           // 0x1a
+  {"DCX    D", 1, FLOW_NEXT},           // 0x1b
+  {"INR    E", 1, FLOW_NEXT},           // 0x1c
+  {"DCR    E", 1, FLOW_NEXT},           // 0x1d
+  {"MVI    E,#$", 2, FLOW_NEXT},        // 0x1e
+  {"RAR", 1, FLOW_NEXT},                // 0x1f
+  {"NOP", 1, FLOW_NEXT},                // 0x20
+  {"LXI    H,#$", 3, FLOW_NEXT},        // 0x21
+  {"SHLD   $", 3, FLOW_NEXT},           // 0x22
+  {"INX    H", 1, FLOW_NEXT},           // 0x23
+  {"INR    H", 1, FLOW_NEXT},           // 0x24
+  {"DCR    H", 1, FLOW_NEXT},           // 0x25
+  {"MVI    H,#$", 2, FLOW_NEXT},        // 0x26
+  {"DAA", 1, FLOW_NEXT},                // 0x27
+  {"NOP", 1, FLOW_NEXT},                // 0x28
+  {"DAD    H", 1, FLOW_NEXT},           // 0x29
+  {"LHLD   $", 3, FLOW_NEXT},           // 0x2a
+  {"DCX    H", 1, FLOW_NEXT},           // 0x2b
+  {"INR    L", 1, FLOW_NEXT},           // 0x2c
+  {"DCR    L", 1, FLOW_NEXT},           // 0x2d
+  {"MVI    L,#$", 2, FLOW_NEXT},        // 0x2e
+  {"CMA", 1, FLOW_NEXT},                // 0x2f
+  {"NOP", 1, FLOW_NEXT},                // 0x30
+  {"LXI    SP,#$", 3, FLOW_NEXT},       // 0x31
+  {"STA    $", 3, FLOW_NEXT},           // 0x32
+  {"INX    SP", 1, FLOW_NEXT},          // 0x33
+  {"INR    M", 1, FLOW_NEXT},           // 0x34
+  {"DCR    M", 1, FLOW_NEXT},           // 0x35
+  {"MVI    M,#$", 2, FLOW_NEXT},        // 0x36
+  {"STC", 1, FLOW_NEXT},                // 0x37
+  {"NOP", 1, FLOW_NEXT},                // 0x38
+  {"DAD    SP", 1, FLOW_NEXT},          // 0x39
+  {"LDA    $", 3, FLOW_NEXT},           // 0x3a
+  {"DCX    SP", 1, FLOW_NEXT},          // 0x3b
+  {"INR    A", 1, FLOW_NEXT},           // 0x3c
+  {"DCR    A", 1, FLOW_NEXT},           // 0x3d
+  {"MVI    A,#$", 2, FLOW_NEXT},        // 0x3e
+  {"CMC", 1, FLOW_NEXT},                // 0x3f
+  {"MOV    B,B", 1, FLOW_NEXT},         // 0x40
+  {"MOV    B,C", 1, FLOW_NEXT},         // 0x41
+  {"MOV    B,D", 1, FLOW_NEXT},         // 0x42
+  {"MOV    B,E", 1, FLOW_NEXT},         // 0x43
+  {"MOV    B,H", 1, FLOW_NEXT},         // 0x44
+  {"MOV    B,L", 1, FLOW_NEXT},         // 0x45
+  {"MOV    B,M", 1, FLOW_NEXT},         // 0x46
+  {"MOV    B,A", 1, FLOW_NEXT},         // 0x47
+  {"MOV    C,B", 1, FLOW_NEXT},         // 0x48
+  {"MOV    C,C", 1, FLOW_NEXT},         // 0x49
+  {"MOV    C,D", 1, FLOW_NEXT},         // 0x4a
+  {"MOV    C,E", 1, FLOW_NEXT},         // 0x4b
+  {"MOV    C,H", 1, FLOW_NEXT},         // 0x4c
+  {"MOV    C,L", 1, FLOW_NEXT},         // 0x4d
+  {"MOV    C,M", 1, FLOW_NEXT},         // 0x4e
+  {"MOV    C,A", 1, FLOW_NEXT},         // 0x4f
+  {"MOV    D,B", 1, FLOW_NEXT},         // 0x50
+  {"MOV    D,C", 1, FLOW_NEXT},         // 0x51
+  {"MOV    D,D", 1, FLOW_NEXT},         // 0x52
+  {"MOV    D,E", 1, FLOW_NEXT},         // 0x53
+  {"MOV    D,H", 1, FLOW_NEXT},         // 0x54
+  {"MOV    D,L", 1, FLOW_NEXT},         // 0x55
+  {"MOV    D,M", 1, FLOW_NEXT},         // 0x56
+  {"MOV    D,A", 1, FLOW_NEXT},         // 0x57
+  {"MOV    E,B", 1, FLOW_NEXT},         // 0x58
+  {"MOV    E,C", 1, FLOW_NEXT},         // 0x59
+  {"MOV    E,D", 1, FLOW_NEXT},         // 0x5a
+  {"MOV    E,E", 1, FLOW_NEXT},         // 0x5b
+  {"MOV    E,H", 1, FLOW_NEXT},         // 0x5c
+  {"MOV    E,L", 1, FLOW_NEXT},         // 0x5d
+  {"MOV    E,M", 1, FLOW_NEXT},         // 0x5e
+  {"MOV    E,A", 1, FLOW_NEXT},         // 0x5f
+  {"MOV    H,B", 1, FLOW_NEXT},         // 0x60
+  {"MOV    H,C", 1, FLOW_NEXT},         // 0x61
+  {"MOV    H,D", 1, FLOW_NEXT},         // 0x62
+  {"MOV    H,E", 1, FLOW_NEXT},         // 0x63
+  {"MOV    H,H", 1, FLOW_NEXT},         // 0x64
+  {"MOV    H,L", 1, FLOW_NEXT},         // 0x65
+  {"MOV    H,M", 1, FLOW_NEXT},         // 0x66
+  {"MOV    H,A", 1, FLOW_NEXT},         // 0x67
+  {"MOV    L,B", 1, FLOW_NEXT},         // 0x68
+  {"MOV    L,C", 1, FLOW_NEXT},         // 0x69
+  {"MOV    L,D", 1, FLOW_NEXT},         // 0x6a
+  {"MOV    L,E", 1, FLOW_NEXT},         // 0x6b
+  {"MOV    L,H", 1, FLOW_NEXT},         // 0x6c
+  {"MOV    L,L", 1, FLOW_NEXT},         // 0x6d
+  {"MOV    L,M", 1, FLOW_NEXT},         // 0x6e
+  {"MOV    L,A", 1, FLOW_NEXT},         // 0x6f
+  {"MOV    M,B", 1, FLOW_NEXT},         // 0x70
+  {"MOV    M,C", 1, FLOW_NEXT},         // 0x71
+  {"MOV    M,D", 1, FLOW_NEXT},         // 0x72
+  {"MOV    M,E", 1, FLOW_NEXT},         // 0x73
+  {"MOV    M,H", 1, FLOW_NEXT},         // 0x74
+  {"MOV    M,L", 1, FLOW_NEXT},         // 0x75
+  {"HLT", 1, FLOW_HALT},                // 0x76
+  {"MOV    M,A", 1, FLOW_NEXT},         // 0x77
+  {"MOV    A,B", 1, FLOW_NEXT},         // 0x78
+  {"MOV    A,C", 1, FLOW_NEXT},         // 0x79
+  {"MOV    A,D", 1, FLOW_NEXT},         // 0x7a
+  {"MOV    A,E", 1, FLOW_NEXT},         // 0x7b
+  {"MOV    A,H", 1, FLOW_NEXT},         // 0x7c
+  {"MOV    A,L", 1, FLOW_NEXT},         // 0x7d
+  {"MOV    A,M", 1, FLOW_NEXT},         // 0x7e
+  {"MOV    A,A", 1, FLOW_NEXT},         // 0x7f
+  {"ADD    B", 1, FLOW_NEXT},           // 0x80
+  {"ADD    C", 1, FLOW_NEXT},           // 0x81
+  {"ADD    D", 1, FLOW_NEXT},           // 0x82
+  {"ADD    E", 1, FLOW_NEXT},           // 0x83
+  {"ADD    H", 1, FLOW_NEXT},           // 0x84
+  {"ADD    L", 1, FLOW_NEXT},           // 0x85
+  {"ADD    M", 1, FLOW_NEXT},           // 0x86
+  {"ADD    A", 1, FLOW_NEXT},           // 0x87
+  {"ADC    B", 1, FLOW_NEXT},           // 0x88
+  {"ADC    C", 1, FLOW_NEXT},           // 0x89
+  {"ADC    D", 1, FLOW_NEXT},           // 0x8a
+  {"ADC    E", 1, FLOW_NEXT},           // 0x8b
+  {"ADC    H", 1, FLOW_NEXT},           // 0x8c
+  {"ADC    L", 1, FLOW_NEXT},           // 0x8d
+  {"ADC    M", 1, FLOW_NEXT},           // 0x8e
+  {"ADC    A", 1, FLOW_NEXT},           // 0x8f
+  {"SUB    B", 1, FLOW_NEXT},           // 0x90
+  {"SUB    C", 1, FLOW_NEXT},           // 0x91
+  {"SUB    D", 1, FLOW_NEXT},           // 0x92
+  {"SUB    E", 1, FLOW_NEXT},           // 0x93
+  {"SUB    H", 1, FLOW_NEXT},           // 0x94
+  {"SUB    L", 1, FLOW_NEXT},           // 0x95
+  {"SUB    M", 1, FLOW_NEXT},           // 0x96
+  {"SUB    A", 1, FLOW_NEXT},           // 0x97
+  {"SBB    B", 1, FLOW_NEXT},           // 0x98
+  {"SBB    C", 1, FLOW_NEXT},           // 0x99
+  {"SBB    D", 1, FLOW_NEXT},           // 0x9a
+  {"SBB    E", 1, FLOW_NEXT},           // 0x9b
+  {"SBB    H", 1, FLOW_NEXT},           // 0x9c
+  {"SBB    L", 1, FLOW_NEXT},           // 0x9d
+  {"SBB    M", 1, FLOW_NEXT},           // 0x9e
+  {"SBB    A", 1, FLOW_NEXT},           // 0x9f
+  {"ANA    B", 1, FLOW_NEXT},           // 0xa0
+  {"ANA    C", 1, FLOW_NEXT},           // 0xa1
+  {"ANA    D", 1, FLOW_NEXT},           // 0xa2
+  {"ANA    E", 1, FLOW_NEXT},           // 0xa3
+  {"ANA    H", 1, FLOW_NEXT},           // 0xa4
+  {"ANA    L", 1, FLOW_NEXT},           // 0xa5
+  {"ANA    M", 1, FLOW_NEXT},           // 0xa6
+  {"ANA    A", 1, FLOW_NEXT},           // 0xa7
+  {"XRA    B", 1, FLOW_NEXT},           // 0xa8
+  {"XRA    C", 1, FLOW_NEXT},           // 0xa9
+  {"XRA    D", 1, FLOW_NEXT},           // 0xaa
+  {"XRA    E", 1, FLOW_NEXT},           // 0xab
+  {"XRA    H", 1, FLOW_NEXT},           // 0xac
+  {"XRA    L", 1, FLOW_NEXT},           // 0xad
+  {"XRA    M", 1, FLOW_NEXT},           // 0xae
+  {"XRA    A", 1, FLOW_NEXT},           // 0xaf
+  {"ORA    B", 1, FLOW_NEXT},           // 0xb0
+  {"ORA    C", 1, FLOW_NEXT},           // 0xb1
+  {"ORA    D", 1, FLOW_NEXT},           // 0xb2
+  {"ORA    E", 1, FLOW_NEXT},           // 0xb3
+  {"ORA    H", 1, FLOW_NEXT},           // 0xb4
+  {"ORA    L", 1, FLOW_NEXT},           // 0xb5
+  {"ORA    M", 1, FLOW_NEXT},           // 0xb6
+  {"ORA    A", 1, FLOW_NEXT},           // 0xb7
+  {"CMP    B", 1, FLOW_NEXT},           // 0xb8
+  {"CMP    C", 1, FLOW_NEXT},           // 0xb9
+  {"CMP    D", 1, FLOW_NEXT},           // 0xba
+  {"CMP    E", 1, FLOW_NEXT},           // 0xbb
+  {"CMP    H", 1, FLOW_NEXT},           // 0xbc
+  {"CMP    L", 1, FLOW_NEXT},           // 0xbd
+  {"CMP    M", 1, FLOW_NEXT},           // 0xbe
+  {"CMP    A", 1, FLOW_NEXT},           // 0xbf
+  {"RNZ", 1, FLOW_CRET},                // 0xc0
+  {"POP    B", 1, FLOW_NEXT},           // 0xc1
+  {"JNZ    $", 3, FLOW_BRANCH},         // 0xc2
+  {"JMP    $", 3, FLOW_JUMP},           // 0xc3
+  {"CNZ    $", 3, FLOW_CCALL},          // 0xc4
+  {"PUSH   B", 1, FLOW_NEXT},           // 0xc5
+  {"ADI    #$", 2, FLOW_NEXT},          // 0xc6
+  {"RST    0", 1, FLOW_RST},            // 0xc7
+  {"RZ", 1, FLOW_CRET},                 // 0xc8
+  {"RET", 1, FLOW_RET},                 // 0xc9
+  {"JZ     $", 3, FLOW_BRANCH},         // 0xca
+  {"JMP    $", 3, FLOW_JUMP},           // 0xcb
+  {"CZ     $", 3, FLOW_CCALL},          // 0xcc
+  {"CALL   $", 3, FLOW_CALL},           // 0xcd
+  {"ACI    #$", 2, FLOW_NEXT},          // 0xce
+  {"RST    1", 1, FLOW_RST},            // 0xcf
+  {"RNC", 1, FLOW_CRET},                // 0xd0
+  {"POP    D", 1, FLOW_NEXT},           // 0xd1
+  {"JNC    $", 3, FLOW_BRANCH},         // 0xd2
+  {"OUT    #$", 2, FLOW_NEXT},          // 0xd3
+  {"CNC    $", 3, FLOW_CCALL},          // 0xd4
+  {"PUSH   D", 1, FLOW_NEXT},           // 0xd5
+  {"SUI    #$", 2, FLOW_NEXT},          // 0xd6
+  {"RST    2", 1, FLOW_RST},            // 0xd7
+  {"RC", 1, FLOW_CRET},                 // 0xd8
+  {"RET", 1, FLOW_RET},                 // 0xd9
+  {"JC     $", 3, FLOW_BRANCH},         // 0xda
+  {"IN     #$", 2, FLOW_NEXT},          // 0xdb
+  {"CC     $", 3, FLOW_CCALL},          // 0xdc
+  {"CALL   $", 3, FLOW_CALL},           // 0xdd
+  {"SBI    #$", 2, FLOW_NEXT},          // 0xde
+  {"RST    3", 1, FLOW_RST},            // 0xdf
+  {"RPO", 1, FLOW_CRET},                // 0xe0
+  {"POP    H", 1, FLOW_NEXT},           // 0xe1
+  {"JPO    $", 3, FLOW_BRANCH},         // 0xe2
+  {"XTHL", 1, FLOW_NEXT},               // 0xe3
+  {"CPO    $", 3, FLOW_CCALL},          // 0xe4
+  {"PUSH   H", 1, FLOW_NEXT},           // 0xe5
+  {"ANI    #$", 2, FLOW_NEXT},          // 0xe6
+  {"RST    4", 1, FLOW_RST},            // 0xe7
+  {"RPE", 1, FLOW_CRET},                // 0xe8
+  {"PCHL", 1, FLOW_PCHL},               // 0xe9
+  {"JPE    $", 3, FLOW_BRANCH},         // 0xea
+  {"XCHG", 1, FLOW_NEXT},               // 0xeb
+  {"CPE    $", 3, FLOW_CCALL},          // 0xec
+  {"CALL   $", 3, FLOW_CALL},           // 0xed
+  {"XRI    #$", 2, FLOW_NEXT},          // 0xee
+  {"RST    5", 1, FLOW_RST},            // 0xef
+  {"RP", 1, FLOW_CRET},                 // 0xf0
+  {"POP    PSW", 1, FLOW_NEXT},         // 0xf1
+  {"JP     $", 3, FLOW_BRANCH},         // 0xf2
+  {"DI", 1, FLOW_NEXT},                 // 0xf3
+  {"CP     $", 3, FLOW_CCALL},          // 0xf4
+  {"PUSH   PSW", 1, FLOW_NEXT},         // 0xf5
+  {"ORI    #$", 2, FLOW_NEXT},          // 0xf6
+  {"RST    6", 1, FLOW_RST},            // 0xf7
+  {"RM", 1, FLOW_CRET},                 // 0xf8
+  {"SPHL", 1, FLOW_NEXT},               // 0xf9
+  {"JM     $", 3, FLOW_BRANCH},         // 0xfa
+  {"EI", 1, FLOW_NEXT},                 // 0xfb
+  {"CM     $", 3, FLOW_CCALL},          // 0xfc
+  {"CALL   $", 3, FLOW_CALL},           // 0xfd
+  {"CPI    #$", 2, FLOW_NEXT},          // 0xfe
+  {"RST    7", 1, FLOW_RST},            // 0xff
+};
+
+// Base cycle counts.  Conditional calls and returns are charged the
+// not-taken cost here; the core adds 6 when they are taken.
+const uint8_t cycles8080[256] = {
+  4, 10, 7, 5, 5, 5, 7, 4, 4, 10, 7, 5, 5, 5, 7, 4,            // 0x00..0x0f
+  4, 10, 7, 5, 5, 5, 7, 4, 4, 10, 7, 5, 5, 5, 7, 4,            // 0x10..0x1f
+  4, 10, 16, 5, 5, 5, 7, 4, 4, 10, 16, 5, 5, 5, 7, 4,          // 0x20..0x2f
+  4, 10, 13, 5, 10, 10, 10, 4, 4, 10, 13, 5, 5, 5, 7, 4,       // 0x30..0x3f
+  5, 5, 5, 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 7, 5,              // 0x40..0x4f
+  5, 5, 5, 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 7, 5,              // 0x50..0x5f
+  5, 5, 5, 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 7, 5,              // 0x60..0x6f
+  7, 7, 7, 7, 7, 7, 7, 7, 5, 5, 5, 5, 5, 5, 7, 5,              // 0x70..0x7f
+  4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,              // 0x80..0x8f
+  4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,              // 0x90..0x9f
+  4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,              // 0xa0..0xaf
+  4, 4, 4, 4, 4, 4, 7, 4, 4, 4, 4, 4, 4, 4, 7, 4,              // 0xb0..0xbf
+  5, 10, 10, 10, 11, 11, 7, 11, 5, 10, 10, 10, 11, 17, 7, 11,  // 0xc0..0xcf
+  5, 10, 10, 10, 11, 11, 7, 11, 5, 10, 10, 10, 11, 17, 7, 11,  // 0xd0..0xdf
+  5, 10, 10, 18, 11, 11, 7, 11, 5, 5, 10, 4, 11, 17, 7, 11,    // 0xe0..0xef
+  5, 10, 10, 4, 11, 11, 7, 11, 5, 5, 10, 4, 11, 17, 7, 11,     // 0xf0..0xff
+};
+
+static inline uint8_t ReadMem(const State8080 *state, uint16_t addr)
+{
+  return state->rpage[addr >> 8][addr & 0xff];
+}
+
+static inline void WriteMem(State8080 *state, uint16_t addr, uint8_t value)
+{
+  uint8_t *page = state->wpage[addr >> 8];
+  if(page)
+    page[addr & 0xff] = value;
+  else
+    WriteSlow8080(state, addr, value);
+}
+
+static inline uint8_t ReadWatched(State8080 *state, uint16_t addr)
+{
+  uint8_t value = ReadMem(state, addr);
+  Watched8080(state->debug, addr, value, WATCH_READ);
+  return value;
 }
 
 int Parity(int x, int size)
@@ -128,1922 +613,614 @@ int Parity(int x, int size)
   return ((parity & 0x1) == 0);
 }
 
+#define STEP_NAME     Step8080
+#define STEP_PROFILE  0
+#define STEP_DEBUG    0
+#define STEP_COVER    0
+#include "step.h"
+
+// The plain variant, taking the instruction bytes from a decoded block
+// (tier.h) instead of fetching them.
+#define STEP_NAME     StepDecoded8080
+#define STEP_PROFILE  0
+#define STEP_DEBUG    0
+#define STEP_COVER    0
+#define STEP_DECODED  1
+#include "step.h"
+
+// The same for a CP/M program.
+#define STEP_NAME     StepDecodedCpm8080
+#define STEP_PROFILE  0
+#define STEP_DEBUG    0
+#define STEP_COVER    0
+#define STEP_DECODED  1
+#define STEP_CPM      1
+#include "step.h"
+
+// Variants that run a CP/M program (LoadCpm8080).  Each of the ones
+// below handles state->cpm, and each handles everything the ones after
+// it do, so the first that fits the machine is the one to run.
+#define STEP_NAME     StepCpm8080
+#define STEP_PROFILE  0
+#define STEP_DEBUG    0
+#define STEP_COVER    0
+#define STEP_CPM      1
+#include "step.h"
+
+#define STEP_NAME     StepCover8080
+#define STEP_PROFILE  0
+#define STEP_DEBUG    0
+#define STEP_COVER    1
+#define STEP_CPM      1
+#include "step.h"
+
+#define STEP_NAME     StepProfile8080
+#define STEP_PROFILE  1
+#define STEP_DEBUG    0
+#define STEP_COVER    1
+#define STEP_CPM      1
+#include "step.h"
+
+#define STEP_NAME     StepTrace8080
+#define STEP_PROFILE  1
+#define STEP_DEBUG    0
+#define STEP_COVER    1
+#define STEP_TRACE    1
+#define STEP_CPM      1
+#include "step.h"
+
+#define STEP_NAME     StepDebug8080
+#define STEP_PROFILE  1
+#define STEP_DEBUG    1
+#define STEP_COVER    1
+#define STEP_TRACE    1
+#define STEP_CPM      1
+#include "step.h"
+
+_Thread_local State8080 *volatile running8080;
+
+// The variant a machine runs when no breakpoint is in the way.
+static int StepUndebugged(State8080 *state)
+{
+  if(state->trace)
+    return StepTrace8080(state);
+  if(state->profile || state->calls)
+    return StepProfile8080(state);
+  if(state->cover)
+    return StepCover8080(state);
+  if(state->cpm)
+    return StepCpm8080(state);
+  return Step8080(state);
+}
+
+static int Step(State8080 *state)
+{
+  if(state->halted)
+    return EMU_HALT;
+  if(state->debug)
+  {
+    SyncDebug8080(state);
+    return StepDebug8080(state);
+  }
+  return StepUndebugged(state);
+}
+
 int Emulate8080p(State8080 *state)
 {
-  unsigned char *opcode = &state->memory[state->pc];
+  int status;
+  running8080 = state;
+  status = Step(state);
+  running8080 = NULL;
+  return status;
+}
+
+// Enters the block at pc, if there is one, building its superblock
+// first once it is hot.
+static int EnterBlock(State8080 *state, Tier8080 *tier, uint16_t pc)
+{
+  int b = tier->entry[pc] - 1;
+  if(b >= 0 && tier->block[b].tier == TIER_DECODED && tier->block[b].runs >= tier->config.hot)
+  {
+    int sb = TranslateBlock8080(state, pc, TIER_CHAINED);
+    if(sb >= 0)
+      return sb;
+    tier->block[b].runs = 0;
+  }
+  return b;
+}
+
+// With a debugger attached the tiered core runs only what has no
+// breakpoint on it: a block with code on such a page isn't entered,
+// and the interpreter hands the run back on reaching one.
+static inline int BlockBreaks(const Debug8080 *debug, const TierBlock8080 *blk)
+{
+  int i;
+  for(i = 0; i < blk->npages; i++)
+    if(debug->bp[blk->page[i]])
+      return 1;
+  return 0;
+}
+
+// A watched write made by the instruction at `at` ends the run.
+static inline int Stopped(Debug8080 *debug, uint16_t at, int *status)
+{
+  if(debug == NULL || debug->stop.reason == STOP_NONE)
+    return 0;
+  debug->stop.pc = at;
+  if(*status == EMU_OK || *status == EMU_HALT)
+    *status = EMU_BREAK;
+  return 1;
+}
+
+// The blocks' `covered` counts are good for one bitmap until it is
+// reset.
+static void CoverBlocks(Tier8080 *tier, const Cover8080 *cover)
+{
+  int i;
+  if(tier->cover == cover && tier->cover_resets == cover->resets)
+    return;
+  for(i = 0; i < tier->nblocks; i++)
+    tier->block[i].covered = 0;
+  tier->cover = cover;
+  tier->cover_resets = cover->resets;
+}
 
-  Disassemble8080p(state->memory, state->pc);
+// Where the operand an instruction reads comes from.  The fetch isn't
+// watched, so only loads through a register pair, an address or the
+// stack count, and the BDOS string print under CP/M.
+enum {
+  LOAD_NONE = 0,
+  LOAD_BC,
+  LOAD_DE,
+  LOAD_HL,
+  LOAD_SP,          // two bytes
+  LOAD_ADDR,        // two bytes at the immediate address
+  LOAD_BDOS,        // CALL 5: the string at DE
+};
 
-  state->pc+=1;
+static const uint8_t loads8080[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0,               // 0x00..0x0f
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0,               // 0x10..0x1f
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 0, 0, 0, 0,               // 0x20..0x2f
+  0, 0, 0, 0, 3, 3, 0, 0, 0, 0, 5, 0, 0, 0, 0, 0,               // 0x30..0x3f
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0x40..0x4f
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0x50..0x5f
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0x60..0x6f
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0x70..0x7f
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0x80..0x8f
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0x90..0x9f
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0xa0..0xaf
+  0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 3, 0,               // 0xb0..0xbf
+  4, 4, 0, 0, 0, 0, 0, 0, 4, 4, 0, 0, 0, 6, 0, 0,               // 0xc0..0xcf
+  4, 4, 0, 0, 0, 0, 0, 0, 4, 4, 0, 0, 0, 6, 0, 0,               // 0xd0..0xdf
+  4, 4, 0, 4, 0, 0, 0, 0, 4, 0, 0, 0, 0, 6, 0, 0,               // 0xe0..0xef
+  4, 4, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 6, 0, 0,               // 0xf0..0xff
+};
 
-  switch(*opcode)
+// Whether the instruction `code` about to run reads an operand from a
+// page with a read watchpoint.
+static inline int ReadsWatched(const State8080 *state, const Debug8080 *debug,
+    const uint8_t *code)
+{
+  const uint16_t *reads = debug->read_count;
+  int load = loads8080[code[0]];
+  uint16_t addr;
+  // Most are through HL.
+  if(load == LOAD_NONE)
+    return 0;
+  if(load == LOAD_HL)
+    return reads[state->hl >> 8] != 0;
+  switch(load)
   {
-    case 0x00:  // NOP
-      break;
-    case 0x01: // LXI B
-      {
-        state->c = opcode[1];
-        state->b = opcode[2];
-        state->pc += 2;
-        break;
-      }
-    case 0x02:  // STAX B
-      {
-        uint16_t offset = ((state->b << 8) | state->c);
-        state->memory[offset] = state->a;
-        break;
-      }
-    case 0x03:  // INX B
-      {
-        state->c += 1;
-        if(state->c == 0x00)
-          state->b += 1;
-        break;
-      }
-    case 0x04:  // INR B
-      {
-        state->b += 1;
-        state->cc.p = Parity(state->b, 8);
-        state->cc.z = (state->b == 0);
-        state->cc.s = (state->b & 0x80 != 0);
-        state->cc.cy = (state->b & 0xff);
-        break;
-      }
-    case 0x05: // DCR B
-      {
-        state->b -= 1;
-        if(!state->b)
-          state->cc.z = 1;
-        else
-          state->cc.z = 0;
-        if((state->b & 0x80) == 0x80)
-          state->cc.s = 1;
-        else
-          state->cc.s = 0;
-        state->cc.p = Parity(state->b, 8);
-        break;
-      }
-    case 0x06:  // MVI B
-      {
-        state->b = opcode[1];
-        state->pc += 1;
-        break;
-      }
-    case 0x09:  // DAD B
-      {
-        uint32_t hl = ((state->h << 8) | state->l);
-        uint32_t bc = ((state->b << 8) | state->c);
-        uint32_t res = hl + bc;
-        state->h = (res & 0xff00) >> 8;
-        state->l = (res & 0xff);
-        state->cc.cy = ((res & 0xffff0000) > 0);
-        break;
-      }
-    case 0x0a:  // LDAX B
-      {
-        uint16_t offset = ((opcode[2] << 8) | opcode[1]);
-        state->a = state->memory[offset];
+    case LOAD_BC:
+      return reads[state->bc >> 8] != 0;
+    case LOAD_DE:
+      return reads[state->de >> 8] != 0;
+    case LOAD_SP:
+      return reads[state->sp >> 8] || reads[(uint16_t)(state->sp + 1) >> 8];
+    case LOAD_ADDR:
+      addr = code[1] | (code[2] << 8);
+      return reads[addr >> 8] || reads[(uint16_t)(addr + 1) >> 8];
+    default:
+      return state->cpm && state->c == 9 && code[1] == 5 && code[2] == 0;
+  }
+}
+
+static inline int ReadsWatchedAt(const State8080 *state, const Debug8080 *debug)
+{
+  uint8_t code[3];
+  code[0] = ReadMem(state, state->pc);
+  if(loads8080[code[0]] == LOAD_NONE)
+    return 0;
+  code[1] = ReadMem(state, state->pc + 1);
+  code[2] = ReadMem(state, state->pc + 2);
+  return ReadsWatched(state, debug, code);
+}
+
+// Runs block b and the blocks it leads to until the guest reaches code
+// with no block, a block is invalidated under it, or the run is over.
+// Inlined so that the debug, coverage and CP/M checks fold away when
+// they are constant.
+static inline __attribute__((always_inline))
+int RunBlocks(State8080 *state, Tier8080 *tier, int b, uint64_t end, Debug8080 *debug,
+    Cover8080 *cover, int cpm)
+{
+  for(;;)
+  {
+    TierBlock8080 *blk = &tier->block[b];
+    const TierInsn8080 *in = &tier->insn[blk->first];
+    const TierInsn8080 *stop = in + blk->ninsns;
+    // An address is marked once, the first time the block gets to it;
+    // an edge depends on the path, so it is taken every time.
+    const TierInsn8080 *mark = (cover && blk->covered < blk->ninsns) ? in + blk->covered : stop;
+    int edges = cover && cover->edges;
+    int reads = debug && debug->reads;
+    int status, k;
+
+    if(debug && BlockBreaks(debug, blk))
+      return EMU_OK;
+    tier->stats.block_runs++;
+    blk->runs++;
+    tier->dirty = 0;
+    for(; in < stop; in++)
+    {
+      uint16_t at = state->pc;
+      if(state->cycles >= end)
+        return EMU_OK;
+      if(cover && in >= mark)
+      {
+        CoverPc8080(cover, at);
+        blk->covered++;
+      }
+      // A read of a watched page goes through the debug variant where
+      // it is, so the block keeps running.
+      if(reads && ReadsWatched(state, debug, in->code))
+        status = StepDebug8080(state);
+      else if(cpm)
+        status = StepDecodedCpm8080(state, in->code);
+      else
+        status = StepDecoded8080(state, in->code);
+      if(edges && state->pc != (uint16_t)(at + opcodes8080[in->code[0]].size))
+        CoverEdge8080(cover, state->pc);
+      if(Stopped(debug, at, &status) || status != EMU_OK)
+        return status;
+      if(state->pc != in->next || tier->dirty)
         break;
-      }
-    case 0x0c:  // INR C
+    }
+    if(tier->dirty || state->cycles >= end)
+      return EMU_OK;
+
+    uint16_t pc = state->pc;
+    if(blk->tier == TIER_CHAINED)
+    {
+      for(k = 0; k < 2; k++)
+        if(blk->link[k] >= 0 && blk->link_pc[k] == pc && tier->block[blk->link[k]].tier != TIER_DEAD)
+          break;
+      if(k < 2)
       {
-        state->c += 1;
-        state->cc.p = Parity(state->c, 8);
-        state->cc.z = (state->c == 0);
-        state->cc.s = (state->c & 0x80 != 0);
-        break;
+        tier->stats.linked_runs++;
+        b = blk->link[k];
+        if(tier->block[b].tier == TIER_DECODED && tier->block[b].runs >= tier->config.hot)
+          b = EnterBlock(state, tier, pc);
+        continue;
       }
-    case 0x0d:  // DCR C
+    }
+    int next = EnterBlock(state, tier, pc);
+    if(next < 0)
+      return EMU_OK;
+    // EnterBlock may have moved the blocks, or emptied the cache.
+    blk = &tier->block[b];
+    if(!tier->dirty && blk->tier == TIER_CHAINED)
     {
-      state->c -= 1;
-      state->cc.p = Parity(state->c, 8);
-      state->cc.z = (state->c == 0);
-      state->cc.s = ((state->c & 0x80) != 0);
-      break;
+      k = (blk->link[0] < 0) ? 0 : 1;
+      blk->link[k] = next;
+      blk->link_pc[k] = pc;
     }
-    case 0x0e:  // MVI C
-      {
-        state->c = opcode[1];
-        state->pc += 1;
-        break;
-      }
-    case 0x0f:  // RRC
-      {
-        uint8_t t = state->a;
-        state->a = ((t & 1) << 7) | (t >> 1);
-        state->cc.cy = ((t & 0x1) == 1);
-        break;
-      }
-    case 0x11:  // LXI D
-      {
-        state->d = opcode[2];
-        state->e = opcode[1];
-        state->pc += 2;
-        break;
-      }
-    case 0x13:  // INX  D
-      {
-        state->e += 1;
-        if(state->e == 0x00)
-          state->d += 1;
-        break;
-      }
-    case 0x14:  // INR D
-      {
-        state->d += 1;
-        state->cc.p = Parity(state->d, 8);
-        state->cc.z = (state->d == 0);
-        state->cc.s = ((state->d & 0x80 != 0));
-        break;
-      }
-    case 0x15:  // DCR D
-      {
-        state->d -= 1;
-        state->cc.p = Parity(state->d, 8);
-        state->cc.z = (state->d == 0);
-        state->cc.s = ((state->d & 0x80) != 0);
-        break;
-      }
-    case 0x16:  // MVI D
+    b = next;
+  }
+}
+
+// Interprets until a basic block has been entered `warm` times, then
+// runs it from its decoded form.
+static inline __attribute__((always_inline))
+int RunTiered(State8080 *state, uint64_t end, Debug8080 *debug, Cover8080 *cover, int cpm)
+{
+  Tier8080 *tier = state->tier;
+  int status = EMU_OK;
+  if(cover)
+    CoverBlocks(tier, cover);
+  while(status == EMU_OK && state->cycles < end)
+  {
+    uint16_t pc = state->pc;
+    if(debug && debug->bp[pc >> 8])
+      return EMU_OK;
+    int b = EnterBlock(state, tier, pc);
+    if(b < 0 && !TierCold8080(tier, pc >> 8) && ++tier->heat[pc] >= tier->config.warm)
+      b = TranslateBlock8080(state, pc, TIER_DECODED);
+    if(b >= 0 && debug && BlockBreaks(debug, &tier->block[b]))
+      b = -1;
+    if(b >= 0)
     {
-      state->d = opcode[1];
-      state->pc += 1;
-      break; 
+      status = RunBlocks(state, tier, b, end, debug, cover, cpm);
+      continue;
     }
-    case 0x19:  // DAD D
-      {
-        uint32_t hl = ((state->h << 8) | state->l);
-        uint32_t de = ((state->d << 8) | state->e);
-        uint32_t res = hl + de;
-        state->h = (res & 0xff00) >> 8;
-        state->l = (res & 0xff);
-        state->cc.cy = ((res & 0xffff0000) != 0);
-        break;
-      }
-    case 0x1a:  // LDAX D
-      {
-        uint16_t offset = ((state->d << 8) | state->e);
-        state->a = state->memory[offset];
-        break;
-      }
-    case 0x1b:  // DCX B
-      {
-        state->d -= 1;
-        state->e -= 1;
-        break;
-      }
-    case 0x1c:  // INR E
-      {
-        state->e += 1;
-        state->cc.p = Parity(state->e, 8);
-        state->cc.z = (state->e == 0);
-        state->cc.s = (state->e & 0x80 != 0);
-        break;
-      }
-    case 0x1d:  // DCR E
+    // The rest of the basic block, one instruction at a time.
+    for(;;)
     {
-      state->d -= 1;
-      state->cc.p = Parity(state->e, 8);
-      state->cc.z = (state->e == 0);
-      state->cc.s = ((state->e & 0x80) != 0);
-      break;
+      const Opcode8080 *op = &opcodes8080[ReadMem(state, pc)];
+      if(debug && debug->reads && ReadsWatchedAt(state, debug))
+        status = StepDebug8080(state);
+      else if(cover)
+        status = StepCover8080(state);
+      else if(cpm)
+        status = StepCpm8080(state);
+      else
+        status = Step8080(state);
+      if(Stopped(debug, pc, &status))
+        return status;
+      if(status != EMU_OK || state->cycles >= end || op->flow != FLOW_NEXT ||
+          state->pc != (uint16_t)(pc + op->size))
+        break;
+      pc = state->pc;
+      if(debug && debug->bp[pc >> 8])
+        return EMU_OK;
     }
-    case 0x1e:  // MVI E
+  }
+  return status;
+}
+
+// The debug variant of the core runs only the instructions on a page
+// with a breakpoint, and those that read a page with a read watchpoint.
+// The rest run on the machine's usual core, tiered blocks included, and
+// a watched write shows up in debug->stop from WriteSlow8080.
+static int RunDebug(State8080 *state, uint64_t end)
+{
+  Debug8080 *debug = state->debug;
+  int plain = !state->trace && !state->profile && !state->calls && !state->cover && !state->cpm;
+  int status = EMU_OK;
+  SyncDebug8080(state);
+  debug->stop.reason = STOP_NONE;
+  while(status == EMU_OK && state->cycles < end)
+  {
+    uint16_t at = state->pc;
+    if(debug->bp[at >> 8] || debug->reads && ReadsWatchedAt(state, debug))
     {
-      state->e = opcode[1];
-      state->pc += 1;
-      break;
+      status = StepDebug8080(state);
+      continue;
     }
-    case 0x21:  // LXI H
-      {
-        state->h = opcode[2];
-        state->l = opcode[1];
-        state->pc += 2;
-        break;
-      }
-    case 0x23:  // INX H
-      {
-        state->l += 1;
-        if(state->l == 0x00)
-          state->h += 1;
-        break;
-      }
-    case 0x24:  // INR H
-      {
-        state->h += 1;
-        state->cc.p = Parity(state->h, 8);
-        state->cc.z = (state->h == 0);
-        state->cc.s = ((state->h & 0x80) != 0);
-      }
-    case 0x25:  // DCR H
-      {
-        state->h -= 1;
-        state->cc.p = Parity(state->h, 8);
-        state->cc.z = (state->h == 0);
-        state->cc.s = ((state->h & 0x80) != 0);
-      }
-    case 0x26:  // MVI H
-      {
-        state->h = opcode[1];
-        state->pc += 1;
-        break;
-      }
-    case 0x29:  // DAD H
-      {
-        uint32_t hl = ((state->h << 8) | state->l);
-        hl <<= 1;
-        state->h = (hl & 0xff00) >> 8;
-        state->l = (hl & 0xff);
-        state->cc.cy = ((hl & 0xffff0000) != 0);
-        break;
-      }
-    case 0x2c:  // INR L
+    // Off the breakpoint's page, the next visit to it fires again.
+    debug->resume = 0;
+    if(plain && state->tier)
+      status = RunTiered(state, end, debug, NULL, 0);
+    else if(plain)
+      do
+      {
+        at = state->pc;
+        status = Step8080(state);
+      }
+      while(!Stopped(debug, at, &status) && status == EMU_OK && state->cycles < end &&
+          !debug->bp[state->pc >> 8] &&
+          !(debug->reads && ReadsWatchedAt(state, debug)));
+    else
+      do
+      {
+        at = state->pc;
+        status = StepUndebugged(state);
+      }
+      while(!Stopped(debug, at, &status) && status == EMU_OK && state->cycles < end &&
+          !debug->bp[state->pc >> 8] &&
+          !(debug->reads && ReadsWatchedAt(state, debug)));
+  }
+  return status;
+}
+
+static int RunUntil(State8080 *state, uint64_t end)
+{
+  int status = EMU_OK;
+  running8080 = state;
+  if(state->halted)
+    ;
+  else if(state->debug)
+    status = RunDebug(state, end);
+  else if(state->trace)
+    while(status == EMU_OK && state->cycles < end)
+      status = StepTrace8080(state);
+  else if(state->profile || state->calls)
+    while(status == EMU_OK && state->cycles < end)
+      status = StepProfile8080(state);
+  else if(state->tier && state->cpm)
+    status = RunTiered(state, end, NULL, state->cover, 1);
+  else if(state->tier && state->cover)
+    status = RunTiered(state, end, NULL, state->cover, 0);
+  else if(state->cover)
+    while(status == EMU_OK && state->cycles < end)
+      status = StepCover8080(state);
+  else if(state->cpm)
+    while(status == EMU_OK && state->cycles < end)
+      status = StepCpm8080(state);
+  else if(state->tier)
+    status = RunTiered(state, end, NULL, NULL, 0);
+  else
+    while(status == EMU_OK && state->cycles < end)
+      status = Step8080(state);
+  running8080 = NULL;
+  // Nothing happens until the next interrupt, which is at the end of
+  // this run at the earliest.
+  if(status == EMU_HALT || state->halted)
+  {
+    if(state->cycles < end)
+      state->cycles = end;
+    status = EMU_OK;
+  }
+  if(state->calls)
+    Charge8080(state->calls, state->cycles);
+  if(status == EMU_OK && state->fault)
+    status = state->fault;
+  return status;
+}
+
+int Interrupt8080(State8080 *state, int n)
+{
+  if(!state->int_enable)
+    return 0;
+  WriteMem(state, state->sp - 1, (state->pc >> 8) & 0xff);
+  WriteMem(state, state->sp - 2, state->pc & 0xff);
+  state->sp -= 2;
+  state->pc = (n & 7) * 8;
+  state->int_enable = 0;
+  state->halted = 0;
+  state->cycles += cycles8080[0xc7];
+  state->interrupts++;
+  if(state->calls)
+    EnterCall8080(state->calls, state->pc, state->sp, state->cycles);
+  if(state->cover && state->cover->edges)
+    CoverEdge8080(state->cover, state->pc);
+  return 1;
+}
+
+static uint64_t Nanoseconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int Run8080(State8080 *state, int cycles)
+{
+  uint64_t start;
+  int status;
+  if(state->metrics == NULL)
+    return RunUntil(state, state->cycles + cycles);
+  start = Nanoseconds();
+  status = RunUntil(state, state->cycles + cycles);
+  PublishMetrics8080(state->metrics, state, Nanoseconds() - start, 0);
+  return status;
+}
+
+int RunFrame8080(State8080 *state)
+{
+  uint64_t start = state->metrics ? Nanoseconds() : 0;
+  uint64_t begin = state->cycles;
+  int status = RunUntil(state, begin + FRAME_CYCLES / 2);
+  if(status == EMU_OK)
+  {
+    Interrupt8080(state, 1);
+    status = RunUntil(state, begin + FRAME_CYCLES);
+  }
+  if(status == EMU_OK)
+  {
+    Interrupt8080(state, 2);
+    state->frames++;
+  }
+  if(state->metrics)
+    PublishMetrics8080(state->metrics, state, Nanoseconds() - start, status == EMU_OK);
+  return status;
+}
+
+static const char hexdigit[16] = "0123456789abcdef";
+
+static char *Hex(char *p, unsigned value, int digits)
+{
+  while(digits-- > 0)
+    *p++ = hexdigit[(value >> (4 * digits)) & 0xf];
+  return p;
+}
+
+// Copies n bytes of text to out as far as it fits, always terminating.
+static void Put(char *out, size_t size, size_t at, const char *text, size_t n)
+{
+  if(at >= size)
+    return;
+  if(n > size - at - 1)
+    n = size - at - 1;
+  memcpy(out + at, text, n);
+  out[at + n] = '\0';
+}
+
+// Longest text is "LXI    SP,#$xxxx".
+#define TEXT_MAX 20
+
+static int Text(char *text, const uint8_t *code)
+{
+  const Opcode8080 *op = &opcodes8080[code[0]];
+  const char *s = op->text;
+  char *p = text;
+  while(*s)
+    *p++ = *s++;
+  if(op->size == 3)
+    p = Hex(p, code[1] | (code[2] << 8), 4);
+  else if(op->size == 2)
+    p = Hex(p, code[1], 2);
+  *p = '\0';
+  return p - text;
+}
+
+int Disassemble8080s(char *out, size_t size, const uint8_t *code)
+{
+  char text[TEXT_MAX];
+  int n = Text(text, code);
+  if(size > 0)
+  {
+    out[0] = '\0';
+    Put(out, size, 0, text, n);
+  }
+  return opcodes8080[code[0]].size;
+}
+
+size_t DisassembleRange8080(const uint8_t *mem, int start, int end, char *out, size_t size)
+{
+  size_t at = 0;
+  int pc = start;
+  if(size > 0)
+    out[0] = '\0';
+  while(pc < end)
+  {
+    // "aaaa  bb bb bb  text\n"
+    char line[6 + 10 + TEXT_MAX + 1];
+    char *p = line;
+    int len = opcodes8080[mem[pc]].size;
+    int i;
+    if(pc + len > end)
+      len = 1;
+    p = Hex(p, pc, 4);
+    *p++ = ' ';
+    *p++ = ' ';
+    for(i = 0; i < 3; i++)
+    {
+      if(i < len)
+        p = Hex(p, mem[pc + i], 2);
+      else
       {
-        state->l += 1;
-        state->cc.p = Parity(state->l, 8);
-        state->cc.s = ((state->l & 0x80) != 0);
-        state->cc.z = (state->l == 0);
+        *p++ = ' ';
+        *p++ = ' ';
       }
-    case 0x2d:  // DCR L
-    {
-      state->l -= 1;
-      state->cc.p = Parity(state->l, 8);
-      state->cc.s = ((state->l & 0x80) != 0);
-      state->cc.z = (state->l == 0);
-      break;
+      *p++ = ' ';
     }
-    case 0x2e:  // MVI L
+    *p++ = ' ';
+    if(len == opcodes8080[mem[pc]].size)
+      p += Text(p, &mem[pc]);
+    else
     {
-      state->l = opcode[1];
-      state->pc += 1;
-      break;
+      memcpy(p, "DB     #$", 9);
+      p = Hex(p + 9, mem[pc], 2);
     }
-    case 0x31:  // LXI SP
-      {
-        state->sp = (opcode[2] << 8 | opcode[1]);
-        state->pc += 2;
-        break;
-      }
-    case 0x36:  // MVI M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        state->memory[offset] = opcode[1];
-        state->pc += 1;
-        break;
-      }
-    case 0x32:  // STA
-      {
-        uint16_t offset = ((opcode[2] << 8) | opcode[1]);
-        state->memory[offset] = state->a;
-        state->pc += 2;
-        break;
-      }
-    case 0x3a:  // LDA
-      {
-        uint16_t offset = ((opcode[2] << 8) | opcode[1]);
-        state->a = state->memory[offset];
-        state->pc += 2;
-        break;
-      }
-    case 0x3c:  // INR A
-      {
-        state->a += 1;
-        state->cc.z = (state->a == 0);
-        state->cc.p = Parity(state->a, 8);
-        state->cc.s = ((state->a & 0x80) != 0);
-        break;
-      }
-    case 0x3d:  // DCR A
-      {
-        state->a -= 1;
-        state->cc.z = (state->a == 0);
-        state->cc.p = Parity(state->a, 8);
-        state->cc.s = ((state->a & 0x80) != 0);
-        break;
-      }
-    case 0x3e:  // MVI A
-      {
-        state->a = opcode[1];
-        state->pc += 1;
-        break;
-      }
-    case 0x40:  // MOV B,B
-    {
-      state->b = state->b;
-      break;
-    }
-    case 0x41:  // MOV B,C
-    {
-      state->b = state->c;
-      break;
-    }
-    case 0x42:  // MOV B,D
-      {
-        state->b = state->d;
-        break;
-      }
-    case 0x43:  // MOV B,E
-      {
-        state->b = state->e;
-        break;
-      }
-    case 0x44:  // MOV B,H
-      {
-        state->b = state->h;
-        break;
-      }
-    case 0x45:  // MOV B,L
-      {
-        state->b = state->l;
-        break;
-      }
-    case 0x46:  // MOV B,M
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->b = state->memory[offset];
-      break;
-    }
-    case 0x47:  // MOV B,A
-      {
-        state->b = state->a;
-        break;
-      }
-    case 0x48:  // MOV C,B
-      {
-        state->c = state->b;
-        break;
-      }
-    case 0x49:  // MOV C,C
-    {
-      state->c = state->c;
-      break;
-    }
-    case 0x4a:  // MOV C,D
-    {
-      state->c = state->d;
-      break;
-    }
-    case 0x4b:  // MOV C,E
-      {
-        state->c = state->e;
-        break;
-      }
-    case 0x4c:  // MOV C,H
-    {
-      state->c = state->h;
-      break;
-    }
-    case 0x4d:  // MOV C,L
-      {
-        state->c = state->l;
-        break;
-      }
-    case 0x4f:  // MOV C,A
-      {
-        state->c = state->a;
-        break;
-      }
-    case 0x50:  // MOV D,B
-      {
-        state->d = state->b;
-        break;
-      }
-    case 0x51:  // MOV D,C
-      {
-        state->d = state->c;
-        break;
-      }
-    case 0x52:  // MOV D,D
-    {
-      state->d = state->d;
-      break;
-    }
-    case 0x53:  // MOV D,E
-    {
-      state->d = state->e;
-      break;
-    }
-    case 0x54:  // MOV D,H
-    {
-      state->d = state->h;
-      break;
-    }
-    case 0x55:  // MOV D,L
-      {
-        state->d = state->l;
-        break;
-      }
-    case 0x56:  // MOV D,M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        state->d = state->memory[offset];
-        break;
-      }
-    case 0x57:  // MOV D,A
-      {
-        state->d = state->a;
-        break;
-      }
-    case 0x58:  // MOV E,B
-      {
-        state->e = state->b;
-        break;
-      }
-    case 0x59:  // MOV E,C
-      {
-        state->e = state->c;
-        break;
-      }
-    case 0x5a:  // MOV E,D
-      {
-        state->e = state->d;
-        break;
-      }
-    case 0x5b:  // MOV E,E
-    {
-      state->e = state->e;
-      break;
-    }
-    case 0x5c:  // MOV E,H
-    {
-      state->e = state->h;
-      break;
-    }
-    case 0x5d:  // MOV E,L
-    {
-      state->e = state->l;
-      break;
-    }
-    case 0x5e:  // MOV E,M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        state->e = state->memory[offset];
-        break;
-      }
-    case 0x5f:  // MOV E,A
-      {
-        state->e = state->a;
-        break;
-      }
-    case 0x60:  // MOV H,B
-      {
-        state->h = state->b;
-        break;
-      }
-    case 0x61:  // MOV H,C
-      {
-        state->h = state->c;
-        break;
-      }
-    case 0x62:  // MOV H,D
-      {
-        state->h = state->d;
-        break;
-      }
-    case 0x63:  // MOV H,E
-      {
-        state->h = state->e;
-        break;
-      }
-    case 0x64:  // MOV H,H
-    {
-      state->h = state->h;
-      break;
-    }
-    case 0x65:  // MOV H,L
-    {
-      state->h = state->l;
-      break;
-    }
-    case 0x66:  // MOV H,M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        state->h = state->memory[offset];
-        break;
-      }
-    case 0x67:  // MOV H,A
-      {
-        state->h = state->a;
-        break;
-      }
-    case 0x68:  // MOV L,B
-      {
-        state->l = state->b;
-        break;
-      }
-    case 0x69:  // MOV L,C
-      {
-        state->l = state->c;
-        break;
-      }
-    case 0x6a:  // MOV L,D
-      {
-        state->l = state->d;
-        break;
-      }
-    case 0x6b:  // MOV L,E
-      {
-        state->l = state->e;
-        break;
-      }
-    case 0x6c:  // MOV L,H
-      {
-        state->l = state->h;
-        break;
-      }
-    case 0x6d:  // MOV L,L
-    {
-      state->l = state->l;
-      break;
-    }
-    case 0x6e:  // MOV L,M
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->l = state->memory[offset];
-      break;
-    }
-    case 0x6f:  // MOV L,A
-      {
-        state->l = state->a;
-        break;
-      }
-    case 0x70:  // MOV M,B
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->memory[offset] = state->b;
-      break;
-    }
-    case 0x72:  // MOV M,D
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->memory[offset] = state->d;
-      break;
-    }
-    case 0x73:  // MOV M,E
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->memory[offset] = state->e;
-      break;
-    }
-    case 0x74:  // MOV M,H
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->memory[offset] = state->h;
-      break;
-    }
-    case 0x75:  // MOV M,L
-    {
-      uint16_t offset = ((state->h << 8) | state->l);
-      state->memory[offset] = state->l;
-      break;
-    }
-    case 0x77:  // MOV M,A
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        state->memory[offset] = state->a;
-        break;
-      }
-    case 0x78:  // MOV A,B
-    {
-      state->a = state->b;
-      break;
-    }
-    case 0x79:  // MOV A,C
-      {
-        state->a = state->c;
-        break;
-      }
-    case 0x7a:  // MOV A,D
-      {
-        state->a = state->d;
-        break;
-      }
-    case 0x7b:  // MOV A,E
-      {
-        state->a = state->b;
-        break;
-      }
-    case 0x7c:  // MOV A,H
-      {
-        state->a = state->h;
-        break;
-      }
-    case 0x7d:  // MOV A,L
-      {
-        state->a = state->l;
-        break;
-      }
-    case 0x7e:  // MOV A,M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        state->a = state->memory[offset];
-        break;
-      }
-    case 0x7f:  // MOV A,A
-    {
-      state->a = state->a;
-      break;
-    }
-    case 0x80:  // ADD B
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->b;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x81:  // ADD C
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->c;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x82:  // ADD D
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->d;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x83:  // ADD E
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->e;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x84:  // ADD H
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->h;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x85:  // ADD L
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->l;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x86:  // ADD M (HL)
-      {
-        uint16_t offset = (state->h<<8) | (state->l);
-        uint16_t result = (uint16_t)state->a + state->memory[offset];
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x87:  // ADD A
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)state->a;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.cy = (result > 0xff);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0x88:  // ADC B
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->b + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x89:  // ADC C
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->c + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x8a:  // ADC D
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->d + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x8b:  // ADC E
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->e + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x8c:  // ADC H
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->h + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x8d:  // ADC L
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->l + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x8f:  // ADC A
-    {
-      uint16_t result = (uint16_t)state->a + (uint16_t)state->a + state->cc.cy;
-      state->a = result & 0xff;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(state->a, 8);
-      break;
-    }
-    case 0x90:  // SUB B
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->b;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x91:  // SUB C
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->c;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x92:  // SUB D
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->d;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x93:  // SUB E
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->e;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x94:  // SUB H
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->h;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x95:  // SUB L
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->l;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x97:  // SUB A
-    {
-      uint16_t result = (uint16_t)state->a - (uint16_t)state->a;
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x98:  // SSB B
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->b + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x99:  // SSB C
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->c + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x9a:  // SSB D
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->d + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x9b:  // SSB E
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->e + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x9c:  // SSB H
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->h + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x9d:  // SSB L
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->l + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0x9f:  // SSB A
-    {
-      uint16_t result = (uint16_t)state->a - ((uint16_t)state->a + state->cc.cy);
-      state->a = (uint8_t)result;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.p = Parity(state->a, 8);
-      state->cc.cy = ((result & 0x100) != 0);
-      break;
-    }
-    case 0xa1:  // ANA C
-      {
-        state->a &= state->c;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa2:  // ANA D
-      {
-        state->a &= state->d;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa3:  // ANA E
-      {
-        state->a &= state->e;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa4:  // ANA H
-      {
-        state->a &= state->h;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa5:  // ANA L
-      {
-        state->a &= state->l;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa7:  // ANA A
-      {
-        state->a &= state->a;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa8:  // XRA B
-      {
-        state->a ^= state->b;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xa9:  // XRA C
-      {
-        state->a ^= state->c;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xaa:  // XRA D
-      {
-        state->a ^= state->d;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xab:  // XRA E
-      {
-        state->a ^= state->e;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xac:  // XRA H
-      {
-        state->a ^= state->h;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xad:  // XRA L
-      {
-        state->a ^= state->l;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xaf:  // XRA A
-      {
-        state->a ^= state->a;
-        state->cc.z = 1;
-        state->cc.s = 0;
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb0:  // ORA B
-      {
-        state->a |= state->b;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb1:  // ORA C
-      {
-        state->a |= state->c;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb2:  // ORA D
-      {
-        state->a |= state->d;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb3:  // ORA E
-      {
-        state->a |= state->e;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb4:  // ORA H
-      {
-        state->a |= state->h;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb5:  // ORA L
-      {
-        state->a |= state->l;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb6:  // ORA M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        uint16_t result = state->a | state->memory[offset];
-        state->cc.cy = 0;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.p = Parity(result, 8);
-        state->a = result & 0xff;
-        break;
-      }
-    case 0xb7:  // ORA A
-      {
-        state->a |= state->a;
-        state->cc.cy = 0;
-        state->cc.z = ((state->a & 0xff) == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        break;
-      }
-    case 0xb8:  // CMP B
-    {
-      uint16_t result = state->a - state->b;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(result, 8);
-      break; 
-    }
-    case 0xba:  // CMP D
-    {
-      uint16_t result = state->a - state->d;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(result, 8);
-      break; 
-    }
-    case 0xbb:  // CMP e
-    {
-      uint16_t result = state->a - state->e;
-      state->cc.z = ((result & 0xff) == 0);
-      state->cc.s = ((result & 0x80) != 0);
-      state->cc.cy = ((result & 0x100) != 0);
-      state->cc.p = Parity(result, 8);
-      break; 
-    }
-    case 0xbc:  // CMP H
-      {
-        uint16_t result = state->a - state->h;
-        state->cc.z = (result == 0);
-        state->cc.s = ((result & 0xff00) != 0);
-        state->cc.p = Parity(result, 8);
-        state->cc.cy = ((result & 0x100) != 1);
-        break;
-      }
-    case 0xbd:  // CMP L
-      {
-        uint16_t result = state->a - state->l;
-        state->cc.z = (result == 0);
-        state->cc.s = ((result & 0xff00) != 0);
-        state->cc.p = Parity(result, 8);
-        state->cc.cy = ((result & 0x100) != 1);
-        break;
-      }
-    case 0xbe:  // CMP M
-      {
-        uint16_t offset = ((state->h << 8) | state->l);
-        uint16_t result = state->a - state->memory[offset];
-        state->cc.z = (result == 0);
-        state->cc.s = ((result & 0xff00) != 0);
-        state->cc.p = Parity(result, 8);
-        state->cc.cy = ((result & 0x100) != 1);
-        break;
-      }
-    case 0xc0:  // RNZ
-      {
-        if(!state->cc.z) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xc1:  // POP B
-      {
-        state->c = state->memory[state->sp];
-        state->b = state->memory[state->sp+1];
-        state->sp += 2;
-        break;
-      }
-    case 0xc2:  // JNZ
-      {
-        if(state->cc.z == 0)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xc3:  // JMP
-      {
-        state->pc = ((opcode[2] << 8) | opcode[1]);
-        break;
-      }
-    case 0xc4:  // CNZ
-      {
-        if(!state->cc.z) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xc5:  // PUSH B
-      {
-        state->memory[state->sp-1] = state->b;
-        state->memory[state->sp-2] = state->c;
-        state->sp -= 2;
-        break;
-      }
-    case 0xc6:  // ADI
-      {
-        uint16_t t = (uint16_t)state->a + (uint16_t)opcode[1];
-        state->cc.z = ((t & 0xff) == 0);
-        state->cc.s = ((t & 0x80) == 0x80);
-        //state->cc.p = Parity((t & 0xff), 8);
-        state->cc.p = Parity((uint8_t)t, 8);
-        state->cc.cy = (t > 0xff);
-        state->a = (uint8_t)t;
-        state->pc += 1;
-        break;
-      }
-    case 0xc8:  // RZ
-      {
-        if(state->cc.z) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xc9:  // RET
-      {
-        state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-        state->sp += 2;
-        break;
-      }
-    case 0xca:  // JZ
-      {
-        if(state->cc.z)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xcc:  // CZ
-      {
-        if(state->cc.z) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xcd:  // CALL
-#if TEST
-      if(((opcode[2] << 8) | opcode[1]) == 5)
-      {
-        if(state->c == 9)
-        {
-          uint16_t offset = ((state->d << 8) | state->e);
-          char *str = &state->memory[offset+3];
-          while(*str != '$') {
-            printf("%c", *str++);
-          }
-          printf("\n");
-        }
-        else if(state->c == 2)
-        {
-          printf("print char routine called\n");
-        }
-      }
-      else if(((opcode[2] << 8) | opcode[1]) == 0)
-      {
-        exit(0);
-      }
-      else
-#endif
-      {
-        uint16_t ret = state->pc+2;
-        state->memory[state->sp-1] = (ret >> 8) & 0xff;
-        state->memory[state->sp-2] = (ret & 0xff);
-        state->sp = state->sp-2;
-        state->pc = ((opcode[2] << 8) | opcode[1]);
-        break;
-      }
-    case 0xce:  // ACI
-      {
-        uint16_t result = (uint16_t)state->a + (uint16_t)opcode[1] + state->cc.cy;
-        state->cc.z = ((result & 0xff) == 0);
-        state->cc.s = ((result & 0x80) == 0x80);
-        state->cc.p = Parity(result, 8);
-        state->cc.cy = (result > 0xff);
-        state->a = (uint8_t)result;
-        state->pc += 1;
-        break;
-      }
-    case 0xd0:  // RNC
-      {
-        if(!state->cc.cy) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xd1:  // POP D
-      {
-        state->e = state->memory[state->sp];
-        state->d = state->memory[state->sp+1];
-        state->sp += 2;
-        break;
-      }
-    case 0xd2:  // JNC
-      {
-        if(!state->cc.cy)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xd3:  // OUT
-      {
-        state->pc += 1;
-        break;
-      }
-    case 0xd4:  // CNC
-      {
-        if(!state->cc.cy) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xd5:  // PUSH D
-      {
-        state->memory[state->sp-1] = state->d;
-        state->memory[state->sp-2] = state->e;
-        state->sp -= 2;
-        break;
-      }
-    case 0xd6:  // SUI
-      {
-        uint16_t result = (uint16_t)state->a - (uint16_t)opcode[1];
-        //state->cc.cy = 1;
-        state->cc.cy = ((result & 0x100) != 0);
-        state->cc.p = Parity((uint8_t)result, 8);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.z = (result == 0);
-        state->a = (uint8_t)result;
-        state->pc += 1;
-        break;
-      }
-    case 0xd8:  // RC
-      {
-        if(state->cc.cy) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xda:  // JC
-      {
-        if(state->cc.cy)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xdc:  // CC
-      {
-        if(state->cc.cy) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xde:  // SBI
-      {
-        uint16_t result = (uint16_t)state->a - ((uint16_t)opcode[1] + state->cc.cy);
-        state->cc.cy = 1;
-        state->cc.p = Parity((uint8_t)result, 8);
-        state->cc.s = ((result & 0x80) != 0);
-        state->cc.z = (result == 0);
-        state->a = (uint8_t)result;
-        state->pc += 1;
-        break;
-      }
-    case 0xe0:  // RPO
-      {
-        if(!state->cc.p) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xe1:  // POP H
-      {
-        state->l = state->memory[state->sp];
-        state->h = state->memory[state->sp+1];
-        state->sp += 2;
-        break;
-      }
-    case 0xe2:  // JPO
-      {
-        if(!state->cc.p)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xe3:  // XTHL
-      {
-        uint8_t t1 = state->memory[state->sp];
-        uint8_t t2 = state->memory[state->sp+1];
-        state->memory[state->sp] = state->l;
-        state->memory[state->sp] = state->h;
-        state->l = t1;
-        state->h = t2;
-      }
-    case 0xe4:  // CPO
-      {
-        if(!state->cc.p) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xe5:  // PUSH H
-      {
-        state->memory[state->sp-1] = state->h;
-        state->memory[state->sp-2] = state->l;
-        state->sp -= 2;
-        break;
-      }
-    case 0xe6:  // ANI
-      {
-        state->a &= opcode[1];
-        state->cc.cy = 0;
-        state->cc.ac = 0;
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->cc.p = Parity(state->a, 8);
-        state->cc.z = (state->a == 0);
-        state->pc += 1;
-        break;
-      }
-    case 0xe8:  // RPE
-      {
-        if(state->cc.p) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xea:  // JPE
-      {
-        if(state->cc.p)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xeb:  // XCHG
-      {
-        uint16_t t1 = state->h;
-        uint16_t t2 = state->l;
-        state->h = state->d;
-        state->l = state->e;
-        state->d = t1;
-        state->e = t2;
-        break;
-      }
-    case 0xec:  // CPE
-      {
-        if(state->cc.p) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xee:  // XRI
-      {
-        state->a ^= opcode[1];
-        state->cc.cy = 0;
-        state->cc.p = Parity(state->a, 8);
-        state->cc.z = (state->a == 0);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->pc += 1;
-        break;
-      }
-    case 0xf0:  // RP
-      {
-        if(!state->cc.s) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xf1:  // POP PSW
-      {
-        state->a = state->memory[state->sp+1];
-        uint8_t psw = state->memory[state->sp];
-        state->cc.z = ((psw & 0x01) == 0x01);
-        state->cc.s = ((psw & 0x02) == 0x02);
-        state->cc.p = ((psw & 0x04) == 0x04);
-        state->cc.cy = ((psw & 0x05) == 0x05);
-        state->cc.ac = ((psw & 0x10) == 0x10);
-        state->sp += 2;
-        break;
-      }
-    case 0xf2:  // JP
-      {
-        if(!state->cc.s)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xf4:  // CP
-      {
-        if(!state->cc.s) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xf5:  // PUSH PSW
-      {
-        state->memory[state->sp-1] = state->a;
-        uint8_t psw = (state->cc.z | state->cc.s << 1 | state->cc.p << 2 | state->cc.cy << 3 | state->cc.ac << 4);
-        state->memory[state->sp-2] = psw;
-        state->sp -= 2;
-        break;
-      }
-    case 0xf6:  // ORI
-      {
-        state->a |= opcode[1];
-        state->cc.cy = 0;
-        state->cc.z = (state->a == 0);
-        state->cc.p = Parity(state->a, 8);
-        state->cc.s = ((state->a & 0x80) != 0);
-        state->pc += 1;
-        break;
-      } 
-    case 0xf8:  // RM
-      {
-        if(state->cc.s) {
-          state->pc = ((state->memory[state->sp+1] << 8) | state->memory[state->sp]);
-          state->sp += 2;
-        }
-        break;
-      }
-    case 0xfa:  // JM
-      {
-        if(state->cc.s)
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xfb:  //EI
-      {
-        state->int_enable = 1;
-        break;
-      }
-    case 0xfc:  // CM
-      {
-        if(state->cc.s) {
-          uint16_t ret = state->pc +2;
-          state->memory[state->sp -1] = (ret >> 8) & 0xff;
-          state->memory[state->sp -2] = (ret & 0xff);
-          state->sp = state->sp -2;
-          state->pc = ((opcode[2] << 8) | opcode[1]);
-        }
-        else
-          state->pc += 2;
-        break;
-      }
-    case 0xfe:  // CPI
-      {
-        uint8_t t = state->a - opcode[1];
-        state->cc.z = (t == 0);
-        state->cc.s = ((t & 0x80) == 0x80);
-        state->cc.p = Parity(t, 8);
-        state->cc.cy = (state->a < opcode[1]);
-        state->pc += 1;
-        break;
-      }
-    default:
-      {
-        UnimplementedInstruction(state);
-        break;
-      }
+    *p++ = '\n';
+    Put(out, size, at, line, p - line);
+    at += p - line;
+    pc += len;
   }
-#if DEBUG
-  printf("\t");
-  printf("%c", state->cc.z ? 'z' : '.');
-  printf("%c", state->cc.s ? 's' : '.');
-  printf("%c", state->cc.p ? 'p' : '.');
-  printf("%c", state->cc.cy ? 'c' : '.');
-  printf("%c  ", state->cc.ac ? 'a' : '.');
-  printf("A $%02x B $%02x C $%02x D $%02x E $%02x H $%02x L $%02x SP %04x\n", state->a, state->b, state->c,
-      state->d, state->e, state->h, state->l, state->sp);
-#endif
-  return 0;
+  return at;
 }
 
-int Disassemble8080p(unsigned char *buffer, int pc)
+int Disassemble8080f(FILE *out, const unsigned char *code, int pc)
 {
-  unsigned char* code = &buffer[pc];
-  int opbytes = 1;
-  printf("%04x ", pc);
-  switch(*code)
-  {
-    case 0x00: printf("NOP"); break;
-    case 0x01: printf("LXI    B,#$%02x%0x2", code[2], code[1]); opbytes = 3; break;
-    case 0x02: printf("STAX   B\t"); break;
-    case 0x03: printf("INX    B\t"); break;
-    case 0x04: printf("INR    B\t"); break;
-    case 0x05: printf("DCR    B\t"); break;
-    case 0x06: printf("MVI    B,#$%02x", code[1]); opbytes = 2; break;
-    case 0x07: printf("RLC    \t"); break;
-    case 0x08: printf("NOP    \t"); break;
-    case 0x09: printf("DAD    B\t"); break;
-    case 0x0a: printf("LDAX   B\t"); break;
-    case 0x0b: printf("DCX    B\t"); break;
-    case 0x0c: printf("INR    C\t"); break;
-    case 0x0d: printf("DCR    C\t"); break;
-    case 0x0e: printf("MVI    C, #$%02x", code[1]); opbytes = 2; break;
-    case 0x0f: printf("RRC    \t"); break;
-
-    case 0x10: printf("NOP"); break;
-    case 0x11: printf("LXI    D,#$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0x12: printf("STAX   D\t"); break;
-    case 0x13: printf("INX    D\t"); break;
-    case 0x14: printf("INR    D\t"); break;
-    case 0x15: printf("DCR    D\t"); break;
-    case 0x16: printf("MVI    D,#$%02x", code[1]); opbytes = 2; break;
-    case 0x17: printf("RAL    \t"); break;
-    case 0x18: printf("NOP"); break;
-    case 0x19: printf("DAD    D\t"); break;
-    case 0x1a: printf("LDAX   D\t"); break;
-    case 0x1b: printf("DXC    D\t"); break;
-    case 0x1c: printf("INR    E\t"); break;
-    case 0x1d: printf("DCR    E\t"); break;
-    case 0x1e: printf("MVI    E,#$%02x", code[1]); opbytes = 2; break;
-    case 0x1f: printf("RAR    \t"); break;
-
-    case 0x20: printf("NOP"); break;
-    case 0x21: printf("LXI    H,#$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0x22: printf("SHLD   $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0x23: printf("INX    H\t"); break;
-    case 0x24: printf("INR    H\t"); break;
-    case 0x25: printf("DCR    H\t"); break;
-    case 0x26: printf("MVI    H,#$%02x", code[1]); opbytes = 2; break;
-    case 0x27: printf("DAA    \t"); break;
-    case 0x28: printf("NOP"); break;
-    case 0x29: printf("DAD    H\t"); break;
-    case 0x2a: printf("LHLD   $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0x2b: printf("DCX    H\t"); break;
-    case 0x2c: printf("INR    L\t"); break;
-    case 0x2d: printf("DCR    L\t"); break;
-    case 0x2e: printf("MVI    L,#$%02x", code[1]); opbytes = 2; break;
-    case 0x2f: printf("CMA    \t"); break;
-
-    case 0x30: printf("NOP"); break;
-    case 0x31: printf("LXI    SP,#$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0x32: printf("STA    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0x33: printf("INX    SP\t"); break;
-    case 0x34: printf("INR    M\t"); break;
-    case 0x35: printf("DCR    M\t"); break;
-    case 0x36: printf("MVI    M,#$%02x", code[1]); opbytes = 2; break;
-    case 0x37: printf("STC    \t"); break;
-    case 0x38: printf("NOP"); break;
-    case 0x39: printf("DAD    SP\t"); break;
-    case 0x3a: printf("LDA    $%02x%0x2", code[2], code[1]); opbytes = 3; break;
-    case 0x3b: printf("DCX    SP\t"); break;
-    case 0x3c: printf("INR    A\t"); break;
-    case 0x3d: printf("DCR    A\t"); break;
-    case 0x3e: printf("MVI    A, #$%02x", code[1]); opbytes = 2; break;
-    case 0x3f: printf("CMC    \t"); break;
-
-    case 0x40: printf("MOV    B,B\t"); break;
-    case 0x41: printf("MOV    B,C\t"); break;
-    case 0x42: printf("MOV    B,D\t"); break;
-    case 0x43: printf("MOV    B,E\t"); break;
-    case 0x44: printf("MOV    B,H\t"); break;
-    case 0x45: printf("MOV    B,L\t"); break;
-    case 0x46: printf("MOV    B,M\t"); break;
-    case 0x47: printf("MOV    B,A\t"); break;
-    case 0x48: printf("MOV    C,B\t"); break;
-    case 0x49: printf("MOV    C,C\t"); break;
-    case 0x4a: printf("MOV    C,D\t"); break;
-    case 0x4b: printf("MOV    C,E\t"); break;
-    case 0x4c: printf("MOV    C,H\t"); break;
-    case 0x4d: printf("MOV    C,L\t"); break;
-    case 0x4e: printf("MOV    C,M\t"); break;
-    case 0x4f: printf("MOV    C,A\t"); break;
-
-    case 0x50: printf("MOV    D,B\t"); break;
-    case 0x51: printf("MOV    D,C\t"); break;
-    case 0x52: printf("MOV    D,D\t"); break;
-    case 0x53: printf("MOV    D,E\t"); break;
-    case 0x54: printf("MOV    D,H\t"); break;
-    case 0x55: printf("MOV    D,L\t"); break;
-    case 0x56: printf("MOV    D,M\t"); break;
-    case 0x57: printf("MOV    D,A\t"); break;
-    case 0x58: printf("MOV    E,B\t"); break;
-    case 0x59: printf("MOV    E,C\t"); break;
-    case 0x5a: printf("MOV    E,D\t"); break;
-    case 0x5b: printf("MOV    E,E\t"); break;
-    case 0x5c: printf("MOV    E,H\t"); break;
-    case 0x5d: printf("MOV    E,L\t"); break;
-    case 0x5e: printf("MOV    E,M\t"); break;
-    case 0x5f: printf("MOV    E,A\t"); break;
-
-    case 0x60: printf("MOV    H,B\t"); break;
-    case 0x61: printf("MOV    H,C\t"); break;
-    case 0x62: printf("MOV    H,D\t"); break;
-    case 0x63: printf("MOV    H,E\t"); break;
-    case 0x64: printf("MOV    H,H\t"); break;
-    case 0x65: printf("MOV    H,L\t"); break;
-    case 0x66: printf("MOV    H,M\t"); break;
-    case 0x67: printf("MOV    H,A\t"); break;
-    case 0x68: printf("MOV    L,B\t"); break;
-    case 0x69: printf("MOV    L,C\t"); break;
-    case 0x6a: printf("MOV    L,D\t"); break;
-    case 0x6b: printf("MOV    L,E\t"); break;
-    case 0x6c: printf("MOV    L,H\t"); break;
-    case 0x6d: printf("MOV    L,L\t"); break;
-    case 0x6e: printf("MOV    L,M\t"); break;
-    case 0x6f: printf("MOV    L,A\t"); break;
-
-    case 0x70: printf("MOV    M,B\t"); break;
-    case 0x71: printf("MOV    M,C\t"); break;
-    case 0x72: printf("MOV    M,D\t"); break;
-    case 0x73: printf("MOV    M,E\t"); break;
-    case 0x74: printf("MOV    M,H\t"); break;
-    case 0x75: printf("MOV    M,L\t"); break;
-    case 0x76: printf("HLT    "); break;
-    case 0x77: printf("MOV    M,A\t"); break;
-    case 0x78: printf("MOV    A,B\t"); break;
-    case 0x79: printf("MOV    A,C\t"); break;
-    case 0x7a: printf("MOV    A,D\t"); break;
-    case 0x7b: printf("MOV    A,E\t"); break;
-    case 0x7c: printf("MOV    A,H\t"); break;
-    case 0x7d: printf("MOV    A,L\t"); break;
-    case 0x7e: printf("MOV    A,M\t"); break;
-    case 0x7f: printf("MOV    A,A\t"); break;
-
-    case 0x80: printf("ADD    B\t"); break;
-    case 0x81: printf("ADD    C\t"); break;
-    case 0x82: printf("ADD    D\t"); break;
-    case 0x83: printf("ADD    E\t"); break;
-    case 0x84: printf("ADD    H\t"); break;
-    case 0x85: printf("ADD    L\t"); break;
-    case 0x86: printf("ADD    M\t"); break;
-    case 0x87: printf("ADD    A\t"); break;
-    case 0x88: printf("ADC    B\t"); break;
-    case 0x89: printf("ADC    C\t"); break;
-    case 0x8a: printf("ADC    D\t"); break;
-    case 0x8b: printf("ADC    E\t"); break;
-    case 0x8c: printf("ADC    H\t"); break;
-    case 0x8d: printf("ADC    L\t"); break;
-    case 0x8e: printf("ADC    M\t"); break;
-    case 0x8f: printf("ADC    A\t"); break;
-
-    case 0x90: printf("SUB    B\t"); break;
-    case 0x91: printf("SUB    C\t"); break;
-    case 0x92: printf("SUB    D\t"); break;
-    case 0x93: printf("SUB    E\t"); break;
-    case 0x94: printf("SUB    H\t"); break;
-    case 0x95: printf("SUB    L\t"); break;
-    case 0x96: printf("SUB    M\t"); break;
-    case 0x97: printf("SUB    A\t"); break;
-    case 0x98: printf("SSB    B\t"); break;
-    case 0x99: printf("SSB    C\t"); break;
-    case 0x9a: printf("SSB    D\t"); break;
-    case 0x9b: printf("SSB    E\t"); break;
-    case 0x9c: printf("SSB    H\t"); break;
-    case 0x9d: printf("SSB    L\t"); break;
-    case 0x9e: printf("SSB    M\t"); break;
-    case 0x9f: printf("SSB    A\t"); break;
-
-    case 0xa0: printf("ANA    B\t"); break;
-    case 0xa1: printf("ANA    C\t"); break;
-    case 0xa2: printf("ANA    D\t"); break;
-    case 0xa3: printf("ANA    E\t"); break;
-    case 0xa4: printf("ANA    H\t"); break;
-    case 0xa5: printf("ANA    L\t"); break;
-    case 0xa6: printf("ANA    M\t"); break;
-    case 0xa7: printf("ANA    A\t"); break;
-    case 0xa8: printf("XRA    B\t"); break;
-    case 0xa9: printf("XRA    C\t"); break;
-    case 0xaa: printf("XRA    D\t"); break;
-    case 0xab: printf("XRA    E\t"); break;
-    case 0xac: printf("XRA    H\t"); break;
-    case 0xad: printf("XRA    L\t"); break;
-    case 0xae: printf("XRA    M\t"); break;
-    case 0xaf: printf("XRA    A\t"); break;
-
-    case 0xb0: printf("ORA    B\t"); break;
-    case 0xb1: printf("ORA    C\t"); break;
-    case 0xb2: printf("ORA    D\t"); break;
-    case 0xb3: printf("ORA    E\t"); break;
-    case 0xb4: printf("ORA    H\t"); break;
-    case 0xb5: printf("ORA    L\t"); break;
-    case 0xb6: printf("ORA    M\t"); break;
-    case 0xb7: printf("ORA    A\t"); break;
-    case 0xb8: printf("CMP    B\t"); break;
-    case 0xb9: printf("CMP    C\t"); break;
-    case 0xba: printf("CMP    D\t"); break;
-    case 0xbb: printf("CMP    E\t"); break;
-    case 0xbc: printf("CMP    H\t"); break;
-    case 0xbd: printf("CMP    L\t"); break;
-    case 0xbe: printf("CMP    M\t"); break;
-    case 0xbf: printf("CMP    A\t"); break;
-
-    case 0xc0: printf("RNZ    \t"); break;
-    case 0xc1: printf("POP    B\t"); break;
-    case 0xc2: printf("JNZ    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xc3: printf("JMP    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xc4: printf("CNZ    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xc5: printf("PUSH   B\t"); break;
-    case 0xc6: printf("ADI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xc7: printf("RST    0"); break;
-    case 0xc8: printf("RZ     \t"); break;
-    case 0xc9: printf("RET    \t"); break;
-    case 0xca: printf("JZ     $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xcb: printf("JMP    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xcc: printf("CZ     $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xcd: printf("CALL   $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xce: printf("ACI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xcf: printf("RST    1\t"); break;
-
-    case 0xd0: printf("RNC    \t"); break;
-    case 0xd1: printf("POP    D\t"); break;
-    case 0xd2: printf("JNC    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xd3: printf("OUT    #$%02x", code[1]); opbytes = 2; break;
-    case 0xd4: printf("CNC    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xd5: printf("PUSH   D\t"); break;
-    case 0xd6: printf("SUI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xd7: printf("RST    2\t"); break;
-    case 0xd8: printf("RC     \t"); break;
-    case 0xd9: printf("RET    \t"); break;
-    case 0xda: printf("JC     $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xdb: printf("IN     #%02x", code[1]); opbytes = 2; break;
-    case 0xdc: printf("CC     #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xdd: printf("CALL   #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xde: printf("SBI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xdf: printf("RST    5"); break;
-
-    case 0xe0: printf("RPO    \t"); break;
-    case 0xe1: printf("POP    H"); break;
-    case 0xe2: printf("JPO    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xe3: printf("XTHL   \t"); break;
-    case 0xe4: printf("CPO    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xe5: printf("PUSH   H\t"); break;
-    case 0xe6: printf("ANI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xe7: printf("RST    4\t"); break;
-    case 0xe8: printf("RPE    \t"); break;
-    case 0xe9: printf("PCHL   \t"); break;
-    case 0xea: printf("JPE    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xeb: printf("XCHG   \t"); break;
-    case 0xec: printf("CPE    $%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xed: printf("CALL   #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xee: printf("XRI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xef: printf("RST    5\t"); break;
-
-    case 0xf0: printf("RP      \t"); break;
-    case 0xf1: printf("POP    PSW"); break;
-    case 0xf2: printf("JP     #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xf3: printf("DI      \t"); break;
-    case 0xf4: printf("CP     #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xf5: printf("PUSH   PSW"); break;
-    case 0xf6: printf("ORI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xf7: printf("RST    6\t"); break;
-    case 0xf8: printf("RM      \t"); break;
-    case 0xf9: printf("SPHL   \t"); break;
-    case 0xfa: printf("JM     #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xfb: printf("EI      \t"); break;
-    case 0xfc: printf("CM     #$%02x%02x", code[2], code[1]); opbytes = 3; break;
-    case 0xfd: printf("CALL   #$%02x%02x", code[2],code[1]); opbytes = 3; break;
-    case 0xfe: printf("CPI    #$%02x", code[1]); opbytes = 2; break;
-    case 0xff: printf("RST    7\t"); break;
-
-    default:
-               printf(": %02x", code[0]);
-               break;
-  }
-  //printf("\n");
+  char text[TEXT_MAX];
+  Text(text, code);
+  fprintf(out, "%04x %s", pc, text);
+  return opcodes8080[code[0]].size;
+}
 
-  return opbytes;
+int Disassemble8080p(unsigned char *buffer, int pc)
+{
+  return Disassemble8080f(stdout, &buffer[pc], pc);
 }
@@ -0,0 +1,200 @@
+#ifndef EMULATE_8080_H
+#define EMULATE_8080_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Status codes returned by the library.  Nothing in the library prints
+// or calls exit(); the caller decides what to do with a non-zero status.
+enum {
+  EMU_OK = 0,
+  EMU_EXIT,           // guest asked to terminate (CP/M warm boot)
+  EMU_UNIMPLEMENTED,  // opcode at state->pc isn't handled by the core
+  EMU_ERR_IO,         // couldn't open or read a file
+  EMU_ERR_NOMEM,      // allocation failed
+  EMU_ERR_FORMAT,     // save state has the wrong magic, version or size
+  EMU_BREAK,          // stopped at a breakpoint or watchpoint (debug.h)
+  EMU_HALT,           // Emulate8080p only: halted until an interrupt
+};
+
+// 2 MHz CPU, 60 Hz display.
+#define CPU_HZ        2000000
+#define FRAME_CYCLES  (CPU_HZ / 60)
+#define FRAME_NS      (1000000000 / 60)
+
+// Guest memory is reached through a 256-entry page table.
+#define PAGE_SIZE     0x100
+#define PAGES         0x100
+
+// Space Invaders memory map: ROM below RAM_BASE, then work RAM and the
+// 1bpp video RAM.
+#define RAM_BASE      0x2000
+#define RAM_SIZE      0x2000
+#define VRAM_BASE     0x2400
+#define VRAM_SIZE     0x1c00
+
+typedef struct ConditionCodes {
+  uint8_t z:1;
+  uint8_t s:1;
+  uint8_t p:1;
+  uint8_t cy:1;
+  uint8_t ac:1;
+  uint8_t pad:3;
+} ConditionCodes;
+
+// I/O port latches.  in[] is filled by the host (coin, fire, dip
+// switches); out[] holds the last byte the guest wrote to each port.
+typedef struct Ports8080 {
+  uint8_t in[8];
+  uint8_t out[8];
+  uint16_t shift;         // Invaders shift register (ports 2, 3, 4)
+  uint8_t shift_offset;
+} Ports8080;
+
+// A register pair: one native 16-bit word whose halves can also be
+// used as 8-bit registers.  The halves are laid out in host byte order,
+// so state->hl and state->h/state->l always agree.
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PAIR8080(hi, lo, pair) \
+  union { uint16_t pair; struct { uint8_t hi; uint8_t lo; }; }
+#else
+#define PAIR8080(hi, lo, pair) \
+  union { uint16_t pair; struct { uint8_t lo; uint8_t hi; }; }
+#endif
+
+// One machine.  Everything the core touches lives here, so any number
+// of machines can run side by side, one per thread or interleaved.
+// A and the flags are not paired: the flags live in ConditionCodes and
+// are packed into the PSW byte only by PUSH PSW and POP PSW.
+typedef struct State8080 {
+  uint8_t a;
+  PAIR8080(b, c, bc);
+  PAIR8080(d, e, de);
+  PAIR8080(h, l, hl);
+  uint16_t  sp;
+  uint16_t  pc;
+  uint8_t *memory;    // flat 64 KB owned by this machine; NULL after Fork8080
+  uint8_t *rpage[PAGES];
+  uint8_t *wpage[PAGES];              // NULL: copy the page before writing
+  uint8_t private_page[PAGES / 8];    // pages allocated by this machine
+  uint8_t **retired;  // our old private pages that children still read
+  int nretired;
+  int retired_cap;
+  struct ConditionCodes cc;
+  uint8_t int_enable;
+  uint8_t halted;     // executed HLT; cleared by Interrupt8080
+  Ports8080 io;
+  uint64_t counter;   // instructions retired
+  uint64_t cycles;
+  uint64_t frames;
+  uint64_t interrupts;  // interrupts taken
+  uint64_t port_in;     // IN instructions
+  uint64_t port_out;    // OUT instructions
+  int fault;          // sticky error from the memory layer
+  int external;       // state and memory belong to someone else (InitAt8080)
+  struct Profile8080 *profile;  // counters to update, or NULL (profile.h)
+  struct Calls8080 *calls;      // call graph to update, or NULL (calls.h)
+  struct Metrics8080 *metrics;  // published after each run, or NULL (metrics.h)
+  struct Debug8080 *debug;      // breakpoints and watchpoints, or NULL (debug.h)
+  struct Cover8080 *cover;      // coverage bitmap to set, or NULL (cover.h)
+  struct Tier8080 *tier;        // block caches for tiered execution, or NULL (tier.h)
+  FILE *trace;        // every instruction and the registers after it, or NULL
+  uint8_t cpm;        // CP/M program: CALL 5 is the BDOS, and 0 the exit (LoadCpm8080)
+  FILE *console;      // where its BDOS console output goes, or NULL
+} State8080;
+
+// Returns NULL if allocation fails.
+State8080 *Init8080(void);
+// Builds a machine in caller-owned storage: `where` holds the State8080
+// and `memory` is 64 KB of zeroed guest memory.  Free8080 on such a
+// machine only releases the copy-on-write pages it allocated.
+State8080 *InitAt8080(void *where, uint8_t *memory);
+void Free8080(State8080 *state);
+
+// Makes a child that shares all of the parent's memory copy-on-write at
+// page granularity; only pages either side writes afterwards are
+// duplicated.  The parent must outlive its children.
+State8080 *Fork8080(State8080 *parent);
+
+// Memory access that goes through the page table, for code that must
+// work on forked machines.  WritablePage8080 returns the page's private
+// copy (making one if needed), or NULL if allocation fails.
+void ReadBlock8080(const State8080 *state, uint16_t addr, void *dst, size_t n);
+int WriteBlock8080(State8080 *state, uint16_t addr, const void *src, size_t n);
+uint8_t *WritablePage8080(State8080 *state, int page);
+void WriteSlow8080(State8080 *state, uint16_t addr, uint8_t value);
+
+// Loads a ROM image at memory[offset].  Returns EMU_OK or EMU_ERR_IO.
+int ReadFile(State8080 *state, const char *filename, uint16_t offset);
+// Loads a CP/M .COM program at 0x100 with a jump to it at 0, and sets
+// state->cpm: what it writes through BDOS functions 2 (the character
+// in E) and 9 (the '$'-terminated string at DE) goes to `console`, if
+// not NULL, and a warm boot (CALL or JMP 0) returns EMU_EXIT.  The same
+// binary runs ROMs and CP/M programs; the core picks its variant from
+// the machine.
+int LoadCpm8080(State8080 *state, const char *filename, FILE *console);
+
+// Executes one instruction.  Returns EMU_OK or one of the status codes;
+// EMU_HALT, without executing anything, while the CPU is halted.
+int Emulate8080p(State8080 *state);
+
+// Runs until at least `cycles` cycles have elapsed or the core stops.
+// A halted CPU doesn't execute anything: the remaining cycles are
+// skipped in one step, as the next thing it can do is take an
+// interrupt, and the caller delivers those between runs.
+int Run8080(State8080 *state, int cycles);
+// Runs one 60 Hz frame worth of cycles with the Invaders interrupts:
+// RST 1 when the beam reaches mid-screen and RST 2 at vblank.
+int RunFrame8080(State8080 *state);
+// Delivers RST n if interrupts are enabled: pushes pc, jumps to n * 8,
+// disables interrupts and ends a HLT.  Returns 1 if it was taken.
+int Interrupt8080(State8080 *state, int n);
+
+// Cycles charged per opcode by Emulate8080p; a taken conditional CALL
+// or RET costs 6 more.
+extern const uint8_t cycles8080[256];
+
+// The machine this thread is executing: set for the length of a Run8080
+// or Emulate8080p call, NULL otherwise.  For signal handlers (sampler.h).
+extern _Thread_local State8080 *volatile running8080;
+
+// How an instruction affects control flow.
+enum {
+  FLOW_NEXT = 0,    // falls through
+  FLOW_JUMP,        // JMP
+  FLOW_BRANCH,      // Jcc
+  FLOW_CALL,        // CALL
+  FLOW_CCALL,       // Ccc
+  FLOW_RST,         // RST n: call to n * 8
+  FLOW_RET,         // RET
+  FLOW_CRET,        // Rcc
+  FLOW_PCHL,        // jump through HL
+  FLOW_HALT,        // HLT
+};
+
+typedef struct Opcode8080 {
+  const char *text;     // mnemonic and operands, up to the immediate
+  uint8_t size;
+  uint8_t flow;         // FLOW_*
+} Opcode8080;
+
+extern const Opcode8080 opcodes8080[256];
+
+// Writes the text of the instruction at code[0..2] into out, as much as
+// fits in `size` bytes, and returns its length in bytes.
+int Disassemble8080s(char *out, size_t size, const uint8_t *code);
+// Lists mem[start..end) one instruction per line with address and
+// bytes.  Writes what fits in out and returns the full listing's length
+// (as snprintf does).  An instruction running past end is shown as DB.
+size_t DisassembleRange8080(const uint8_t *mem, int start, int end, char *out, size_t size);
+// Prints "addr text" for the instruction at code[0..2], which sits at
+// address pc, and returns its length.  Disassemble8080p prints
+// memory[pc] to stdout.
+int Disassemble8080f(FILE *out, const unsigned char *code, int pc);
+int Disassemble8080p(unsigned char *buffer, int pc);
+int Parity(int x, int size);
+
+const char *StatusString8080(int status);
+
+#endif
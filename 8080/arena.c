@@ -0,0 +1,109 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "arena.h"
+
+#define HUGE_PAGE  (2u << 20)
+
+struct Arena8080 {
+  uint8_t *base;
+  size_t size;
+  size_t slot;          // bytes per machine
+  size_t state_bytes;   // State8080 rounded up to a host page
+  int capacity;
+  int used;
+  int dirty;            // slots handed out since the mapping was made
+  int huge;
+};
+
+static size_t RoundUp(size_t n, size_t to)
+{
+  return (n + to - 1) / to * to;
+}
+
+Arena8080 *InitArena8080(int machines, int flags)
+{
+  size_t host_page = (size_t)sysconf(_SC_PAGESIZE);
+  Arena8080 *arena;
+  if(machines <= 0)
+    return NULL;
+  arena = calloc(1, sizeof(Arena8080));
+  if(arena == NULL)
+    return NULL;
+
+  arena->state_bytes = RoundUp(sizeof(State8080), host_page);
+  arena->slot = arena->state_bytes + 0x10000;
+  arena->capacity = machines;
+  arena->size = arena->slot * machines;
+
+  arena->base = MAP_FAILED;
+  if(flags & ARENA_HUGE_PAGES)
+  {
+    size_t huge_size = RoundUp(arena->size, HUGE_PAGE);
+    arena->base = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(arena->base != MAP_FAILED)
+    {
+      arena->size = huge_size;
+      arena->huge = 1;
+    }
+  }
+  if(arena->base == MAP_FAILED)
+  {
+    arena->base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(arena->base == MAP_FAILED)
+    {
+      free(arena);
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    // No reserved huge pages; transparent ones are the next best thing.
+    if(flags & ARENA_HUGE_PAGES)
+      madvise(arena->base, arena->size, MADV_HUGEPAGE);
+#endif
+  }
+  return arena;
+}
+
+void FreeArena8080(Arena8080 *arena)
+{
+  if(arena == NULL)
+    return;
+  munmap(arena->base, arena->size);
+  free(arena);
+}
+
+State8080 *ArenaMachine8080(Arena8080 *arena)
+{
+  uint8_t *slot, *memory;
+  if(arena->used == arena->capacity)
+    return NULL;
+  slot = arena->base + arena->slot * arena->used;
+  memory = slot + arena->state_bytes;
+  // Fresh anonymous pages are already zero; only reused slots need it.
+  if(arena->used < arena->dirty)
+    memset(memory, 0, 0x10000);
+  else
+    arena->dirty = arena->used + 1;
+  arena->used++;
+  return InitAt8080(slot, memory);
+}
+
+void ResetArena8080(Arena8080 *arena)
+{
+  arena->used = 0;
+}
+
+int ArenaCount8080(const Arena8080 *arena)
+{
+  return arena->used;
+}
+
+int ArenaHugePages8080(const Arena8080 *arena)
+{
+  return arena->huge;
+}
@@ -0,0 +1,35 @@
+#ifndef EMULATE_ARENA_H
+#define EMULATE_ARENA_H
+
+#include <stddef.h>
+
+#include "8080.h"
+
+// One mapping that holds a whole batch of machines.  Each slot is the
+// State8080 (registers and page tables) followed directly by its 64 KB
+// of guest memory, with the slot and the memory page aligned.  Creating
+// a machine is a pointer bump and tearing the batch down is a reset of
+// that pointer, instead of a calloc/free pair per machine.
+typedef struct Arena8080 Arena8080;
+
+enum {
+  ARENA_HUGE_PAGES = 1,   // back the arena with huge pages if the host allows
+};
+
+// Room for `machines` machines.  Returns NULL on failure.
+Arena8080 *InitArena8080(int machines, int flags);
+void FreeArena8080(Arena8080 *arena);
+
+// Returns a zeroed machine, as Init8080 would, or NULL when the arena
+// is full.
+State8080 *ArenaMachine8080(Arena8080 *arena);
+
+// Forgets every machine in the arena.  Machines that have been forked
+// from own copy-on-write pages outside the arena; call Free8080 on
+// those first.
+void ResetArena8080(Arena8080 *arena);
+
+int ArenaCount8080(const Arena8080 *arena);
+int ArenaHugePages8080(const Arena8080 *arena);
+
+#endif
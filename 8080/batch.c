@@ -0,0 +1,302 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "batch.h"
+
+// One deque per worker.  The owner pushes and pops at the bottom, so the
+// machine it just ran is the next one it picks up; thieves take the
+// oldest entry from the top.  A machine is in at most one deque at a
+// time, so `count` slots per deque is always enough.
+typedef struct Deque {
+  pthread_spinlock_t lock;
+  int *slot;
+  int cap;
+  int top;
+  int bottom;
+} Deque;
+
+typedef struct Worker {
+  Batch8080 *batch;
+  int id;
+  pthread_t thread;
+  Deque dq;
+} __attribute__((aligned(64))) Worker;
+
+struct Batch8080 {
+  int nthreads;
+  int pin;
+  Worker *workers;
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  int generation;
+  int finished;     // workers done with the current generation
+  int shutdown;
+
+  // Current run.
+  State8080 **machines;
+  int count;
+  int frames;
+  int *status;
+  int *left;        // frames still to run, per machine
+  int *home;        // worker that last ran each machine
+  int home_count;
+  atomic_int remaining;
+};
+
+static void Push(Deque *dq, int m)
+{
+  pthread_spin_lock(&dq->lock);
+  dq->slot[dq->bottom % dq->cap] = m;
+  dq->bottom++;
+  pthread_spin_unlock(&dq->lock);
+}
+
+static int PopBottom(Deque *dq, int *m)
+{
+  int found = 0;
+  pthread_spin_lock(&dq->lock);
+  if(dq->bottom > dq->top)
+  {
+    dq->bottom--;
+    *m = dq->slot[dq->bottom % dq->cap];
+    found = 1;
+  }
+  pthread_spin_unlock(&dq->lock);
+  return found;
+}
+
+static int StealTop(Deque *dq, int *m)
+{
+  int found = 0;
+  if(pthread_spin_trylock(&dq->lock) != 0)
+    return 0;
+  if(dq->bottom > dq->top)
+  {
+    *m = dq->slot[dq->top % dq->cap];
+    dq->top++;
+    found = 1;
+  }
+  pthread_spin_unlock(&dq->lock);
+  return found;
+}
+
+static int Steal(Batch8080 *batch, int id, int *m)
+{
+  int i;
+  for(i = 1; i < batch->nthreads; i++)
+  {
+    Worker *victim = &batch->workers[(id + i) % batch->nthreads];
+    if(StealTop(&victim->dq, m))
+      return 1;
+  }
+  return 0;
+}
+
+static void RunSlice(Worker *w, int m)
+{
+  Batch8080 *batch = w->batch;
+  int st = RunFrame8080(batch->machines[m]);
+
+  batch->home[m] = w->id;
+  if(st == EMU_OK && --batch->left[m] > 0)
+  {
+    Push(&w->dq, m);
+    return;
+  }
+  if(batch->status)
+    batch->status[m] = st;
+  atomic_fetch_sub_explicit(&batch->remaining, 1, memory_order_release);
+}
+
+static void *WorkerMain(void *arg)
+{
+  Worker *w = arg;
+  Batch8080 *batch = w->batch;
+  int seen = 0;
+
+  if(batch->pin)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->id % (ncpu > 0 ? ncpu : 1), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  for(;;)
+  {
+    pthread_mutex_lock(&batch->lock);
+    while(batch->generation == seen && !batch->shutdown)
+      pthread_cond_wait(&batch->start, &batch->lock);
+    seen = batch->generation;
+    int stop = batch->shutdown;
+    pthread_mutex_unlock(&batch->lock);
+    if(stop)
+      break;
+
+    while(atomic_load_explicit(&batch->remaining, memory_order_acquire) > 0)
+    {
+      int m;
+      if(PopBottom(&w->dq, &m) || Steal(batch, w->id, &m))
+        RunSlice(w, m);
+      else
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    if(++batch->finished == batch->nthreads)
+      pthread_cond_signal(&batch->done);
+    pthread_mutex_unlock(&batch->lock);
+  }
+  return NULL;
+}
+
+Batch8080 *InitBatch8080(int nthreads, int pin)
+{
+  int i;
+  if(nthreads <= 0)
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = (ncpu > 0) ? (int)ncpu : 1;
+  }
+
+  Batch8080 *batch = calloc(1, sizeof(Batch8080));
+  if(batch == NULL)
+    return NULL;
+  batch->workers = aligned_alloc(64, sizeof(Worker) * nthreads);
+  if(batch->workers == NULL)
+  {
+    free(batch);
+    return NULL;
+  }
+  batch->nthreads = nthreads;
+  batch->pin = pin;
+  pthread_mutex_init(&batch->lock, NULL);
+  pthread_cond_init(&batch->start, NULL);
+  pthread_cond_init(&batch->done, NULL);
+
+  for(i = 0; i < nthreads; i++)
+  {
+    Worker *w = &batch->workers[i];
+    w->batch = batch;
+    w->id = i;
+    w->dq.slot = NULL;
+    w->dq.cap = 0;
+    w->dq.top = w->dq.bottom = 0;
+    pthread_spin_init(&w->dq.lock, PTHREAD_PROCESS_PRIVATE);
+  }
+  for(i = 0; i < nthreads; i++)
+  {
+    if(pthread_create(&batch->workers[i].thread, NULL, WorkerMain, &batch->workers[i]) != 0)
+    {
+      batch->nthreads = i;
+      FreeBatch8080(batch);
+      return NULL;
+    }
+  }
+  return batch;
+}
+
+void FreeBatch8080(Batch8080 *batch)
+{
+  int i;
+  if(batch == NULL)
+    return;
+  pthread_mutex_lock(&batch->lock);
+  batch->shutdown = 1;
+  pthread_cond_broadcast(&batch->start);
+  pthread_mutex_unlock(&batch->lock);
+  for(i = 0; i < batch->nthreads; i++)
+    pthread_join(batch->workers[i].thread, NULL);
+  for(i = 0; i < batch->nthreads; i++)
+  {
+    pthread_spin_destroy(&batch->workers[i].dq.lock);
+    free(batch->workers[i].dq.slot);
+  }
+  pthread_cond_destroy(&batch->done);
+  pthread_cond_destroy(&batch->start);
+  pthread_mutex_destroy(&batch->lock);
+  free(batch->left);
+  free(batch->home);
+  free(batch->workers);
+  free(batch);
+}
+
+int BatchThreads8080(const Batch8080 *batch)
+{
+  return batch->nthreads;
+}
+
+// Sizes the per-run arrays.  Home assignments survive between runs over
+// the same number of machines, so a machine keeps its core from one
+// call to the next.
+static int Reserve(Batch8080 *batch, int count)
+{
+  int i;
+  if(count != batch->home_count)
+  {
+    int *left = realloc(batch->left, sizeof(int) * count);
+    if(left == NULL)
+      return EMU_ERR_NOMEM;
+    batch->left = left;
+    int *home = realloc(batch->home, sizeof(int) * count);
+    if(home == NULL)
+      return EMU_ERR_NOMEM;
+    batch->home = home;
+    for(i = 0; i < count; i++)
+      batch->home[i] = (int)((long)i * batch->nthreads / count);
+    batch->home_count = count;
+  }
+  for(i = 0; i < batch->nthreads; i++)
+  {
+    Deque *dq = &batch->workers[i].dq;
+    if(dq->cap < count)
+    {
+      int *slot = realloc(dq->slot, sizeof(int) * count);
+      if(slot == NULL)
+        return EMU_ERR_NOMEM;
+      dq->slot = slot;
+      dq->cap = count;
+    }
+    dq->top = dq->bottom = 0;
+  }
+  return EMU_OK;
+}
+
+int RunBatch8080(Batch8080 *batch, State8080 **machines, int count,
+    int frames, int *status)
+{
+  int i;
+  if(count <= 0 || frames <= 0)
+    return EMU_OK;
+  if(Reserve(batch, count) != EMU_OK)
+    return EMU_ERR_NOMEM;
+
+  batch->machines = machines;
+  batch->count = count;
+  batch->frames = frames;
+  batch->status = status;
+  for(i = 0; i < count; i++)
+  {
+    batch->left[i] = frames;
+    if(status)
+      status[i] = EMU_OK;
+    Push(&batch->workers[batch->home[i]].dq, i);
+  }
+  atomic_store_explicit(&batch->remaining, count, memory_order_release);
+
+  pthread_mutex_lock(&batch->lock);
+  batch->finished = 0;
+  batch->generation++;
+  pthread_cond_broadcast(&batch->start);
+  while(batch->finished < batch->nthreads)
+    pthread_cond_wait(&batch->done, &batch->lock);
+  pthread_mutex_unlock(&batch->lock);
+  return EMU_OK;
+}
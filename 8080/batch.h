@@ -0,0 +1,26 @@
+#ifndef EMULATE_BATCH_H
+#define EMULATE_BATCH_H
+
+#include "8080.h"
+
+// Runs many independent machines on a pool of worker threads.  Each
+// worker owns a deque of frame slices; a machine that just ran a frame
+// goes back on the same worker's deque so it stays on that core, and
+// idle workers steal from the other end of someone else's deque.
+typedef struct Batch8080 Batch8080;
+
+// nthreads <= 0 uses one worker per online CPU.  With pin set, worker i
+// is bound to CPU i.  Returns NULL on failure.
+Batch8080 *InitBatch8080(int nthreads, int pin);
+void FreeBatch8080(Batch8080 *batch);
+
+int BatchThreads8080(const Batch8080 *batch);
+
+// Runs `frames` frames on each of the `count` machines and returns when
+// all of them are done.  A machine that returns a non-zero status stops
+// early; its status is stored in status[i] when status isn't NULL.
+// Returns EMU_OK, or EMU_ERR_NOMEM if the per-run queues can't be sized.
+int RunBatch8080(Batch8080 *batch, State8080 **machines, int count,
+    int frames, int *status);
+
+#endif
@@ -0,0 +1,246 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "calls.h"
+
+Calls8080 *InitCalls8080(int max_nodes)
+{
+  if(max_nodes < 1)
+    max_nodes = 1;
+  Calls8080 *calls = calloc(1, sizeof(Calls8080));
+  if(calls == NULL)
+    return NULL;
+  calls->node = malloc(sizeof(CallNode8080) * max_nodes);
+  if(calls->node == NULL)
+  {
+    free(calls);
+    return NULL;
+  }
+  calls->max_nodes = max_nodes;
+  ResetCalls8080(calls);
+  return calls;
+}
+
+void FreeCalls8080(Calls8080 *calls)
+{
+  int i;
+  if(calls == NULL)
+    return;
+  for(i = 0; i < calls->nsym; i++)
+    free(calls->sym[i].name);
+  free(calls->sym);
+  free(calls->node);
+  free(calls);
+}
+
+void ResetCalls8080(Calls8080 *calls)
+{
+  CallNode8080 *root = &calls->node[0];
+  root->func = 0;
+  root->parent = -1;
+  root->child = root->sibling = -1;
+  root->calls = root->cycles = 0;
+  calls->nnodes = 1;
+  calls->depth = 0;
+  calls->current = 0;
+  calls->last = 0;
+  calls->lost = 0;
+}
+
+static int ParseAddr(const char *s, uint16_t *addr)
+{
+  char *end;
+  unsigned long v;
+  if(*s == '$')
+    s++;
+  if(!isxdigit((unsigned char)*s))
+    return 0;
+  v = strtoul(s, &end, 16);
+  if(*end == 'h' || *end == 'H')
+    end++;
+  if(*end != '\0' || v > 0xffff)
+    return 0;
+  *addr = v;
+  return 1;
+}
+
+static int BySymbol(const void *x, const void *y)
+{
+  const Symbol8080 *a = x, *b = y;
+  return (int)a->addr - (int)b->addr;
+}
+
+int LoadSymbols8080(Calls8080 *calls, const char *filename)
+{
+  char line[256];
+  int cap = calls->nsym;
+  FILE *f = fopen(filename, "r");
+  if(f == NULL)
+    return EMU_ERR_IO;
+
+  while(fgets(line, sizeof(line), f))
+  {
+    char *word[3];
+    char *name = NULL;
+    uint16_t addr;
+    int n = 0;
+    char *tok = strtok(line, " \t\r\n");
+    while(tok && n < 3 && *tok != ';')
+    {
+      word[n++] = tok;
+      tok = strtok(NULL, " \t\r\n");
+    }
+    if(n == 0 || word[0][0] == '#')
+      continue;
+    if(n == 2 && ParseAddr(word[0], &addr))
+      name = word[1];
+    else if(n == 3 && (strcmp(word[1], "=") == 0 || strcasecmp(word[1], "equ") == 0) &&
+        ParseAddr(word[2], &addr))
+      name = word[0];
+    if(name == NULL)
+      continue;
+
+    if(calls->nsym == cap)
+    {
+      cap = cap ? 2 * cap : 64;
+      Symbol8080 *sym = realloc(calls->sym, sizeof(Symbol8080) * cap);
+      if(sym == NULL)
+      {
+        fclose(f);
+        return EMU_ERR_NOMEM;
+      }
+      calls->sym = sym;
+    }
+    if((calls->sym[calls->nsym].name = strdup(name)) == NULL)
+    {
+      fclose(f);
+      return EMU_ERR_NOMEM;
+    }
+    calls->sym[calls->nsym++].addr = addr;
+  }
+  fclose(f);
+  qsort(calls->sym, calls->nsym, sizeof(Symbol8080), BySymbol);
+  return EMU_OK;
+}
+
+const char *SymbolName8080(const Calls8080 *calls, uint16_t addr, char buf[8])
+{
+  int lo = 0, hi = calls->nsym - 1;
+  while(lo <= hi)
+  {
+    int mid = (lo + hi) / 2;
+    if(calls->sym[mid].addr == addr)
+      return calls->sym[mid].name;
+    if(calls->sym[mid].addr < addr)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  snprintf(buf, 8, "$%04x", addr);
+  return buf;
+}
+
+// Inclusive cycles per node.  Children always come after their parent
+// in the node array, so one backward pass sums the tree.
+static uint64_t *Inclusive(const Calls8080 *calls)
+{
+  int i;
+  uint64_t *incl = malloc(sizeof(uint64_t) * calls->nnodes);
+  if(incl == NULL)
+    return NULL;
+  for(i = 0; i < calls->nnodes; i++)
+    incl[i] = calls->node[i].cycles;
+  for(i = calls->nnodes - 1; i > 0; i--)
+    incl[calls->node[i].parent] += incl[i];
+  return incl;
+}
+
+typedef struct Routine {
+  uint64_t calls;
+  uint64_t inclusive;
+  uint64_t exclusive;
+  int func;
+} Routine;
+
+static int ByInclusive(const void *x, const void *y)
+{
+  const Routine *a = x, *b = y;
+  if(a->inclusive != b->inclusive)
+    return a->inclusive < b->inclusive ? 1 : -1;
+  return a->func - b->func;
+}
+
+int WriteCallsText8080(const Calls8080 *calls, FILE *out, int top)
+{
+  const CallNode8080 *node = calls->node;
+  uint64_t *incl = Inclusive(calls);
+  Routine *r = calloc(0x10000, sizeof(Routine));
+  int i, n = 0;
+  char buf[8];
+
+  if(incl == NULL || r == NULL)
+  {
+    free(incl);
+    free(r);
+    return EMU_ERR_NOMEM;
+  }
+  for(i = 1; i < calls->nnodes; i++)
+  {
+    Routine *f = &r[node[i].func];
+    int up;
+    f->calls += node[i].calls;
+    f->exclusive += node[i].cycles;
+    // A recursive routine's inner contexts are already inside the
+    // outermost one's inclusive time.
+    for(up = node[i].parent; up > 0 && node[up].func != node[i].func; up = node[up].parent)
+      ;
+    if(up <= 0)
+      f->inclusive += incl[i];
+  }
+  for(i = 0; i < 0x10000; i++)
+    if(r[i].calls)
+    {
+      r[n] = r[i];
+      r[n].func = i;
+      n++;
+    }
+  qsort(r, n, sizeof(Routine), ByInclusive);
+  if(top > 0 && top < n)
+    n = top;
+
+  fprintf(out, "# %llu cycles, %d contexts, %llu calls not recorded\n\n",
+      (unsigned long long)incl[0], calls->nnodes, (unsigned long long)calls->lost);
+  fprintf(out, "       calls    inclusive    exclusive       %%  routine\n");
+  for(i = 0; i < n; i++)
+    fprintf(out, "%12llu %12llu %12llu  %6.2f  %s\n", (unsigned long long)r[i].calls,
+        (unsigned long long)r[i].inclusive, (unsigned long long)r[i].exclusive,
+        incl[0] ? 100.0 * r[i].inclusive / incl[0] : 0.0,
+        SymbolName8080(calls, r[i].func, buf));
+  free(r);
+  free(incl);
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
+
+int WriteCollapsed8080(const Calls8080 *calls, FILE *out)
+{
+  const CallNode8080 *node = calls->node;
+  int path[CALLS_DEPTH + 1];
+  int i;
+  char buf[8];
+
+  for(i = 0; i < calls->nnodes; i++)
+  {
+    int n = 0, up;
+    if(node[i].cycles == 0)
+      continue;
+    for(up = i; up > 0 && n < CALLS_DEPTH; up = node[up].parent)
+      path[n++] = up;
+    fprintf(out, "all");
+    while(n > 0)
+      fprintf(out, ";%s", SymbolName8080(calls, node[path[--n]].func, buf));
+    fprintf(out, " %llu\n", (unsigned long long)node[i].cycles);
+  }
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
@@ -0,0 +1,141 @@
+#ifndef EMULATE_CALLS_H
+#define EMULATE_CALLS_H
+
+#include <stdio.h>
+
+#include "8080.h"
+
+// Guest call graph.  Point state->calls at one of these and the
+// profiling variant of the core reports every taken CALL, Ccc, RST, RET
+// and Rcc to it.  Cycles are charged to a calling-context tree: one node
+// per distinct chain of callees, holding the cycles spent in that
+// routine itself.  Inclusive cycles are summed up the tree when a report
+// is written.
+//
+// Frames are matched to returns by stack address rather than return
+// address: a frame is closed as soon as sp moves above the slot its
+// return address was pushed to, so code that drops a return address
+// with POP, or reloads sp, doesn't leave stale frames behind.
+#define CALLS_DEPTH   256
+
+typedef struct CallNode8080 {
+  uint16_t func;        // entry address; 0 for the root
+  int parent;
+  int child;            // first child, -1 if none
+  int sibling;          // next child of parent, -1 if none
+  uint64_t calls;
+  uint64_t cycles;      // exclusive
+} CallNode8080;
+
+typedef struct CallFrame8080 {
+  int node;
+  uint16_t sp;          // where the return address was pushed
+} CallFrame8080;
+
+typedef struct Symbol8080 {
+  uint16_t addr;
+  char *name;
+} Symbol8080;
+
+typedef struct Calls8080 {
+  CallNode8080 *node;   // node[0] is the root
+  int nnodes;
+  int max_nodes;
+  CallFrame8080 stack[CALLS_DEPTH];
+  int depth;
+  int current;          // node being charged
+  uint64_t last;        // state->cycles at the last event
+  uint64_t lost;        // calls not recorded: tree full or stack too deep
+
+  Symbol8080 *sym;      // sorted by address
+  int nsym;
+} Calls8080;
+
+// max_nodes bounds the tree; calls into new contexts past it are
+// charged to the caller and counted in `lost`.  Cycles are counted from
+// state->cycles == 0; set `last` to state->cycles when attaching to a
+// machine that has already run.  Returns NULL on failure.
+Calls8080 *InitCalls8080(int max_nodes);
+void FreeCalls8080(Calls8080 *calls);
+// Empties the tree and the shadow stack; symbols are kept.
+void ResetCalls8080(Calls8080 *calls);
+
+// Reads a symbol map.  Each line is either "ADDR NAME" or "NAME = ADDR"
+// (also "NAME EQU ADDR"), with the address in hex, optionally written
+// $1a5c, 0x1a5c or 1a5ch.  Blank lines and lines starting with ';' or
+// '#' are skipped.  Returns EMU_OK, EMU_ERR_IO or EMU_ERR_NOMEM; lines
+// that don't parse are ignored.
+int LoadSymbols8080(Calls8080 *calls, const char *filename);
+// Name for a routine: its symbol if there is one, else "$xxxx".
+const char *SymbolName8080(const Calls8080 *calls, uint16_t addr, char buf[8]);
+
+// One line per routine: calls, inclusive and exclusive cycles, sorted
+// by inclusive cycles.  top <= 0 lists them all.
+int WriteCallsText8080(const Calls8080 *calls, FILE *out, int top);
+// Collapsed stacks ("main;a;b cycles"), one line per context, for
+// flamegraph.pl and compatible tools.
+int WriteCollapsed8080(const Calls8080 *calls, FILE *out);
+
+// Hooks used by the core.  `now` is state->cycles after the instruction.
+// Cycles since the last call or return are charged at the next one, or
+// when Run8080 returns; call Charge8080 yourself before writing a report
+// of a machine stepped with Emulate8080p.
+static inline void Charge8080(Calls8080 *calls, uint64_t now)
+{
+  calls->node[calls->current].cycles += now - calls->last;
+  calls->last = now;
+}
+
+static inline void Unwind8080(Calls8080 *calls, uint16_t sp)
+{
+  while(calls->depth > 0 && calls->stack[calls->depth - 1].sp < sp)
+    calls->depth--;
+  calls->current = calls->depth ? calls->stack[calls->depth - 1].node : 0;
+}
+
+// A call to `func` just pushed its return address at `sp`.
+static inline void EnterCall8080(Calls8080 *calls, uint16_t func, uint16_t sp, uint64_t now)
+{
+  CallNode8080 *node = calls->node;
+  int parent, n;
+
+  Charge8080(calls, now);
+  Unwind8080(calls, sp + 2);
+  parent = calls->current;
+  for(n = node[parent].child; n >= 0 && node[n].func != func; n = node[n].sibling)
+    ;
+  if(n < 0)
+  {
+    if(calls->nnodes == calls->max_nodes || calls->depth == CALLS_DEPTH)
+    {
+      calls->lost++;
+      return;
+    }
+    n = calls->nnodes++;
+    node[n].func = func;
+    node[n].parent = parent;
+    node[n].child = -1;
+    node[n].sibling = node[parent].child;
+    node[n].calls = node[n].cycles = 0;
+    node[parent].child = n;
+  }
+  else if(calls->depth == CALLS_DEPTH)
+  {
+    calls->lost++;
+    return;
+  }
+  node[n].calls++;
+  calls->stack[calls->depth].node = n;
+  calls->stack[calls->depth].sp = sp;
+  calls->depth++;
+  calls->current = n;
+}
+
+// A return just popped its address; sp is the new stack pointer.
+static inline void LeaveCall8080(Calls8080 *calls, uint16_t sp, uint64_t now)
+{
+  Charge8080(calls, now);
+  Unwind8080(calls, sp);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfg.h"
+
+#define LEADER(cfg, a)      ((cfg)->leader[(a) >> 3] & (1 << ((a) & 7)))
+#define SET_LEADER(cfg, a)  ((cfg)->leader[(a) >> 3] |= 1 << ((a) & 7))
+
+Cfg8080 *InitCfg8080(void)
+{
+  return calloc(1, sizeof(Cfg8080));
+}
+
+void FreeCfg8080(Cfg8080 *cfg)
+{
+  if(cfg == NULL)
+    return;
+  free(cfg->block);
+  free(cfg);
+}
+
+static int HasTarget(int flow)
+{
+  return flow == FLOW_JUMP || flow == FLOW_BRANCH || flow == FLOW_CALL ||
+      flow == FLOW_CCALL || flow == FLOW_RST;
+}
+
+static int FallsThrough(int flow)
+{
+  return flow != FLOW_JUMP && flow != FLOW_RET && flow != FLOW_PCHL;
+}
+
+static uint16_t Target(const uint8_t *code)
+{
+  if(opcodes8080[code[0]].flow == FLOW_RST)
+    return code[0] & 0x38;
+  return code[1] | (code[2] << 8);
+}
+
+// Decodes everything reachable from the worklist.
+static void Descend(Cfg8080 *cfg, const uint8_t *mem, int size, uint16_t *work, int top)
+{
+  while(top > 0)
+  {
+    int pc = work[--top];
+    SET_LEADER(cfg, pc);
+    while(pc < size && cfg->byte[pc] != BYTE_CODE)
+    {
+      const Opcode8080 *op = &opcodes8080[mem[pc]];
+      int i, len = op->size;
+      if(pc + len > size)
+        break;
+      for(i = 0; i < len && cfg->byte[pc + i] == BYTE_UNKNOWN; i++)
+        ;
+      if(i < len)
+      {
+        cfg->overlaps++;
+        break;
+      }
+      cfg->byte[pc] = BYTE_CODE;
+      for(i = 1; i < len; i++)
+        cfg->byte[pc + i] = BYTE_OPERAND;
+
+      if(HasTarget(op->flow))
+      {
+        uint16_t target = Target(&mem[pc]);
+        if(target < size)
+        {
+          SET_LEADER(cfg, target);
+          if(cfg->byte[target] != BYTE_CODE)
+            work[top++] = target;
+        }
+      }
+      if(op->flow == FLOW_PCHL)
+        cfg->indirect++;
+      if(!FallsThrough(op->flow))
+        break;
+      if(op->flow != FLOW_NEXT && pc + len < size)
+        SET_LEADER(cfg, pc + len);
+      pc += len;
+    }
+  }
+}
+
+static int AddBlock(Cfg8080 *cfg, uint16_t start)
+{
+  if(cfg->nblocks == cfg->cap)
+  {
+    int cap = cfg->cap ? 2 * cfg->cap : 256;
+    Block8080 *b = realloc(cfg->block, sizeof(Block8080) * cap);
+    if(b == NULL)
+      return -1;
+    cfg->block = b;
+    cfg->cap = cap;
+  }
+  Block8080 *b = &cfg->block[cfg->nblocks];
+  b->start = b->end = b->last = start;
+  b->flow = FLOW_NEXT;
+  b->next = b->target = -1;
+  return cfg->nblocks++;
+}
+
+int AnalyzeCfg8080(Cfg8080 *cfg, const uint8_t *mem, int size,
+    const uint16_t *entries, int nentries)
+{
+  static const uint16_t vectors[] = { 0x00, 0x08, 0x10, 0x18, 0x20, 0x28, 0x30, 0x38 };
+  int i, pc, cur = -1;
+
+  if(size > 0x10000)
+    size = 0x10000;
+  if(entries == NULL)
+  {
+    entries = vectors;
+    nentries = 8;
+  }
+  memset(cfg->byte, 0, sizeof(cfg->byte));
+  memset(cfg->leader, 0, sizeof(cfg->leader));
+  cfg->nblocks = 0;
+  cfg->overlaps = 0;
+  cfg->indirect = 0;
+
+  // Every instruction pushes at most one target.
+  uint16_t *work = malloc(sizeof(uint16_t) * (size + nentries + 1));
+  if(work == NULL)
+    return EMU_ERR_NOMEM;
+  int top = 0;
+  for(i = nentries - 1; i >= 0; i--)
+    if(entries[i] < size)
+      work[top++] = entries[i];
+  Descend(cfg, mem, size, work, top);
+  free(work);
+
+  for(pc = 0; pc < size; pc++)
+  {
+    if(cfg->byte[pc] != BYTE_CODE)
+    {
+      if(cfg->byte[pc] == BYTE_UNKNOWN)
+        cur = -1;
+      continue;
+    }
+    if(cur < 0 || LEADER(cfg, pc))
+      if((cur = AddBlock(cfg, pc)) < 0)
+        return EMU_ERR_NOMEM;
+    Block8080 *b = &cfg->block[cur];
+    b->last = pc;
+    b->end = pc + opcodes8080[mem[pc]].size;
+    b->flow = opcodes8080[mem[pc]].flow;
+    if(b->flow != FLOW_NEXT)
+      cur = -1;
+  }
+
+  for(i = 0; i < cfg->nblocks; i++)
+  {
+    Block8080 *b = &cfg->block[i];
+    if(FallsThrough(b->flow) && b->end < size && cfg->byte[b->end] == BYTE_CODE)
+      b->next = FindBlock8080(cfg, b->end);
+    if(HasTarget(b->flow))
+    {
+      uint16_t target = Target(&mem[b->last]);
+      int t = (target < size) ? FindBlock8080(cfg, target) : -1;
+      if(t >= 0 && cfg->block[t].start == target)
+        b->target = t;
+    }
+  }
+  return EMU_OK;
+}
+
+int FindBlock8080(const Cfg8080 *cfg, uint16_t addr)
+{
+  int lo = 0, hi = cfg->nblocks - 1;
+  while(lo <= hi)
+  {
+    int mid = (lo + hi) / 2;
+    const Block8080 *b = &cfg->block[mid];
+    if(addr < b->start)
+      hi = mid - 1;
+    else if(addr >= b->end)
+      lo = mid + 1;
+    else
+      return mid;
+  }
+  return -1;
+}
+
+int WriteListing8080(const Cfg8080 *cfg, const uint8_t *mem, int size, FILE *out)
+{
+  int pc = 0;
+  if(size > 0x10000)
+    size = 0x10000;
+  while(pc < size)
+  {
+    if(cfg->byte[pc] == BYTE_CODE)
+    {
+      char text[32];
+      int len = opcodes8080[mem[pc]].size;
+      // An instruction cut off by the end of the image is listed as a
+      // byte of data rather than disassembled from past the end.
+      if(pc + len > size)
+      {
+        snprintf(text, sizeof(text), "DB     $%02x", mem[pc]);
+        len = 1;
+      }
+      else
+        Disassemble8080s(text, sizeof(text), &mem[pc]);
+      if(LEADER(cfg, pc))
+        fprintf(out, "\nL%04x:\n", pc);
+      fprintf(out, "%04x    %s\n", pc, text);
+      pc += len;
+      continue;
+    }
+    // A run of up to 8 data bytes.
+    int n = 0;
+    fprintf(out, "%04x    DB     ", pc);
+    while(pc < size && cfg->byte[pc] != BYTE_CODE && n < 8)
+    {
+      fprintf(out, "%s$%02x", n ? "," : "", mem[pc]);
+      pc++;
+      n++;
+    }
+    fprintf(out, "\n");
+  }
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
+
+int WriteCfgDot8080(const Cfg8080 *cfg, FILE *out)
+{
+  int i;
+  fprintf(out, "digraph cfg {\n  node [shape=box fontname=monospace];\n");
+  for(i = 0; i < cfg->nblocks; i++)
+  {
+    const Block8080 *b = &cfg->block[i];
+    fprintf(out, "  b%04x [label=\"%04x-%04x\"];\n", b->start, b->start, b->end - 1);
+  }
+  for(i = 0; i < cfg->nblocks; i++)
+  {
+    const Block8080 *b = &cfg->block[i];
+    int call = (b->flow == FLOW_CALL || b->flow == FLOW_CCALL || b->flow == FLOW_RST);
+    if(b->next >= 0)
+      fprintf(out, "  b%04x -> b%04x;\n", b->start, cfg->block[b->next].start);
+    if(b->target >= 0)
+      fprintf(out, "  b%04x -> b%04x [style=%s];\n", b->start, cfg->block[b->target].start,
+          call ? "dashed" : "bold");
+  }
+  fprintf(out, "}\n");
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
@@ -0,0 +1,59 @@
+#ifndef EMULATE_CFG_H
+#define EMULATE_CFG_H
+
+#include <stdio.h>
+
+#include "8080.h"
+
+// Static analysis of a ROM image.  Starting from the entry points, code
+// is followed by recursive descent: jumps, branches, calls and RSTs are
+// chased, and every call is assumed to return.  Bytes never reached are
+// taken as data.  The code found is split into basic blocks, each
+// linked to the block it falls into and the block it jumps or calls to,
+// which is what a block compiler needs to know ahead of time.
+enum {
+  BYTE_UNKNOWN = 0,     // not reached: data, or code only reached indirectly
+  BYTE_CODE,            // first byte of an instruction
+  BYTE_OPERAND,         // later byte of an instruction
+};
+
+typedef struct Block8080 {
+  uint16_t start;
+  uint16_t end;         // one past the last byte
+  uint16_t last;        // address of the last instruction
+  uint8_t flow;         // FLOW_* of the last instruction
+  int next;             // block it falls through or returns to, or -1
+  int target;           // block it jumps, branches or calls to, or -1
+} Block8080;
+
+typedef struct Cfg8080 {
+  uint8_t byte[0x10000];          // BYTE_* per address
+  uint8_t leader[0x10000 / 8];    // a block starts here
+  Block8080 *block;               // sorted by address
+  int nblocks;
+  int cap;
+  int overlaps;         // jumps into the middle of a decoded instruction
+  int indirect;         // PCHLs, whose targets aren't followed
+} Cfg8080;
+
+// Returns NULL if allocation fails.
+Cfg8080 *InitCfg8080(void);
+void FreeCfg8080(Cfg8080 *cfg);
+
+// Analyses mem[0..size).  With entries NULL the entry points are reset
+// and the eight RST vectors.  Targets at or past size (RAM) aren't
+// followed.  Returns EMU_OK or EMU_ERR_NOMEM.
+int AnalyzeCfg8080(Cfg8080 *cfg, const uint8_t *mem, int size,
+    const uint16_t *entries, int nentries);
+
+// Block starting at or containing addr, or -1.
+int FindBlock8080(const Cfg8080 *cfg, uint16_t addr);
+
+// Code disassembled, with a label at every block start; everything else
+// as DB lines.
+int WriteListing8080(const Cfg8080 *cfg, const uint8_t *mem, int size, FILE *out);
+// The block graph in Graphviz dot format.  Fall-through edges are
+// solid, jumps bold and calls dashed.
+int WriteCfgDot8080(const Cfg8080 *cfg, FILE *out);
+
+#endif
@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cover.h"
+
+#define COVER_VERSION  1
+
+// Leading fields of the file; the pc bitmap follows, then the edge
+// bitmap if flags has COVER_FILE_EDGES.
+typedef struct CoverFile {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t flags;
+  uint32_t words;
+} CoverFile;
+
+enum {
+  COVER_FILE_EDGES = 1,
+};
+
+Cover8080 *InitCover8080(int edges)
+{
+  Cover8080 *cover = calloc(1, sizeof(Cover8080));
+  if(cover)
+    cover->edges = edges;
+  return cover;
+}
+
+void FreeCover8080(Cover8080 *cover)
+{
+  free(cover);
+}
+
+void ResetCover8080(Cover8080 *cover)
+{
+  memset(cover->pc, 0, sizeof(cover->pc));
+  memset(cover->edge, 0, sizeof(cover->edge));
+  cover->prev = 0;
+  cover->resets++;
+}
+
+void MergeCover8080(Cover8080 *dst, const Cover8080 *src)
+{
+  int i;
+  for(i = 0; i < COVER_WORDS; i++)
+    dst->pc[i] |= src->pc[i];
+  if(dst->edges && src->edges)
+    for(i = 0; i < COVER_WORDS; i++)
+      dst->edge[i] |= src->edge[i];
+}
+
+int CountCover8080(const Cover8080 *cover, int *edges)
+{
+  int i, n = 0, e = 0;
+  for(i = 0; i < COVER_WORDS; i++)
+  {
+    n += __builtin_popcountll(cover->pc[i]);
+    e += __builtin_popcountll(cover->edge[i]);
+  }
+  if(edges)
+    *edges = e;
+  return n;
+}
+
+int WriteCover8080(const Cover8080 *cover, FILE *out)
+{
+  CoverFile h = { COVER_MAGIC, COVER_VERSION, cover->edges ? COVER_FILE_EDGES : 0, COVER_WORDS };
+  if(fwrite(&h, sizeof(h), 1, out) != 1 || fwrite(cover->pc, sizeof(cover->pc), 1, out) != 1)
+    return EMU_ERR_IO;
+  if(cover->edges && fwrite(cover->edge, sizeof(cover->edge), 1, out) != 1)
+    return EMU_ERR_IO;
+  return EMU_OK;
+}
+
+int ReadCover8080(Cover8080 *cover, FILE *in)
+{
+  CoverFile h;
+  if(fread(&h, sizeof(h), 1, in) != 1)
+    return EMU_ERR_IO;
+  if(h.magic != COVER_MAGIC || h.version != COVER_VERSION || h.words != COVER_WORDS)
+    return EMU_ERR_FORMAT;
+  ResetCover8080(cover);
+  cover->edges = (h.flags & COVER_FILE_EDGES) != 0;
+  if(fread(cover->pc, sizeof(cover->pc), 1, in) != 1)
+    return EMU_ERR_FORMAT;
+  if(cover->edges && fread(cover->edge, sizeof(cover->edge), 1, in) != 1)
+    return EMU_ERR_FORMAT;
+  return EMU_OK;
+}
+
+// Instructions in the block, and how many of them ran.
+static void BlockCount(const Cover8080 *cover, const Block8080 *b, const uint8_t *mem,
+    int *ran, int *total)
+{
+  int pc = b->start;
+  *ran = *total = 0;
+  while(pc < b->end)
+  {
+    *ran += Covered8080(cover, pc);
+    (*total)++;
+    pc += opcodes8080[mem[pc]].size;
+  }
+}
+
+int WriteCoverListing8080(const Cover8080 *cover, const Cfg8080 *cfg,
+    const uint8_t *mem, int start, int size, FILE *out)
+{
+  int pc = start, ran, total;
+  if(size > 0x10000)
+    size = 0x10000;
+  ran = CountCover8080(cover, &total);
+  fprintf(out, "; %d addresses executed", ran);
+  if(cover->edges)
+    fprintf(out, ", %d edges", total);
+  fprintf(out, "\n");
+
+  while(pc < size)
+  {
+    int run = Covered8080(cover, pc);
+    if(run || cfg == NULL || cfg->byte[pc] == BYTE_CODE)
+    {
+      char text[32];
+      int len = opcodes8080[mem[pc]].size;
+      int b;
+      // An instruction cut off by the end of the image is listed as a
+      // byte of data rather than disassembled from past the end.
+      if(pc + len > size)
+      {
+        snprintf(text, sizeof(text), "DB     $%02x", mem[pc]);
+        len = 1;
+      }
+      else
+        Disassemble8080s(text, sizeof(text), &mem[pc]);
+      if(cfg && cfg->byte[pc] == BYTE_CODE && (cfg->leader[pc >> 3] & (1 << (pc & 7))) &&
+          (b = FindBlock8080(cfg, pc)) >= 0)
+      {
+        BlockCount(cover, &cfg->block[b], mem, &ran, &total);
+        fprintf(out, "\nL%04x:%*s; %d/%d\n", pc, 26, "", ran, total);
+      }
+      fprintf(out, "%c %04x    %s\n", run ? '*' : ' ', pc, text);
+      pc += len;
+      continue;
+    }
+    int n = 0;
+    fprintf(out, "  %04x    DB     ", pc);
+    while(pc < size && !Covered8080(cover, pc) && cfg->byte[pc] != BYTE_CODE && n < 8)
+    {
+      fprintf(out, "%s$%02x", n ? "," : "", mem[pc]);
+      pc++;
+      n++;
+    }
+    fprintf(out, "\n");
+  }
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
@@ -0,0 +1,76 @@
+#ifndef EMULATE_COVER_H
+#define EMULATE_COVER_H
+
+#include <stdio.h>
+
+#include "8080.h"
+#include "cfg.h"
+
+// Guest code coverage: one bit per address an instruction started at,
+// and optionally AFL-style edge bits.  Point state->cover at one of
+// these and the core switches to a variant that sets them, or, on a
+// tiered machine, marks each block's addresses the first time it runs
+// them; with state->cover NULL the plain core has no coverage code in
+// it.
+//
+// Edges are recorded only where control leaves the straight line (a
+// jump, call or return taken, an RST, an interrupt), which is where a
+// new basic block is entered.  The edge bit is hash(block) ^ prev, with
+// prev = hash(previous block) >> 1 as AFL does, so A->B and B->A differ
+// and a tight loop doesn't collide with itself.
+#define COVER_WORDS  (0x10000 / 64)
+#define COVER_MAGIC  0x56433830u   // "08CV" read little-endian
+
+typedef struct Cover8080 {
+  uint64_t pc[COVER_WORDS];
+  uint64_t edge[COVER_WORDS];
+  int edges;                // record edges as well
+  uint16_t prev;
+  uint32_t resets;          // times the bits were cleared (tier.h)
+} Cover8080;
+
+// Returns a zeroed bitmap, or NULL if allocation fails.
+Cover8080 *InitCover8080(int edges);
+void FreeCover8080(Cover8080 *cover);
+void ResetCover8080(Cover8080 *cover);
+
+// Used by the core.
+static inline void CoverPc8080(Cover8080 *cover, uint16_t pc)
+{
+  cover->pc[pc >> 6] |= 1ull << (pc & 63);
+}
+
+static inline void CoverEdge8080(Cover8080 *cover, uint16_t to)
+{
+  uint16_t cur = (uint16_t)(to * 40503u);   // scatter nearby addresses
+  uint16_t e = cur ^ cover->prev;
+  cover->edge[e >> 6] |= 1ull << (e & 63);
+  cover->prev = cur >> 1;
+}
+
+static inline int Covered8080(const Cover8080 *cover, uint16_t pc)
+{
+  return cover->pc[pc >> 6] >> (pc & 63) & 1;
+}
+
+// ORs src into dst.  Edges are merged only if both record them.
+void MergeCover8080(Cover8080 *dst, const Cover8080 *src);
+
+// Set bits: addresses, and edges in *edges if it isn't NULL.
+int CountCover8080(const Cover8080 *cover, int *edges);
+
+// A small header and the bitmaps, so runs in other processes can be
+// merged.  Read returns EMU_ERR_FORMAT for anything else.
+int WriteCover8080(const Cover8080 *cover, FILE *out);
+int ReadCover8080(Cover8080 *cover, FILE *in);
+
+// Listing of mem[start..size) with every instruction that ran marked
+// '*'.
+// With a cfg (cfg.h), bytes it found to be code but that never ran are
+// listed as unexecuted instructions and the rest as data; without one
+// everything that didn't run is disassembled in a straight line.  Each
+// block label gets its executed/total instruction count.
+int WriteCoverListing8080(const Cover8080 *cover, const Cfg8080 *cfg,
+    const uint8_t *mem, int start, int size, FILE *out);
+
+#endif
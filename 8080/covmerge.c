@@ -0,0 +1,128 @@
+// Merges coverage files written by WriteCover8080 (main -C):
+//
+//   covmerge out.cov in.cov... [-o offset] [-l rom listing.txt]
+//
+// ORs the inputs into out.cov and prints what they cover between them.
+// With -l it also writes listing.txt, the ROM's disassembly with every
+// instruction that ran marked and per-block counts.  -o gives the
+// address the image was loaded at, 0x100 for a CP/M program run with
+// emu -c; the listing then starts there, as does the analysis.
+//
+// Exits with 1 if any input couldn't be read or any output written.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "8080.h"
+#include "cfg.h"
+#include "cover.h"
+
+static int Listing(const Cover8080 *cover, const char *rom, uint16_t offset, const char *path)
+{
+  static uint8_t mem[0x10000];
+  FILE *f;
+  long size;
+  Cfg8080 *cfg;
+  int status;
+
+  if((f = fopen(rom, "rb")) == NULL)
+    return EMU_ERR_IO;
+  size = offset + (long)fread(&mem[offset], 1, offset ? 0x10000 - offset : RAM_BASE, f);
+  fclose(f);
+  if((cfg = InitCfg8080()) == NULL)
+    return EMU_ERR_NOMEM;
+  // A ROM starts at the reset and RST vectors, a loaded program at its
+  // first byte.
+  if((status = offset ? AnalyzeCfg8080(cfg, mem, size, &offset, 1) :
+      AnalyzeCfg8080(cfg, mem, size, NULL, 0)) == EMU_OK)
+  {
+    if((f = fopen(path, "w")) == NULL)
+      status = EMU_ERR_IO;
+    else
+    {
+      status = WriteCoverListing8080(cover, cfg, mem, offset, size, f);
+      if(fclose(f) != 0)
+        status = EMU_ERR_IO;
+    }
+  }
+  FreeCfg8080(cfg);
+  return status;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *rom = NULL, *listing = NULL;
+  Cover8080 *total, *one;
+  uint16_t offset = 0;
+  int i, inputs = 0, edges, failed = 0;
+  FILE *f;
+
+  if(argc < 3)
+  {
+    printf("usage: %s out.cov in.cov... [-o offset] [-l rom listing.txt]\n", argv[0]);
+    return 1;
+  }
+  total = InitCover8080(1);
+  one = InitCover8080(0);
+  if(total == NULL || one == NULL)
+  {
+    printf("Error: %s\n", StatusString8080(EMU_ERR_NOMEM));
+    return 1;
+  }
+
+  for(i = 2; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-l") == 0 && i + 2 < argc)
+    {
+      rom = argv[++i];
+      listing = argv[++i];
+      continue;
+    }
+    if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+    {
+      offset = (uint16_t)strtol(argv[++i], NULL, 0);
+      continue;
+    }
+    if((f = fopen(argv[i], "rb")) == NULL || ReadCover8080(one, f) != EMU_OK)
+    {
+      printf("Error: couldn't read %s\n", argv[i]);
+      failed = 1;
+    }
+    else
+    {
+      // The result keeps edges only if every input has them.
+      total->edges &= one->edges;
+      MergeCover8080(total, one);
+      inputs++;
+    }
+    if(f)
+      fclose(f);
+  }
+
+  int pcs = CountCover8080(total, &edges);
+  printf("%d inputs, %d addresses", inputs, pcs);
+  if(total->edges)
+    printf(", %d edges", edges);
+  printf("\n");
+
+  int status = EMU_ERR_IO;
+  if((f = fopen(argv[1], "wb")) != NULL)
+  {
+    status = WriteCover8080(total, f);
+    if(fclose(f) != 0)
+      status = EMU_ERR_IO;
+  }
+  if(status != EMU_OK)
+  {
+    printf("Error: couldn't write %s\n", argv[1]);
+    failed = 1;
+  }
+  if(rom && Listing(total, rom, offset, listing) != EMU_OK)
+  {
+    printf("Error: couldn't write %s\n", listing);
+    failed = 1;
+  }
+  FreeCover8080(one);
+  FreeCover8080(total);
+  return failed;
+}
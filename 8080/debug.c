@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "tier.h"
+
+Debug8080 *InitDebug8080(void)
+{
+  return calloc(1, sizeof(Debug8080));
+}
+
+void FreeDebug8080(Debug8080 *debug)
+{
+  if(debug == NULL)
+    return;
+  ClearDebug8080(debug);
+  free(debug);
+}
+
+// The saved write pointers stay: they go back to the machine on the
+// next SyncDebug8080.
+void ClearDebug8080(Debug8080 *debug)
+{
+  int i;
+  for(i = 0; i < PAGES; i++)
+  {
+    free(debug->bp[i]);
+    free(debug->watch[i]);
+    debug->bp[i] = debug->watch[i] = NULL;
+  }
+  memset(debug->bp_count, 0, sizeof(debug->bp_count));
+  memset(debug->watch_count, 0, sizeof(debug->watch_count));
+  memset(debug->read_count, 0, sizeof(debug->read_count));
+  debug->reads = 0;
+  debug->resume = 0;
+  memset(&debug->stop, 0, sizeof(debug->stop));
+  debug->dirty = 1;
+}
+
+// A pointer given back to a page the tier is guarding goes to the tier,
+// which hands it out when the page's blocks are thrown away.
+static void GiveBack(State8080 *state, int page)
+{
+  Debug8080 *debug = state->debug;
+  if(state->tier && TierGuarded8080(state->tier, page))
+    state->tier->saved[page] = debug->saved[page];
+  else
+    state->wpage[page] = debug->saved[page];
+  debug->saved[page] = NULL;
+}
+
+void SyncDebug8080(State8080 *state)
+{
+  Debug8080 *debug = state->debug;
+  int i;
+  if(!debug->dirty)
+    return;
+  for(i = 0; i < PAGES; i++)
+  {
+    if(debug->watch[i] && state->wpage[i])
+    {
+      debug->saved[i] = state->wpage[i];
+      state->wpage[i] = NULL;
+    }
+    else if(debug->watch[i] == NULL && debug->saved[i])
+      GiveBack(state, i);
+  }
+  debug->dirty = 0;
+}
+
+void DetachDebug8080(State8080 *state)
+{
+  int i;
+  if(state->debug == NULL)
+    return;
+  for(i = 0; i < PAGES; i++)
+    if(state->debug->saved[i])
+      GiveBack(state, i);
+  // Attached again, it has to take the watched pages' pointers afresh.
+  state->debug->dirty = 1;
+  state->debug = NULL;
+}
+
+void ForgetWatchedPages8080(Debug8080 *debug)
+{
+  memset(debug->saved, 0, sizeof(debug->saved));
+}
+
+// Per-byte maps are allocated for a page when its first flag is set and
+// freed with its last, so the page goes back to the fast path.
+static uint8_t *PageMap(uint8_t **map, int page)
+{
+  if(map[page] == NULL)
+    map[page] = calloc(1, PAGE_SIZE);
+  return map[page];
+}
+
+static void DropMap(uint8_t **map, uint16_t *count, int page)
+{
+  if(map[page] && count[page] == 0)
+  {
+    free(map[page]);
+    map[page] = NULL;
+  }
+}
+
+int SetBreakpoint8080(Debug8080 *debug, uint16_t addr)
+{
+  int page = addr >> 8;
+  uint8_t *bp = PageMap(debug->bp, page);
+  if(bp == NULL)
+    return EMU_ERR_NOMEM;
+  if(!bp[addr & 0xff])
+  {
+    bp[addr & 0xff] = 1;
+    debug->bp_count[page]++;
+  }
+  return EMU_OK;
+}
+
+void ClearBreakpoint8080(Debug8080 *debug, uint16_t addr)
+{
+  int page = addr >> 8;
+  uint8_t *bp = debug->bp[page];
+  if(bp == NULL || !bp[addr & 0xff])
+    return;
+  bp[addr & 0xff] = 0;
+  debug->bp_count[page]--;
+  DropMap(debug->bp, debug->bp_count, page);
+}
+
+int SetWatchpoint8080(Debug8080 *debug, uint16_t addr, int len, int kind)
+{
+  kind &= WATCH_READ | WATCH_WRITE;
+  for(; len > 0 && kind; len--, addr++)
+  {
+    int page = addr >> 8;
+    uint8_t *w = PageMap(debug->watch, page);
+    if(w == NULL)
+      return EMU_ERR_NOMEM;
+    if(w[addr & 0xff] == 0)
+    {
+      debug->watch_count[page]++;
+      debug->dirty = 1;
+    }
+    if((kind & WATCH_READ) && !(w[addr & 0xff] & WATCH_READ))
+    {
+      debug->read_count[page]++;
+      debug->reads++;
+    }
+    w[addr & 0xff] |= kind;
+  }
+  return EMU_OK;
+}
+
+void ClearWatchpoint8080(Debug8080 *debug, uint16_t addr, int len, int kind)
+{
+  for(; len > 0; len--, addr++)
+  {
+    int page = addr >> 8;
+    uint8_t *w = debug->watch[page];
+    if(w == NULL || w[addr & 0xff] == 0)
+      continue;
+    if(kind & w[addr & 0xff] & WATCH_READ)
+    {
+      debug->read_count[page]--;
+      debug->reads--;
+    }
+    w[addr & 0xff] &= ~kind;
+    if(w[addr & 0xff] == 0)
+    {
+      debug->watch_count[page]--;
+      DropMap(debug->watch, debug->watch_count, page);
+      debug->dirty = 1;
+    }
+  }
+}
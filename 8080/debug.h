@@ -0,0 +1,111 @@
+#ifndef EMULATE_DEBUG_H
+#define EMULATE_DEBUG_H
+
+#include "8080.h"
+
+// Execution breakpoints and memory watchpoints.  Point state->debug at
+// one of these and Run8080/Emulate8080p honour it; with state->debug
+// NULL nothing is checked at all.
+//
+// Both live in tables parallel to the page table, and only pages that
+// have one cost anything:
+//  - A page with a watchpoint loses its write pointer, as a COW or
+//    translated page does, so guest stores to it come through
+//    WriteSlow8080, which checks the map.  The pointer is kept in
+//    `saved` until the page has no watchpoint left.
+//  - The debug variant of the core runs only on pages with a
+//    breakpoint; elsewhere the machine keeps its usual core, tiered
+//    blocks included, except that a block on such a page isn't entered.
+//  - A read can't be trapped, so while any read watchpoint is set the
+//    address an instruction reads is worked out before it runs, and
+//    only one that reads a page with a read watchpoint goes through the
+//    debug variant, inside a tiered block as well.
+//
+// A breakpoint stops before the instruction at its address runs; a
+// watchpoint stops after the instruction that touched the byte.  Either
+// way the run returns EMU_BREAK with the reason in `stop`.  Running
+// again continues: a breakpoint doesn't fire twice in a row at the
+// same pc.
+//
+// A Debug8080 belongs to one machine: the pages it holds the write
+// pointer of are that machine's.  DetachDebug8080 gives them back.
+enum {
+  WATCH_READ  = 1,
+  WATCH_WRITE = 2,
+};
+
+enum {
+  STOP_NONE = 0,
+  STOP_BREAK,
+  STOP_READ,
+  STOP_WRITE,
+};
+
+typedef struct Stop8080 {
+  int reason;           // STOP_*
+  uint16_t pc;          // breakpoint, or instruction that hit the watch
+  uint16_t addr;        // watched byte
+  uint8_t value;        // byte read or written
+} Stop8080;
+
+typedef struct Debug8080 {
+  uint8_t *bp[PAGES];       // 256 flags per page, or NULL
+  uint8_t *watch[PAGES];    // WATCH_* per byte, or NULL
+  uint16_t bp_count[PAGES];
+  uint16_t watch_count[PAGES];
+  uint16_t read_count[PAGES];   // bytes with a read watchpoint
+  uint8_t *saved[PAGES];    // write pointers taken off watched pages
+  int reads;                // bytes with a read watchpoint
+  int dirty;                // watchpoints changed since SyncDebug8080
+  int resume;           // pc + 1 of the breakpoint just reported, or 0
+  Stop8080 stop;
+} Debug8080;
+
+// Returns an empty set, or NULL if allocation fails.
+Debug8080 *InitDebug8080(void);
+void FreeDebug8080(Debug8080 *debug);
+
+// Return EMU_OK or EMU_ERR_NOMEM.
+int SetBreakpoint8080(Debug8080 *debug, uint16_t addr);
+void ClearBreakpoint8080(Debug8080 *debug, uint16_t addr);
+// Watches `len` bytes from addr for the WATCH_* bits in `kind`.
+int SetWatchpoint8080(Debug8080 *debug, uint16_t addr, int len, int kind);
+void ClearWatchpoint8080(Debug8080 *debug, uint16_t addr, int len, int kind);
+void ClearDebug8080(Debug8080 *debug);
+
+// Takes the write pointer off every page that got a watchpoint since
+// the last call, and gives it back to those that lost their last one.
+// The core calls it before it runs.
+void SyncDebug8080(State8080 *state);
+// Gives back every write pointer and sets state->debug to NULL.
+void DetachDebug8080(State8080 *state);
+// Forgets the saved write pointers; Fork8080 calls it because the pages
+// behind them are now shared.
+void ForgetWatchedPages8080(Debug8080 *debug);
+
+// Used by the core.
+static inline int BreakAt8080(Debug8080 *debug, uint16_t pc)
+{
+  const uint8_t *bp = debug->bp[pc >> 8];
+  int resume = debug->resume;
+  debug->resume = 0;
+  debug->stop.reason = STOP_NONE;
+  if(bp == NULL || !bp[pc & 0xff] || resume == pc + 1)
+    return 0;
+  debug->resume = pc + 1;
+  debug->stop.reason = STOP_BREAK;
+  debug->stop.pc = pc;
+  return 1;
+}
+
+static inline void Watched8080(Debug8080 *debug, uint16_t addr, uint8_t value, int kind)
+{
+  const uint8_t *w = debug->watch[addr >> 8];
+  if(w == NULL || !(w[addr & 0xff] & kind) || debug->stop.reason != STOP_NONE)
+    return;
+  debug->stop.reason = (kind == WATCH_READ) ? STOP_READ : STOP_WRITE;
+  debug->stop.addr = addr;
+  debug->stop.value = value;
+}
+
+#endif
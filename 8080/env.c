@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "env.h"
+
+struct Env8080 {
+  State8080 *parent;        // holds the ROM; never run
+  State8080 **machines;
+  int count;
+  int obs;
+  Batch8080 *batch;
+  int *status;
+  int32_t *last_score;
+  uint8_t *playing;         // the machine has been seen in a game
+  SaveImage8080 reset;
+};
+
+static inline uint8_t Peek(const State8080 *state, uint16_t addr)
+{
+  return state->rpage[addr >> 8][addr & 0xff];
+}
+
+static int32_t Bcd(uint8_t b)
+{
+  return (b >> 4) * 10 + (b & 0xf);
+}
+
+static int32_t Score(const State8080 *state)
+{
+  return Bcd(Peek(state, ENV_SCORE_ADDR + 1)) * 100 + Bcd(Peek(state, ENV_SCORE_ADDR));
+}
+
+// Lit pixels out of four, scaled to 0..255, indexed by two bits of one
+// column in bits 0-1 and the same two bits of the next column in 2-3.
+static const uint8_t kGray[16] = {
+  0, 64, 64, 128, 64, 128, 128, 191, 64, 128, 128, 191, 128, 191, 191, 255,
+};
+
+// Byte i of column x holds upright rows 255 - 8i down to 248 - 8i, so
+// bits 2k and 2k+1 are the two rows of output row 127 - 4i - k.
+static void WriteGray(const State8080 *state, uint8_t *out)
+{
+  int x, i, k;
+  for(x = 0; x < VRAM_SIZE / 32; x += 2)
+  {
+    uint16_t addr = VRAM_BASE + x * 32;
+    // A column is 32 bytes, so both columns sit in one page.
+    const uint8_t *a = &state->rpage[addr >> 8][addr & 0xff];
+    const uint8_t *b = a + 32;
+    uint8_t *o = &out[127 * ENV_GRAY_WIDTH + x / 2];
+    for(i = 0; i < 32; i++)
+      for(k = 0; k < 4; k++, o -= ENV_GRAY_WIDTH)
+        *o = kGray[(a[i] >> 2 * k & 3) | (b[i] >> 2 * k & 3) << 2];
+  }
+}
+
+static void WriteObs(const Env8080 *env, const State8080 *state, uint8_t *out)
+{
+  if(env->obs == ENV_OBS_VRAM)
+    ReadBlock8080(state, VRAM_BASE, out, VRAM_SIZE);
+  else if(env->obs == ENV_OBS_GRAY)
+    WriteGray(state, out);
+}
+
+static void Reset(Env8080 *env, int i)
+{
+  State8080 *state = env->machines[i];
+  LoadState8080(state, &env->reset, sizeof(env->reset));
+  state->fault = EMU_OK;
+  env->last_score[i] = Score(state);
+  env->playing[i] = Peek(state, ENV_MODE_ADDR) != 0;
+}
+
+Env8080 *InitEnv8080(const char *rom, int count, int obs, Batch8080 *batch)
+{
+  Env8080 *env;
+  int i;
+  if(count <= 0 || (env = calloc(1, sizeof(Env8080))) == NULL)
+    return NULL;
+  env->count = count;
+  env->obs = obs;
+  env->batch = batch;
+  env->machines = calloc(count, sizeof(State8080 *));
+  env->status = calloc(count, sizeof(int));
+  env->last_score = calloc(count, sizeof(int32_t));
+  env->playing = calloc(count, 1);
+  if(env->machines == NULL || env->status == NULL || env->last_score == NULL ||
+      env->playing == NULL || (env->parent = Init8080()) == NULL ||
+      ReadFile(env->parent, rom, 0) != EMU_OK)
+    goto fail;
+  SaveState8080(env->parent, &env->reset, sizeof(env->reset));
+  for(i = 0; i < count; i++)
+  {
+    if((env->machines[i] = Fork8080(env->parent)) == NULL)
+      goto fail;
+    Reset(env, i);
+  }
+  return env;
+
+fail:
+  FreeEnv8080(env);
+  return NULL;
+}
+
+void FreeEnv8080(Env8080 *env)
+{
+  int i;
+  if(env == NULL)
+    return;
+  if(env->machines)
+    for(i = 0; i < env->count; i++)
+      if(env->machines[i])
+        Free8080(env->machines[i]);
+  if(env->parent)
+    Free8080(env->parent);
+  free(env->machines);
+  free(env->status);
+  free(env->last_score);
+  free(env->playing);
+  free(env);
+}
+
+int EnvCount8080(const Env8080 *env)
+{
+  return env->count;
+}
+
+size_t EnvObsSize8080(const Env8080 *env)
+{
+  switch(env->obs)
+  {
+  case ENV_OBS_VRAM:
+    return VRAM_SIZE;
+  case ENV_OBS_GRAY:
+    return ENV_GRAY_WIDTH * ENV_GRAY_HEIGHT;
+  }
+  return 0;
+}
+
+State8080 *EnvMachine8080(Env8080 *env, int i)
+{
+  return env->machines[i];
+}
+
+int SetEnvReset8080(Env8080 *env, const void *image, size_t size)
+{
+  // The same checks LoadState8080 makes, so that every later reset
+  // succeeds.
+  const SaveImage8080 *ss = image;
+  if(size < sizeof(SaveImage8080) || ss->magic != SAVESTATE_MAGIC ||
+      ss->version != SAVESTATE_VERSION || ss->size != sizeof(SaveImage8080) ||
+      ss->ram_base != RAM_BASE || ss->ram_size != RAM_SIZE)
+    return EMU_ERR_FORMAT;
+  memcpy(&env->reset, image, sizeof(env->reset));
+  return EMU_OK;
+}
+
+void ResetEnv8080(Env8080 *env)
+{
+  int i;
+  for(i = 0; i < env->count; i++)
+    Reset(env, i);
+}
+
+int StepEnv8080(Env8080 *env, const uint8_t *actions, int frames, const EnvStep8080 *out)
+{
+  size_t obs_size = EnvObsSize8080(env);
+  int i, f;
+
+  for(i = 0; i < env->count; i++)
+    env->machines[i]->io.in[1] = 0x08 | actions[i];
+
+  if(env->batch)
+  {
+    if(RunBatch8080(env->batch, env->machines, env->count, frames, env->status) != EMU_OK)
+      return EMU_ERR_NOMEM;
+  }
+  else
+  {
+    for(i = 0; i < env->count; i++)
+      for(f = 0, env->status[i] = EMU_OK; f < frames && env->status[i] == EMU_OK; f++)
+        env->status[i] = RunFrame8080(env->machines[i]);
+  }
+
+  for(i = 0; i < env->count; i++)
+  {
+    State8080 *state = env->machines[i];
+    int32_t score = Score(state);
+    int mode = Peek(state, ENV_MODE_ADDR) != 0;
+    int done = env->status[i] != EMU_OK || (env->playing[i] && !mode);
+
+    if(out->reward)
+      out->reward[i] = score - env->last_score[i];
+    if(out->score)
+      out->score[i] = score;
+    if(out->lives)
+      out->lives[i] = Peek(state, ENV_LIVES_ADDR);
+    if(out->done)
+      out->done[i] = done;
+    env->last_score[i] = score;
+    env->playing[i] |= mode;
+    if(done)
+      Reset(env, i);
+    if(out->obs)
+      WriteObs(env, state, out->obs + i * obs_size);
+  }
+  return EMU_OK;
+}
@@ -0,0 +1,85 @@
+#ifndef EMULATE_ENV_H
+#define EMULATE_ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "8080.h"
+#include "batch.h"
+#include "savestate.h"
+
+// Many Invaders machines stepped together, for agents that call
+// step(actions) -> observations, rewards on thousands of environments.
+// The machines are forks of one parent that holds the ROM, so each
+// costs its state and the RAM pages it writes.  Everything a step
+// returns is written straight into caller arrays laid out machine after
+// machine; a step allocates nothing.
+//
+//     Env8080 *env = InitEnv8080("invaders.rom", 1024, ENV_OBS_GRAY, batch);
+//     SetEnvReset8080(env, &in_game, sizeof(in_game));
+//     EnvStep8080 out = { obs, reward, score, lives, done };
+//     for(;;)
+//       StepEnv8080(env, actions, 4, &out);
+
+// Game state in work RAM.
+#define ENV_SCORE_ADDR  0x20f8    // player 1 score, 2 BCD bytes, low first
+#define ENV_LIVES_ADDR  0x21ff    // player 1 ships in reserve
+#define ENV_MODE_ADDR   0x20ef    // 1 while a game is being played
+
+// Action bits; an action is the value of input port 1, which the game
+// reads for coin, the start buttons and player 1's controls.
+enum {
+  ENV_COIN    = 0x01,
+  ENV_START2  = 0x02,
+  ENV_START   = 0x04,
+  ENV_FIRE    = 0x10,
+  ENV_LEFT    = 0x20,
+  ENV_RIGHT   = 0x40,
+};
+
+enum {
+  ENV_OBS_NONE = 0,
+  ENV_OBS_VRAM,     // VRAM_SIZE bytes of 1bpp VRAM, as video.h reads it
+  ENV_OBS_GRAY,     // ENV_GRAY_WIDTH x ENV_GRAY_HEIGHT bytes, upright,
+                    // each the share of its 2x2 pixels that are lit
+};
+
+#define ENV_GRAY_WIDTH   112
+#define ENV_GRAY_HEIGHT  128
+
+// Outputs of one step, one entry per machine.  Any may be NULL.
+typedef struct EnvStep8080 {
+  uint8_t *obs;       // count * EnvObsSize8080 bytes
+  int32_t *reward;    // points scored during the step
+  int32_t *score;     // score at the end of the step
+  uint8_t *lives;     // ships in reserve at the end of the step
+  uint8_t *done;      // 1 if the game ended (or the machine failed)
+} EnvStep8080;
+
+typedef struct Env8080 Env8080;
+
+// count machines running rom.  batch, if not NULL, runs the frames on
+// its worker threads; otherwise they run on the calling thread.  The
+// reset state starts as power-on.  Returns NULL on failure.
+Env8080 *InitEnv8080(const char *rom, int count, int obs, Batch8080 *batch);
+void FreeEnv8080(Env8080 *env);
+
+int EnvCount8080(const Env8080 *env);
+size_t EnvObsSize8080(const Env8080 *env);
+State8080 *EnvMachine8080(Env8080 *env, int i);
+
+// Sets the state machines go back to when their episode ends, usually
+// one saved just after a game started.  Returns EMU_ERR_FORMAT if the
+// image isn't one LoadState8080 accepts.
+int SetEnvReset8080(Env8080 *env, const void *image, size_t size);
+// Puts every machine back in the reset state.
+void ResetEnv8080(Env8080 *env);
+
+// Holds actions[i] on machine i for `frames` frames, then fills `out`.
+// A machine whose game ended, or whose core returned an error, reports
+// done and is reset: its reward, score and lives are those of the last
+// frame of the episode and its observation the first of the next.
+// Returns EMU_OK, or EMU_ERR_NOMEM if the batch couldn't size its queues.
+int StepEnv8080(Env8080 *env, const uint8_t *actions, int frames, const EnvStep8080 *out);
+
+#endif
@@ -0,0 +1,329 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "8080.h"
+#include "calls.h"
+#include "cover.h"
+#include "metrics.h"
+#include "pacer.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "sampler.h"
+#include "shmfb.h"
+#include "tcache.h"
+#include "tier.h"
+
+// Set by SIGINT and SIGTERM: the run ends after the current frame and
+// the profile, call graph, samples and coverage are still written.
+static volatile sig_atomic_t stopping;
+
+static void OnStop(int sig)
+{
+  (void)sig;
+  stopping = 1;
+}
+
+// Writes <name>.json and <name>.txt.
+static void WriteProfile(const Profile8080 *prof, const State8080 *state, const char *name)
+{
+  char path[4096];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s.json", name);
+  if((f = fopen(path, "w")) == NULL || WriteProfileJSON8080(prof, f) != EMU_OK)
+    printf("Error: couldn't write %s\n", path);
+  if(f)
+    fclose(f);
+
+  snprintf(path, sizeof(path), "%s.txt", name);
+  if((f = fopen(path, "w")) == NULL || WriteProfileText8080(prof, state, f, 200) != EMU_OK)
+    printf("Error: couldn't write %s\n", path);
+  if(f)
+    fclose(f);
+}
+
+// Writes <name>.folded (collapsed stacks) and <name>.calls.txt.
+static void WriteCalls(const Calls8080 *calls, const char *name)
+{
+  char path[4096];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s.folded", name);
+  if((f = fopen(path, "w")) == NULL || WriteCollapsed8080(calls, f) != EMU_OK)
+    printf("Error: couldn't write %s\n", path);
+  if(f)
+    fclose(f);
+
+  snprintf(path, sizeof(path), "%s.calls.txt", name);
+  if((f = fopen(path, "w")) == NULL || WriteCallsText8080(calls, f, 200) != EMU_OK)
+    printf("Error: couldn't write %s\n", path);
+  if(f)
+    fclose(f);
+}
+
+// Encode stage for -V: appends the frame to a stream of binary PGMs,
+// which ffmpeg reads with -f image2pipe.
+static int WriteFrame(void *ctx, const PipeFrame8080 *frame)
+{
+  static uint8_t gray[VIDEO_WIDTH * VIDEO_HEIGHT];
+  FILE *f = ctx;
+  int i;
+  for(i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++)
+    gray[i] = frame->pixels[i];
+  fprintf(f, "P5\n%d %d\n255\n", VIDEO_WIDTH, VIDEO_HEIGHT);
+  return fwrite(gray, sizeof(gray), 1, f) == 1 ? EMU_OK : EMU_ERR_IO;
+}
+
+int main(int argc, char* argv[])
+{
+  const char *profile = NULL;
+  const char *callgraph = NULL;
+  const char *symbols = NULL;
+  const char *samples = NULL;
+  const char *rom = NULL;
+  const char *metrics = NULL;
+  const char *shm = NULL;
+  const char *video = NULL;
+  const char *coverage = NULL;
+  int pace = PACE_MAX;
+  int tiered = 1;
+  const char *tcache = NULL;
+  const char *trace = NULL;
+  int cpm = 0;
+  uint64_t frames = 0;
+  double speed = 1.0;
+  int i;
+
+  for(i = 1; i < argc; i++)
+  {
+    if(strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+      profile = argv[++i];
+    else if(strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+      callgraph = argv[++i];
+    else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      symbols = argv[++i];
+    else if(strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+      samples = argv[++i];
+    else if(strcmp(argv[i], "-r") == 0)
+      pace = PACE_REALTIME;
+    else if(strcmp(argv[i], "-x") == 0 && i + 1 < argc)
+    {
+      pace = PACE_REALTIME;
+      speed = atof(argv[++i]);
+    }
+    else if(strcmp(argv[i], "-M") == 0 && i + 1 < argc)
+      metrics = argv[++i];
+    else if(strcmp(argv[i], "-F") == 0 && i + 1 < argc)
+      shm = argv[++i];
+    else if(strcmp(argv[i], "-V") == 0 && i + 1 < argc)
+      video = argv[++i];
+    else if(strcmp(argv[i], "-C") == 0 && i + 1 < argc)
+      coverage = argv[++i];
+    else if(strcmp(argv[i], "-I") == 0)
+      tiered = 0;
+    else if(strcmp(argv[i], "-K") == 0 && i + 1 < argc)
+      tcache = argv[++i];
+    else if(strcmp(argv[i], "-c") == 0)
+      cpm = 1;
+    else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      trace = argv[++i];
+    else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      frames = strtoull(argv[++i], NULL, 0);
+    else
+      rom = argv[i];
+  }
+  if(rom == NULL)
+  {
+    printf("usage: %s [-p profile] [-g callgraph [-s symbols]] [-S samples] [-r | -x speed] [-M metrics] [-F shmname] [-V video.pgm] [-C coverage] [-I | -K tcache] [-t trace] [-n frames] [-c] rom\n", argv[0]);
+    return 1;
+  }
+
+  State8080 *state = Init8080();
+  if(state == NULL)
+  {
+    printf("Error: %s\n", StatusString8080(EMU_ERR_NOMEM));
+    return 1;
+  }
+
+  // -c runs a CP/M program such as cpudiag.bin rather than a ROM.
+  if((cpm ? LoadCpm8080(state, rom, stdout) : ReadFile(state, rom, 0)) != EMU_OK)
+  {
+    printf("Error: couldn't open %s\n", rom);
+    Free8080(state);
+    return 1;
+  }
+
+  // The instruction trace: "-" for stdout.
+  FILE *tf = NULL;
+  if(trace && (tf = strcmp(trace, "-") == 0 ? stdout : fopen(trace, "w")) == NULL)
+    printf("Error: couldn't write %s\n", trace);
+  state->trace = tf;
+
+  Profile8080 *prof = NULL;
+  if(profile && (prof = InitProfile8080()) == NULL)
+  {
+    printf("Error: %s\n", StatusString8080(EMU_ERR_NOMEM));
+    Free8080(state);
+    return 1;
+  }
+  state->profile = prof;
+
+  Calls8080 *calls = NULL;
+  if(callgraph && (calls = InitCalls8080(1 << 16)) == NULL)
+  {
+    printf("Error: %s\n", StatusString8080(EMU_ERR_NOMEM));
+    FreeProfile8080(prof);
+    Free8080(state);
+    return 1;
+  }
+  if(calls && symbols && LoadSymbols8080(calls, symbols) != EMU_OK)
+    printf("Error: couldn't read %s\n", symbols);
+  state->calls = calls;
+
+  // Hot code runs from decoded blocks unless -I asks for the plain
+  // interpreter throughout.  A profile, call graph or trace accounts
+  // for every instruction, so with one of those it is interpreted too.
+  if(tiered && (prof || calls || tf))
+  {
+    printf("Note: -p, -g and -t interpret every instruction; tiering is off\n");
+    tiered = 0;
+  }
+  if(tiered && (state->tier = InitTier8080(NULL)) == NULL)
+    printf("Error: %s\n", StatusString8080(EMU_ERR_NOMEM));
+
+  // With -K the blocks come from the cache file; if it is missing or
+  // stale, a new one is written once the game has warmed up.
+  uint64_t save_tcache = 0;
+  if(tcache && state->tier && LoadTierCache8080(state, tcache, NULL) != EMU_OK)
+    save_tcache = 600;
+
+  // Coverage with edges; merge runs and list them with covmerge.
+  if(coverage && (state->cover = InitCover8080(1)) == NULL)
+    printf("Error: %s\n", StatusString8080(EMU_ERR_NOMEM));
+
+  // SIGPROF can land on the metrics dump thread and the two pipeline
+  // threads too; each needs a buffer of its own or it takes ours.
+  int sample_threads = 1 + (metrics != NULL) + 2 * (video != NULL);
+  if(samples && StartSampler8080(1000, sample_threads, 1 << 20) != EMU_OK)
+  {
+    printf("Error: couldn't start the sampler\n");
+    samples = NULL;
+  }
+
+  // Metrics go to a file once a second while the machine runs.
+  FILE *mf = NULL;
+  MetricsDump8080 *dump = NULL;
+  if(metrics)
+  {
+    if((state->metrics = InitMetrics8080()) == NULL || (mf = fopen(metrics, "w")) == NULL ||
+        (dump = StartMetricsDump8080(&state->metrics, 1, mf, 1000)) == NULL)
+      printf("Error: couldn't write %s\n", metrics);
+  }
+
+  // Finished frames go to shared memory for shmview and the like.
+  ShmFb8080 *fb = NULL;
+  if(shm && (fb = OpenShmExport8080(shm)) == NULL)
+    printf("Error: couldn't create shared memory %s\n", shm);
+
+  // Video is converted and written on two more threads while the next
+  // frame runs.
+  FILE *vf = NULL;
+  Pipeline8080 *pipe = NULL;
+  if(video && ((vf = fopen(video, "wb")) == NULL ||
+      (pipe = StartPipeline8080(4, 255, 0, WriteFrame, vf)) == NULL))
+    printf("Error: couldn't write %s\n", video);
+
+  // Paced, each frame ends by sleeping until the next one is due, so a
+  // guest that sits in HLT waiting for its interrupts costs next to
+  // nothing.
+  Pacer8080 pacer;
+  InitPacer8080(&pacer, pace, speed, state->metrics);
+
+  // A ROM never stops on its own: -n ends the run after that many
+  // frames, and so does Ctrl-C, with everything below still written.
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = OnStop;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  int status = EMU_OK;
+  while(status == EMU_OK && !stopping && (frames == 0 || state->frames < frames))
+  {
+    status = RunFrame8080(state);
+    if(save_tcache && state->frames == save_tcache && SaveTierCache8080(state, tcache) != EMU_OK)
+      printf("Error: couldn't write %s\n", tcache);
+    if(fb)
+      PublishShmFrame8080(fb, state);
+    if(pipe)
+      PipelineFrame8080(pipe, state);
+    Pace8080(&pacer);
+  }
+  CloseShmFb8080(fb);
+  if(pipe)
+  {
+    PipelineStats8080 ps;
+    StopPipeline8080(pipe, &ps);
+    if(ps.status != EMU_OK)
+      printf("Error: couldn't write %s\n", video);
+  }
+  if(vf)
+    fclose(vf);
+
+  StopMetricsDump8080(dump);
+  if(mf)
+    fclose(mf);
+  FreeMetrics8080(state->metrics);
+  state->metrics = NULL;
+
+  if(samples)
+  {
+    StopSampler8080();
+    FILE *f = fopen(samples, "wb");
+    if(f == NULL || WriteSamples8080(f) != EMU_OK)
+      printf("Error: couldn't write %s\n", samples);
+    if(f)
+      fclose(f);
+  }
+
+  if(status == EMU_UNIMPLEMENTED)
+  {
+    printf("Error: Unimplemented instruction\n");
+    Disassemble8080p(state->memory, state->pc);
+    printf("\nOPcode: %02x", state->memory[state->pc]);
+    printf("\n");
+    printf("%llu\n", (unsigned long long)state->counter);
+  }
+
+  if(prof)
+  {
+    WriteProfile(prof, state, profile);
+    FreeProfile8080(prof);
+  }
+  if(calls)
+  {
+    Charge8080(calls, state->cycles);
+    WriteCalls(calls, callgraph);
+    FreeCalls8080(calls);
+  }
+  if(state->cover)
+  {
+    FILE *f = fopen(coverage, "wb");
+    if(f == NULL || WriteCover8080(state->cover, f) != EMU_OK)
+      printf("Error: couldn't write %s\n", coverage);
+    if(f)
+      fclose(f);
+    FreeCover8080(state->cover);
+  }
+  if(tf && tf != stdout)
+    fclose(tf);
+  Tier8080 *tier = state->tier;
+  DetachTier8080(state);
+  FreeTier8080(tier);
+  Free8080(state);
+  return (status == EMU_EXIT || status == EMU_OK) ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "metrics.h"
+
+Metrics8080 *InitMetrics8080(void)
+{
+  Metrics8080 *m = malloc(sizeof(Metrics8080));
+  if(m)
+    ResetMetrics8080(m);
+  return m;
+}
+
+void FreeMetrics8080(Metrics8080 *m)
+{
+  free(m);
+}
+
+void ResetMetrics8080(Metrics8080 *m)
+{
+  int i;
+  atomic_init(&m->instructions, 0);
+  atomic_init(&m->cycles, 0);
+  atomic_init(&m->frames, 0);
+  atomic_init(&m->interrupts, 0);
+  atomic_init(&m->port_in, 0);
+  atomic_init(&m->port_out, 0);
+  atomic_init(&m->busy_ns, 0);
+  atomic_init(&m->frame_max_ns, 0);
+  atomic_init(&m->late, 0);
+  atomic_init(&m->jitter_max_ns, 0);
+  atomic_init(&m->tier_decoded, 0);
+  atomic_init(&m->tier_chained, 0);
+  atomic_init(&m->tier_invalidated, 0);
+  atomic_init(&m->tier_demoted, 0);
+  for(i = 0; i < METRICS_BUCKETS; i++)
+  {
+    atomic_init(&m->frame_ns[i], 0);
+    atomic_init(&m->jitter_ns[i], 0);
+  }
+}
+
+void ReadMetrics8080(const Metrics8080 *m, MetricsSnapshot8080 *snap)
+{
+  // The atomics are only read; casting away const doesn't write.
+  Metrics8080 *mm = (Metrics8080 *)m;
+  int i;
+  snap->instructions = atomic_load_explicit(&mm->instructions, memory_order_relaxed);
+  snap->cycles = atomic_load_explicit(&mm->cycles, memory_order_relaxed);
+  snap->frames = atomic_load_explicit(&mm->frames, memory_order_relaxed);
+  snap->interrupts = atomic_load_explicit(&mm->interrupts, memory_order_relaxed);
+  snap->port_in = atomic_load_explicit(&mm->port_in, memory_order_relaxed);
+  snap->port_out = atomic_load_explicit(&mm->port_out, memory_order_relaxed);
+  snap->busy_ns = atomic_load_explicit(&mm->busy_ns, memory_order_relaxed);
+  snap->frame_max_ns = atomic_load_explicit(&mm->frame_max_ns, memory_order_relaxed);
+  snap->late = atomic_load_explicit(&mm->late, memory_order_relaxed);
+  snap->jitter_max_ns = atomic_load_explicit(&mm->jitter_max_ns, memory_order_relaxed);
+  snap->tier_decoded = atomic_load_explicit(&mm->tier_decoded, memory_order_relaxed);
+  snap->tier_chained = atomic_load_explicit(&mm->tier_chained, memory_order_relaxed);
+  snap->tier_invalidated = atomic_load_explicit(&mm->tier_invalidated, memory_order_relaxed);
+  snap->tier_demoted = atomic_load_explicit(&mm->tier_demoted, memory_order_relaxed);
+  snap->frame_count = 0;
+  snap->jitter_count = 0;
+  for(i = 0; i < METRICS_BUCKETS; i++)
+  {
+    snap->frame_ns[i] = atomic_load_explicit(&mm->frame_ns[i], memory_order_relaxed);
+    snap->frame_count += snap->frame_ns[i];
+    snap->jitter_ns[i] = atomic_load_explicit(&mm->jitter_ns[i], memory_order_relaxed);
+    snap->jitter_count += snap->jitter_ns[i];
+  }
+}
+
+// Largest value that lands in bucket i.
+static uint64_t BucketTop(int i)
+{
+  int bit;
+  uint64_t mantissa;
+  if(i < METRICS_SUB)
+    return i;
+  bit = i / METRICS_SUB + METRICS_SUB_BITS - 1;
+  mantissa = METRICS_SUB + i % METRICS_SUB;
+  return ((mantissa + 1) << (bit - METRICS_SUB_BITS)) - 1;
+}
+
+static uint64_t Quantile(const uint64_t *hist, uint64_t count, uint64_t max, double q)
+{
+  uint64_t rank, seen = 0;
+  int i;
+  if(count == 0)
+    return 0;
+  if(q < 0)
+    q = 0;
+  if(q > 1)
+    q = 1;
+  rank = (uint64_t)(q * (count - 1)) + 1;
+  for(i = 0; i < METRICS_BUCKETS; i++)
+  {
+    seen += hist[i];
+    if(seen >= rank)
+      break;
+  }
+  if(i == METRICS_BUCKETS)
+    i--;
+  return BucketTop(i) < max ? BucketTop(i) : max;
+}
+
+uint64_t FrameQuantile8080(const MetricsSnapshot8080 *snap, double q)
+{
+  return Quantile(snap->frame_ns, snap->frame_count, snap->frame_max_ns, q);
+}
+
+uint64_t JitterQuantile8080(const MetricsSnapshot8080 *snap, double q)
+{
+  return Quantile(snap->jitter_ns, snap->jitter_count, snap->jitter_max_ns, q);
+}
+
+double EmulatedMHz8080(const MetricsSnapshot8080 *snap)
+{
+  return snap->busy_ns ? (double)snap->cycles * 1000.0 / snap->busy_ns : 0.0;
+}
+
+int WriteMetricsJSON8080(const MetricsSnapshot8080 *snap, FILE *out)
+{
+  fprintf(out, "{\"instructions\": %llu, \"cycles\": %llu, \"frames\": %llu, "
+      "\"interrupts\": %llu, \"port_in\": %llu, \"port_out\": %llu, "
+      "\"busy_ns\": %llu, \"mhz\": %.3f, "
+      "\"frame_ns\": {\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}, "
+      "\"late\": %llu, "
+      "\"jitter_ns\": {\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}, "
+      "\"tier\": {\"decoded\": %llu, \"chained\": %llu, \"invalidated\": %llu, \"demoted\": %llu}}",
+      (unsigned long long)snap->instructions, (unsigned long long)snap->cycles,
+      (unsigned long long)snap->frames, (unsigned long long)snap->interrupts,
+      (unsigned long long)snap->port_in, (unsigned long long)snap->port_out,
+      (unsigned long long)snap->busy_ns, EmulatedMHz8080(snap),
+      (unsigned long long)FrameQuantile8080(snap, 0.5),
+      (unsigned long long)FrameQuantile8080(snap, 0.9),
+      (unsigned long long)FrameQuantile8080(snap, 0.99),
+      (unsigned long long)FrameQuantile8080(snap, 0.999),
+      (unsigned long long)snap->frame_max_ns,
+      (unsigned long long)snap->late,
+      (unsigned long long)JitterQuantile8080(snap, 0.5),
+      (unsigned long long)JitterQuantile8080(snap, 0.9),
+      (unsigned long long)JitterQuantile8080(snap, 0.99),
+      (unsigned long long)JitterQuantile8080(snap, 0.999),
+      (unsigned long long)snap->jitter_max_ns,
+      (unsigned long long)snap->tier_decoded, (unsigned long long)snap->tier_chained,
+      (unsigned long long)snap->tier_invalidated, (unsigned long long)snap->tier_demoted);
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
+
+struct MetricsDump8080 {
+  Metrics8080 *const *machines;
+  int count;
+  FILE *out;
+  int interval_ms;
+  MetricsSnapshot8080 snap;
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  int stop;
+};
+
+static void DumpOnce(MetricsDump8080 *d)
+{
+  int i;
+  fprintf(d->out, "[");
+  for(i = 0; i < d->count; i++)
+  {
+    ReadMetrics8080(d->machines[i], &d->snap);
+    if(i)
+      fprintf(d->out, ", ");
+    WriteMetricsJSON8080(&d->snap, d->out);
+  }
+  fprintf(d->out, "]\n");
+  fflush(d->out);
+}
+
+static void *DumpMain(void *arg)
+{
+  MetricsDump8080 *d = arg;
+  struct timespec next;
+  clock_gettime(CLOCK_REALTIME, &next);
+
+  pthread_mutex_lock(&d->lock);
+  while(!d->stop)
+  {
+    next.tv_sec += d->interval_ms / 1000;
+    next.tv_nsec += (long)(d->interval_ms % 1000) * 1000000;
+    if(next.tv_nsec >= 1000000000)
+    {
+      next.tv_sec++;
+      next.tv_nsec -= 1000000000;
+    }
+    while(!d->stop && pthread_cond_timedwait(&d->wake, &d->lock, &next) != ETIMEDOUT)
+      ;
+    pthread_mutex_unlock(&d->lock);
+    DumpOnce(d);
+    pthread_mutex_lock(&d->lock);
+  }
+  pthread_mutex_unlock(&d->lock);
+  return NULL;
+}
+
+MetricsDump8080 *StartMetricsDump8080(Metrics8080 *const *machines, int count,
+    FILE *out, int interval_ms)
+{
+  MetricsDump8080 *d = calloc(1, sizeof(MetricsDump8080));
+  if(d == NULL)
+    return NULL;
+  d->machines = machines;
+  d->count = count;
+  d->out = out;
+  d->interval_ms = interval_ms > 0 ? interval_ms : 1000;
+  pthread_mutex_init(&d->lock, NULL);
+  pthread_cond_init(&d->wake, NULL);
+  if(pthread_create(&d->thread, NULL, DumpMain, d) != 0)
+  {
+    pthread_cond_destroy(&d->wake);
+    pthread_mutex_destroy(&d->lock);
+    free(d);
+    return NULL;
+  }
+  return d;
+}
+
+void StopMetricsDump8080(MetricsDump8080 *d)
+{
+  if(d == NULL)
+    return;
+  pthread_mutex_lock(&d->lock);
+  d->stop = 1;
+  pthread_cond_signal(&d->wake);
+  pthread_mutex_unlock(&d->lock);
+  pthread_join(d->thread, NULL);
+  pthread_cond_destroy(&d->wake);
+  pthread_mutex_destroy(&d->lock);
+  free(d);
+}
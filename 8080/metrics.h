@@ -0,0 +1,152 @@
+#ifndef EMULATE_METRICS_H
+#define EMULATE_METRICS_H
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "8080.h"
+#include "tier.h"
+
+// Per-machine run statistics that any thread can read while the machine
+// runs.  Point state->metrics at one of these; Run8080 and RunFrame8080
+// then time each call and publish the machine's counters when it
+// returns, with relaxed atomic stores.  Nothing is added to the
+// instruction loop, and a reader never blocks the machine.
+//
+// Host time per frame goes into a log-linear histogram in the style of
+// HdrHistogram: values below 32 ns get their own bucket, and above
+// that every power of two is split into 32 buckets, so any value is
+// known to about 3%.  Values are capped at 2^41 ns.  A second histogram
+// holds the pacer's wake-up jitter (pacer.h): how late after a frame's
+// deadline the host thread got to run again.
+#define METRICS_SUB_BITS  5
+#define METRICS_SUB       (1 << METRICS_SUB_BITS)
+#define METRICS_MAX_BIT   40
+#define METRICS_BUCKETS   ((METRICS_MAX_BIT - METRICS_SUB_BITS + 2) * METRICS_SUB)
+
+typedef struct Metrics8080 {
+  atomic_uint_fast64_t instructions;
+  atomic_uint_fast64_t cycles;
+  atomic_uint_fast64_t frames;
+  atomic_uint_fast64_t interrupts;
+  atomic_uint_fast64_t port_in;
+  atomic_uint_fast64_t port_out;
+  atomic_uint_fast64_t busy_ns;     // host time inside Run8080
+  atomic_uint_fast64_t frame_max_ns;
+  atomic_uint_fast64_t frame_ns[METRICS_BUCKETS];
+  atomic_uint_fast64_t late;        // paced frames that missed their deadline
+  atomic_uint_fast64_t jitter_max_ns;
+  atomic_uint_fast64_t jitter_ns[METRICS_BUCKETS];
+  atomic_uint_fast64_t tier_decoded;      // tier.h promotions and demotions
+  atomic_uint_fast64_t tier_chained;
+  atomic_uint_fast64_t tier_invalidated;
+  atomic_uint_fast64_t tier_demoted;
+} Metrics8080;
+
+// A copy taken by ReadMetrics8080.
+typedef struct MetricsSnapshot8080 {
+  uint64_t instructions;
+  uint64_t cycles;
+  uint64_t frames;
+  uint64_t interrupts;
+  uint64_t port_in;
+  uint64_t port_out;
+  uint64_t busy_ns;
+  uint64_t frame_max_ns;
+  uint64_t frame_count;   // frames in the histogram
+  uint64_t frame_ns[METRICS_BUCKETS];
+  uint64_t late;
+  uint64_t jitter_max_ns;
+  uint64_t jitter_count;  // paced frames in the histogram
+  uint64_t jitter_ns[METRICS_BUCKETS];
+  uint64_t tier_decoded;
+  uint64_t tier_chained;
+  uint64_t tier_invalidated;
+  uint64_t tier_demoted;
+} MetricsSnapshot8080;
+
+// Returns zeroed metrics, or NULL if allocation fails.
+Metrics8080 *InitMetrics8080(void);
+void FreeMetrics8080(Metrics8080 *m);
+// Only while no machine is publishing to m.
+void ResetMetrics8080(Metrics8080 *m);
+
+void ReadMetrics8080(const Metrics8080 *m, MetricsSnapshot8080 *snap);
+// Host ns per frame at quantile q (0..1): the upper edge of the bucket
+// the quantile falls in.  0 if no frames were recorded.
+uint64_t FrameQuantile8080(const MetricsSnapshot8080 *snap, double q);
+// The same for pacer wake-up jitter.
+uint64_t JitterQuantile8080(const MetricsSnapshot8080 *snap, double q);
+// Emulated MHz: guest cycles per host microsecond spent running.
+double EmulatedMHz8080(const MetricsSnapshot8080 *snap);
+
+// One JSON object per snapshot, with counters and frame-time and jitter
+// quantiles.
+int WriteMetricsJSON8080(const MetricsSnapshot8080 *snap, FILE *out);
+
+// Background thread that writes one line of JSON, an array with one
+// object per machine, every interval_ms, and once more when stopped.
+// `machines` must stay valid until StopMetricsDump8080.
+typedef struct MetricsDump8080 MetricsDump8080;
+MetricsDump8080 *StartMetricsDump8080(Metrics8080 *const *machines, int count,
+    FILE *out, int interval_ms);
+void StopMetricsDump8080(MetricsDump8080 *dump);
+
+// Used by the core.  Only the thread running the machine writes, so
+// plain relaxed loads and stores are enough; readers may see counters
+// from two different publishes, never torn values.
+static inline int MetricsBucket8080(uint64_t ns)
+{
+  int bit;
+  if(ns < METRICS_SUB)
+    return (int)ns;
+  if(ns >> (METRICS_MAX_BIT + 1))
+    ns = (1ULL << (METRICS_MAX_BIT + 1)) - 1;
+  bit = 63 - __builtin_clzll(ns);
+  return (bit - METRICS_SUB_BITS + 1) * METRICS_SUB +
+      (int)((ns >> (bit - METRICS_SUB_BITS)) & (METRICS_SUB - 1));
+}
+
+static inline void PublishMetrics8080(Metrics8080 *m, const State8080 *state,
+    uint64_t ns, int frame)
+{
+  atomic_store_explicit(&m->instructions, state->counter, memory_order_relaxed);
+  atomic_store_explicit(&m->cycles, state->cycles, memory_order_relaxed);
+  atomic_store_explicit(&m->frames, state->frames, memory_order_relaxed);
+  atomic_store_explicit(&m->interrupts, state->interrupts, memory_order_relaxed);
+  atomic_store_explicit(&m->port_in, state->port_in, memory_order_relaxed);
+  atomic_store_explicit(&m->port_out, state->port_out, memory_order_relaxed);
+  atomic_store_explicit(&m->busy_ns,
+      atomic_load_explicit(&m->busy_ns, memory_order_relaxed) + ns, memory_order_relaxed);
+  if(state->tier)
+  {
+    const TierStats8080 *ts = &state->tier->stats;
+    atomic_store_explicit(&m->tier_decoded, ts->decoded, memory_order_relaxed);
+    atomic_store_explicit(&m->tier_chained, ts->chained, memory_order_relaxed);
+    atomic_store_explicit(&m->tier_invalidated, ts->invalidated, memory_order_relaxed);
+    atomic_store_explicit(&m->tier_demoted, ts->demoted, memory_order_relaxed);
+  }
+  if(frame)
+  {
+    atomic_uint_fast64_t *b = &m->frame_ns[MetricsBucket8080(ns)];
+    atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    if(ns > atomic_load_explicit(&m->frame_max_ns, memory_order_relaxed))
+      atomic_store_explicit(&m->frame_max_ns, ns, memory_order_relaxed);
+  }
+}
+
+// Used by the pacer, from the thread running the machine.
+static inline void PublishJitter8080(Metrics8080 *m, uint64_t ns, int late)
+{
+  atomic_uint_fast64_t *b = &m->jitter_ns[MetricsBucket8080(ns)];
+  atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + 1,
+      memory_order_relaxed);
+  if(ns > atomic_load_explicit(&m->jitter_max_ns, memory_order_relaxed))
+    atomic_store_explicit(&m->jitter_max_ns, ns, memory_order_relaxed);
+  if(late)
+    atomic_store_explicit(&m->late,
+        atomic_load_explicit(&m->late, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+#endif
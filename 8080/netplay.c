@@ -0,0 +1,176 @@
+#include <string.h>
+#include <time.h>
+
+#include "netplay.h"
+
+#define NETPLAY_MAGIC   0x4e503830u   // "08PN" read little-endian
+#define HEADER          13            // magic, ack, start, count
+#define MAX_INPUTS      (NETPLAY_HISTORY / 2)
+#define SLOT(f)         ((f) & (NETPLAY_HISTORY - 1))
+#define SAVE(np, f)     (&(np)->save[(f) % (NETPLAY_WINDOW + 1)])
+
+static uint64_t Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void Put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static uint32_t Get32(const uint8_t *p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+void InitNetplay8080(Netplay8080 *np, State8080 *state, Transport8080 *net, int local)
+{
+  memset(np, 0, sizeof(*np));
+  np->state = state;
+  np->net = net;
+  np->local = local & 1;
+  np->confirmed = -1;
+  np->acked = -1;
+  np->resim_from = -1;
+}
+
+// The other player's input for frame f: the real one if it's here,
+// otherwise the last one that is.
+static uint8_t Remote(const Netplay8080 *np, int f)
+{
+  int remote = !np->local;
+  if(np->confirmed < 0)
+    return 0;
+  return np->input[remote][SLOT(f <= np->confirmed ? f : np->confirmed)];
+}
+
+static int RunOne(Netplay8080 *np, int f)
+{
+  State8080 *state = np->state;
+  uint8_t remote = Remote(np, f);
+  uint8_t p1 = np->local ? remote : np->input[0][SLOT(f)];
+  uint8_t p2 = np->local ? np->input[1][SLOT(f)] : remote;
+
+  np->used[SLOT(f)] = remote;
+  SaveState8080(state, SAVE(np, f), sizeof(SaveImage8080));
+  // Port 1 bit 3 always reads 1; player 2's start is bit 1.  The low
+  // bits of port 2 are the DIP switches and stay as the host set them.
+  state->io.in[1] = 0x08 | ((p1 | p2) & NETPLAY_COIN) | (p2 & NETPLAY_START ? 0x02 : 0) |
+      (p1 & (NETPLAY_START | NETPLAY_FIRE | NETPLAY_LEFT | NETPLAY_RIGHT));
+  state->io.in[2] = (state->io.in[2] & 0x8f) | (p2 & (NETPLAY_FIRE | NETPLAY_LEFT | NETPLAY_RIGHT));
+  return RunFrame8080(state);
+}
+
+// Returns EMU_OK or EMU_ERR_IO.
+static int Receive(Netplay8080 *np)
+{
+  uint8_t buf[TRANSPORT_MTU];
+  int remote = !np->local;
+  int n, k;
+
+  while((n = np->net->recv(np->net, buf, sizeof(buf))) > 0)
+  {
+    if(n < HEADER || Get32(buf) != NETPLAY_MAGIC || n < HEADER + buf[12])
+      continue;
+    int ack = (int32_t)Get32(buf + 4);
+    int start = (int32_t)Get32(buf + 8);
+    if(ack > np->acked && ack < np->frame)
+      np->acked = ack;
+    // Only input that extends what's confirmed without a gap is taken;
+    // anything after a gap comes again in the next packet.
+    for(k = 0; k < buf[12]; k++)
+    {
+      int f = start + k;
+      uint8_t in = buf[HEADER + k];
+      if(f <= np->confirmed)
+        continue;
+      if(f != np->confirmed + 1 || f >= np->frame + MAX_INPUTS)
+        break;
+      np->input[remote][SLOT(f)] = in;
+      np->confirmed = f;
+      if(f < np->frame && np->used[SLOT(f)] != in &&
+         (np->resim_from < 0 || f < np->resim_from))
+        np->resim_from = f;
+    }
+  }
+  return (n < 0) ? EMU_ERR_IO : EMU_OK;
+}
+
+static int Rollback(Netplay8080 *np)
+{
+  int f, status = EMU_OK;
+  uint64_t start;
+
+  if(np->resim_from < 0)
+    return EMU_OK;
+  start = Now();
+  status = LoadState8080(np->state, SAVE(np, np->resim_from), sizeof(SaveImage8080));
+  for(f = np->resim_from; f < np->frame && status == EMU_OK; f++)
+    status = RunOne(np, f);
+  np->rollbacks++;
+  np->resimulated += np->frame - np->resim_from;
+  np->resim_from = -1;
+  start = Now() - start;
+  if(start > np->resim_max_ns)
+    np->resim_max_ns = start;
+  return status;
+}
+
+static int Send(Netplay8080 *np)
+{
+  uint8_t buf[HEADER + MAX_INPUTS];
+  int start = np->acked + 1;
+  int count = np->frame - start;
+  int k;
+
+  if(count > MAX_INPUTS)
+  {
+    start = np->frame - MAX_INPUTS;
+    count = MAX_INPUTS;
+  }
+  Put32(buf, NETPLAY_MAGIC);
+  Put32(buf + 4, (uint32_t)np->confirmed);
+  Put32(buf + 8, (uint32_t)start);
+  buf[12] = count;
+  for(k = 0; k < count; k++)
+    buf[HEADER + k] = np->input[np->local][SLOT(start + k)];
+  return np->net->send(np->net, buf, HEADER + count);
+}
+
+int NetplaySync8080(Netplay8080 *np)
+{
+  int status = Receive(np);
+  if(status == EMU_OK)
+    status = Rollback(np);
+  if(status == EMU_OK)
+    status = Send(np);
+  return status;
+}
+
+int NetplayFrame8080(Netplay8080 *np, uint8_t input, int *advanced)
+{
+  int status;
+
+  *advanced = 0;
+  if((status = Receive(np)) != EMU_OK)
+    return status;
+  if((status = Rollback(np)) != EMU_OK)
+    return status;
+  if(np->frame - np->confirmed > NETPLAY_WINDOW)
+  {
+    np->stalls++;
+    return Send(np);
+  }
+  np->input[np->local][SLOT(np->frame)] = input;
+  if((status = RunOne(np, np->frame)) != EMU_OK)
+    return status;
+  np->frame++;
+  *advanced = 1;
+  return Send(np);
+}
@@ -0,0 +1,66 @@
+#ifndef EMULATE_NETPLAY_H
+#define EMULATE_NETPLAY_H
+
+#include "8080.h"
+#include "savestate.h"
+#include "transport.h"
+
+// Two-player rollback netplay.  Each peer runs its own copy of the
+// machine and never waits for the other: a frame whose remote input
+// hasn't arrived yet runs on a prediction (the last remote input seen).
+// When the real input turns up and differs, the machine is restored to
+// the state before the first wrong frame and those frames are run again
+// with what is now known.  A save is kept for each of the last
+// NETPLAY_WINDOW frames, so a peer can run at most that far ahead of
+// the last frame it has confirmed remote input for; past that it stalls
+// until input arrives.
+//
+// Inputs are one byte per player per frame, the Invaders bits: 0x01
+// coin, 0x04 start, 0x10 fire, 0x20 left, 0x40 right.  Player 1's go to
+// port 1, player 2's fire, left and right to port 2 (coin and start are
+// taken from either).  Every packet repeats all of this peer's inputs
+// the other side hasn't acknowledged, so a lost packet costs nothing
+// but the next one.
+#define NETPLAY_WINDOW   8
+#define NETPLAY_HISTORY  64     // power of two, more than twice the window
+
+enum {
+  NETPLAY_COIN  = 0x01,
+  NETPLAY_START = 0x04,
+  NETPLAY_FIRE  = 0x10,
+  NETPLAY_LEFT  = 0x20,
+  NETPLAY_RIGHT = 0x40,
+};
+
+typedef struct Netplay8080 {
+  State8080 *state;
+  Transport8080 *net;
+  int local;            // player this peer controls, 0 or 1
+  int frame;            // next frame to run
+  int confirmed;        // remote input known for every frame up to this
+  int acked;            // the peer has our input for every frame up to this
+  int resim_from;       // earliest frame run on a wrong prediction, or -1
+  uint8_t input[2][NETPLAY_HISTORY];   // per player, by frame
+  uint8_t used[NETPLAY_HISTORY];       // remote input each frame ran with
+  SaveImage8080 save[NETPLAY_WINDOW + 1];  // before each frame, by frame
+
+  uint64_t rollbacks;
+  uint64_t resimulated; // frames run again
+  uint64_t stalls;      // calls that couldn't advance
+  uint64_t resim_max_ns;
+} Netplay8080;
+
+// Both peers must start from identical machines (same ROM, same state).
+void InitNetplay8080(Netplay8080 *np, State8080 *state, Transport8080 *net, int local);
+
+// Receives, rolls back if a prediction was wrong, and runs the next
+// frame with `input` for the local player.  Sets *advanced to whether a
+// frame ran (it doesn't when too far ahead of the peer).  Returns EMU_OK
+// or the first failing status.
+int NetplayFrame8080(Netplay8080 *np, uint8_t input, int *advanced);
+
+// Receives and repairs the past without running a new frame, and
+// resends.  For draining at the end of a session.
+int NetplaySync8080(Netplay8080 *np);
+
+#endif
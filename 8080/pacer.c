@@ -0,0 +1,59 @@
+#include <errno.h>
+#include <time.h>
+
+#include "pacer.h"
+
+static uint64_t Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void InitPacer8080(Pacer8080 *p, int mode, double speed, Metrics8080 *metrics)
+{
+  if(speed <= 0)
+    speed = 1.0;
+  p->mode = mode;
+  p->period_ns = (uint64_t)(FRAME_NS / speed);
+  if(p->period_ns == 0)
+    p->period_ns = 1;
+  p->deadline = Now() + p->period_ns;
+  p->late = 0;
+  p->resyncs = 0;
+  p->metrics = metrics;
+}
+
+uint64_t Pace8080(Pacer8080 *p)
+{
+  uint64_t now, jitter;
+  int late;
+
+  if(p->mode == PACE_MAX)
+    return 0;
+
+  now = Now();
+  late = (now > p->deadline);
+  if(!late)
+  {
+    struct timespec ts;
+    ts.tv_sec = p->deadline / 1000000000;
+    ts.tv_nsec = p->deadline % 1000000000;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+      ;
+    now = Now();
+  }
+  jitter = (now > p->deadline) ? now - p->deadline : 0;
+  if(late)
+    p->late++;
+  if(p->metrics)
+    PublishJitter8080(p->metrics, jitter, late);
+
+  p->deadline += p->period_ns;
+  if(now > p->deadline + PACER_MAX_BEHIND * p->period_ns)
+  {
+    p->deadline = now + p->period_ns;
+    p->resyncs++;
+  }
+  return jitter;
+}
@@ -0,0 +1,44 @@
+#ifndef EMULATE_PACER_H
+#define EMULATE_PACER_H
+
+#include "8080.h"
+#include "metrics.h"
+
+// Paces a frame loop against CLOCK_MONOTONIC.  Each frame has an
+// absolute deadline, the previous one plus the frame period, and the
+// thread sleeps until it with clock_nanosleep(TIMER_ABSTIME).  Oversleep
+// on one frame therefore comes out of the next one's sleep instead of
+// adding up.  If the loop falls more than PACER_MAX_BEHIND frames behind
+// (the machine was stopped in a debugger, the host was suspended) the
+// deadlines restart from now rather than running flat out to catch up.
+//
+//     Pacer8080 p;
+//     InitPacer8080(&p, PACE_REALTIME, 1.0, state->metrics);
+//     while(RunFrame8080(state) == EMU_OK)
+//       Pace8080(&p);
+#define PACER_MAX_BEHIND  4
+
+enum {
+  PACE_REALTIME = 0,  // frames at 60 Hz times the speed factor
+  PACE_MAX,           // no sleeping at all
+};
+
+typedef struct Pacer8080 {
+  int mode;
+  uint64_t period_ns;   // host ns per frame
+  uint64_t deadline;    // when the next frame is due, CLOCK_MONOTONIC ns
+  uint64_t late;        // frames that finished after their deadline
+  uint64_t resyncs;     // times the deadlines restarted from now
+  Metrics8080 *metrics; // wake-up jitter goes here, or NULL
+} Pacer8080;
+
+// speed 1.0 is real time, 4.0 four times as fast; ignored for PACE_MAX.
+// The first deadline is one period from now.
+void InitPacer8080(Pacer8080 *p, int mode, double speed, Metrics8080 *metrics);
+
+// Call once after each frame.  Sleeps until the frame's deadline and
+// returns how many ns after it the thread woke, or how late the frame
+// already was.  Returns 0 straight away for PACE_MAX.
+uint64_t Pace8080(Pacer8080 *p);
+
+#endif
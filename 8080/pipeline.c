@@ -0,0 +1,203 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pipeline.h"
+
+static uint64_t Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Single-producer single-consumer ring of slot numbers.  Each end keeps
+// its index on its own cache line; only the other end's index is read.
+typedef struct Ring {
+  _Atomic uint32_t head __attribute__((aligned(64)));   // consumer
+  _Atomic uint32_t tail __attribute__((aligned(64)));   // producer
+  uint8_t slot[PIPELINE_MAX_SLOTS];
+} Ring;
+
+static void Put(Ring *r, int n)
+{
+  uint32_t t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+  r->slot[t % PIPELINE_MAX_SLOTS] = n;
+  atomic_store_explicit(&r->tail, t + 1, memory_order_release);
+}
+
+static int Take(Ring *r)
+{
+  uint32_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+  int n;
+  if(h == atomic_load_explicit(&r->tail, memory_order_acquire))
+    return -1;
+  n = r->slot[h % PIPELINE_MAX_SLOTS];
+  atomic_store_explicit(&r->head, h + 1, memory_order_release);
+  return n;
+}
+
+// A stage with nothing to do spins briefly, then yields, then naps.  A
+// frame is milliseconds of work, so 50us of latency is lost in the noise
+// and an idle stage costs next to no CPU.
+static void Backoff(int *idle)
+{
+  if(++*idle < 64)
+    return;
+  if(*idle < 128)
+  {
+    sched_yield();
+    return;
+  }
+  nanosleep(&(struct timespec){ 0, 50000 }, NULL);
+}
+
+struct Pipeline8080 {
+  Ring free, render, encode;
+  PipeFrame8080 *frames;
+  int slots;
+  uint32_t on, off;
+  PipeEncode8080 callback;
+  void *ctx;
+
+  pthread_t render_thread, encode_thread;
+  atomic_int stop;          // caller has queued its last frame
+  atomic_int rendered;      // render thread has passed on everything
+  PipelineStats8080 stats;
+};
+
+static uint64_t Hash(const uint8_t *p, size_t n)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  size_t i;
+  for(i = 0; i < n; i++)
+    h = (h ^ p[i]) * 0x100000001b3ull;
+  return h;
+}
+
+static void *RenderMain(void *arg)
+{
+  Pipeline8080 *p = arg;
+  int idle = 0, n;
+  for(;;)
+  {
+    if((n = Take(&p->render)) < 0)
+    {
+      // The last Put happens before stop is set, so once stop is seen
+      // one more Take is enough.
+      if(atomic_load_explicit(&p->stop, memory_order_acquire) &&
+          (n = Take(&p->render)) < 0)
+        break;
+      if(n < 0)
+      {
+        Backoff(&idle);
+        continue;
+      }
+    }
+    idle = 0;
+    uint64_t start = Now();
+    PipeFrame8080 *f = &p->frames[n];
+    f->hash = Hash(f->vram, VRAM_SIZE);
+    ConvertVram8080(f->vram, f->pixels, p->on, p->off);
+    p->stats.render_ns += Now() - start;
+    Put(&p->encode, n);
+  }
+  atomic_store_explicit(&p->rendered, 1, memory_order_release);
+  return NULL;
+}
+
+static void *EncodeMain(void *arg)
+{
+  Pipeline8080 *p = arg;
+  int idle = 0, n;
+  for(;;)
+  {
+    if((n = Take(&p->encode)) < 0)
+    {
+      if(atomic_load_explicit(&p->rendered, memory_order_acquire) &&
+          (n = Take(&p->encode)) < 0)
+        break;
+      if(n < 0)
+      {
+        Backoff(&idle);
+        continue;
+      }
+    }
+    idle = 0;
+    if(p->stats.status == EMU_OK)
+    {
+      uint64_t start = Now();
+      p->stats.status = p->callback(p->ctx, &p->frames[n]);
+      p->stats.encode_ns += Now() - start;
+      p->stats.frames++;
+    }
+    Put(&p->free, n);
+  }
+  return NULL;
+}
+
+Pipeline8080 *StartPipeline8080(int slots, uint32_t on, uint32_t off,
+    PipeEncode8080 encode, void *ctx)
+{
+  Pipeline8080 *p;
+  int i;
+  if(slots < 2)
+    slots = 2;
+  if(slots > PIPELINE_MAX_SLOTS)
+    slots = PIPELINE_MAX_SLOTS;
+  if(posix_memalign((void **)&p, 64, sizeof(Pipeline8080)) != 0)
+    return NULL;
+  *p = (Pipeline8080){ .slots = slots, .on = on, .off = off, .callback = encode, .ctx = ctx };
+  if(posix_memalign((void **)&p->frames, 64, slots * sizeof(PipeFrame8080)) != 0)
+  {
+    free(p);
+    return NULL;
+  }
+  for(i = 0; i < slots; i++)
+    Put(&p->free, i);
+
+  if(pthread_create(&p->render_thread, NULL, RenderMain, p) != 0)
+    goto fail;
+  if(pthread_create(&p->encode_thread, NULL, EncodeMain, p) != 0)
+  {
+    atomic_store(&p->stop, 1);
+    pthread_join(p->render_thread, NULL);
+    goto fail;
+  }
+  return p;
+
+fail:
+  free(p->frames);
+  free(p);
+  return NULL;
+}
+
+void PipelineFrame8080(Pipeline8080 *p, const State8080 *state)
+{
+  int idle = 0, n;
+  if((n = Take(&p->free)) < 0)
+  {
+    p->stats.waits++;
+    while((n = Take(&p->free)) < 0)
+      Backoff(&idle);
+  }
+  PipeFrame8080 *f = &p->frames[n];
+  f->frame = state->frames;
+  ReadBlock8080(state, VRAM_BASE, f->vram, VRAM_SIZE);
+  Put(&p->render, n);
+}
+
+void StopPipeline8080(Pipeline8080 *p, PipelineStats8080 *stats)
+{
+  if(p == NULL)
+    return;
+  atomic_store_explicit(&p->stop, 1, memory_order_release);
+  pthread_join(p->render_thread, NULL);
+  pthread_join(p->encode_thread, NULL);
+  if(stats)
+    *stats = p->stats;
+  free(p->frames);
+  free(p);
+}
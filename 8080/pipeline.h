@@ -0,0 +1,60 @@
+#ifndef EMULATE_PIPELINE_H
+#define EMULATE_PIPELINE_H
+
+#include <stdint.h>
+
+#include "8080.h"
+#include "video.h"
+
+// Splits the frame loop over three threads:
+//
+//   caller:   emulate frame N+1, snapshot its VRAM into a free slot
+//   render:   convert and hash frame N's snapshot
+//   encode:   hand frame N-1 to the caller's encode callback
+//
+// Frames move between the stages in preallocated slots through three
+// single-producer single-consumer rings (free -> render -> encode ->
+// free), so a frame costs no allocation and no lock.  With every slot in
+// flight the emulating thread waits for the encoder to return one, so
+// frames per second are set by the slowest stage rather than the sum.
+//
+//     Pipeline8080 *p = StartPipeline8080(4, 0xffffffff, 0xff000000, Write, out);
+//     while(RunFrame8080(state) == EMU_OK)
+//       PipelineFrame8080(p, state);
+//     StopPipeline8080(p, &stats);
+#define PIPELINE_MAX_SLOTS  64
+
+typedef struct PipeFrame8080 {
+  uint64_t frame;         // state->frames when captured
+  uint64_t hash;          // FNV-1a of the VRAM snapshot
+  uint8_t vram[VRAM_SIZE];
+  uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+} PipeFrame8080;
+
+// Called on the encode thread for every frame, in order.  A non-zero
+// return stops further calls; StopPipeline8080 reports it.
+typedef int (*PipeEncode8080)(void *ctx, const PipeFrame8080 *frame);
+
+typedef struct PipelineStats8080 {
+  uint64_t frames;        // encoded
+  uint64_t waits;         // times the caller found no free slot
+  uint64_t render_ns;     // time spent converting and hashing
+  uint64_t encode_ns;     // time spent in the callback
+  int status;             // first non-zero callback return, or EMU_OK
+} PipelineStats8080;
+
+// slots is clamped to 2..PIPELINE_MAX_SLOTS; 3 is one per stage.
+// Returns NULL on failure.
+typedef struct Pipeline8080 Pipeline8080;
+Pipeline8080 *StartPipeline8080(int slots, uint32_t on, uint32_t off,
+    PipeEncode8080 encode, void *ctx);
+
+// Snapshots the machine's VRAM and queues it.  Waits only when every
+// slot is in flight.
+void PipelineFrame8080(Pipeline8080 *p, const State8080 *state);
+
+// Finishes the frames already queued, stops the threads and frees p.
+// stats may be NULL.
+void StopPipeline8080(Pipeline8080 *p, PipelineStats8080 *stats);
+
+#endif
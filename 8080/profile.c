@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+Profile8080 *InitProfile8080(void)
+{
+  return calloc(1, sizeof(Profile8080));
+}
+
+void FreeProfile8080(Profile8080 *prof)
+{
+  free(prof);
+}
+
+void ResetProfile8080(Profile8080 *prof)
+{
+  memset(prof, 0, sizeof(Profile8080));
+}
+
+static void Totals(const Profile8080 *prof, uint64_t *count, uint64_t *cycles)
+{
+  int i;
+  *count = *cycles = 0;
+  for(i = 0; i < 256; i++)
+    *count += prof->op[i];
+  for(i = 0; i < 0x10000; i++)
+    *cycles += prof->cycles[i];
+}
+
+int WriteProfileJSON8080(const Profile8080 *prof, FILE *out)
+{
+  uint64_t count, cycles;
+  const char *sep = "";
+  int i;
+
+  Totals(prof, &count, &cycles);
+  fprintf(out, "{\n  \"instructions\": %llu,\n  \"cycles\": %llu,\n",
+      (unsigned long long)count, (unsigned long long)cycles);
+  fprintf(out, "  \"opcodes\": {");
+  for(i = 0; i < 256; i++)
+  {
+    if(prof->op[i] == 0)
+      continue;
+    fprintf(out, "%s\n    \"0x%02x\": %llu", sep, i, (unsigned long long)prof->op[i]);
+    sep = ",";
+  }
+  fprintf(out, "\n  },\n  \"pcs\": [");
+  sep = "";
+  for(i = 0; i < 0x10000; i++)
+  {
+    if(prof->pc[i] == 0)
+      continue;
+    fprintf(out, "%s\n    {\"pc\": %d, \"count\": %llu, \"cycles\": %llu}", sep, i,
+        (unsigned long long)prof->pc[i], (unsigned long long)prof->cycles[i]);
+    sep = ",";
+  }
+  fprintf(out, "\n  ]\n}\n");
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
+
+typedef struct Hot {
+  uint64_t cycles;
+  int pc;
+} Hot;
+
+static int ByCycles(const void *x, const void *y)
+{
+  const Hot *a = x, *b = y;
+  if(a->cycles != b->cycles)
+    return a->cycles < b->cycles ? 1 : -1;
+  return a->pc - b->pc;
+}
+
+static double Percent(uint64_t part, uint64_t whole)
+{
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+int WriteProfileText8080(const Profile8080 *prof, const State8080 *state,
+    FILE *out, int top)
+{
+  uint64_t count, cycles;
+  int i, n = 0;
+
+  Totals(prof, &count, &cycles);
+  fprintf(out, "# %llu instructions, %llu cycles\n\n",
+      (unsigned long long)count, (unsigned long long)cycles);
+
+  fprintf(out, "opcode        count       %%\n");
+  for(i = 0; i < 256; i++)
+    if(prof->op[i])
+      fprintf(out, "    %02x %12llu  %6.2f\n", i,
+          (unsigned long long)prof->op[i], Percent(prof->op[i], count));
+
+  Hot *hot = malloc(sizeof(Hot) * 0x10000);
+  if(hot == NULL)
+    return EMU_ERR_NOMEM;
+  for(i = 0; i < 0x10000; i++)
+    if(prof->pc[i])
+    {
+      hot[n].cycles = prof->cycles[i];
+      hot[n].pc = i;
+      n++;
+    }
+  qsort(hot, n, sizeof(Hot), ByCycles);
+  if(top > 0 && top < n)
+    n = top;
+
+  fprintf(out, "\n       count       cycles       %%  instruction\n");
+  for(i = 0; i < n; i++)
+  {
+    uint8_t code[3];
+    int pc = hot[i].pc;
+    ReadBlock8080(state, pc, code, 3);
+    fprintf(out, "%12llu %12llu  %6.2f  ", (unsigned long long)prof->pc[pc],
+        (unsigned long long)hot[i].cycles, Percent(hot[i].cycles, cycles));
+    Disassemble8080f(out, code, pc);
+    fprintf(out, "\n");
+  }
+  free(hot);
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
@@ -0,0 +1,33 @@
+#ifndef EMULATE_PROFILE_H
+#define EMULATE_PROFILE_H
+
+#include <stdio.h>
+
+#include "8080.h"
+
+// Execution counts per opcode and per guest address.  Point
+// state->profile at one of these and Run8080/Emulate8080p switch to the
+// profiling variant of the core.  With state->profile and state->calls
+// (calls.h) both NULL the core runs the plain variant, which has no
+// counting code in it.  A profile may be shared by machines run from the
+// same thread only.
+typedef struct Profile8080 {
+  uint64_t op[256];         // executions per opcode
+  uint64_t pc[0x10000];     // executions per instruction address
+  uint64_t cycles[0x10000]; // cycles charged per instruction address
+} Profile8080;
+
+// Returns a zeroed profile, or NULL if allocation fails.
+Profile8080 *InitProfile8080(void);
+void FreeProfile8080(Profile8080 *prof);
+void ResetProfile8080(Profile8080 *prof);
+
+// Every counter that isn't zero, as one JSON object.
+int WriteProfileJSON8080(const Profile8080 *prof, FILE *out);
+
+// Opcode mix, then the `top` hottest addresses by cycles with the
+// instruction found there in `state`'s memory.  top <= 0 lists them all.
+int WriteProfileText8080(const Profile8080 *prof, const State8080 *state,
+    FILE *out, int top);
+
+#endif
@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "rewind.h"
+#include "savestate.h"
+
+#define RW_PAGE   256
+#define RW_PAGES  (RAM_SIZE / RW_PAGE)
+
+// Page record modes.  An RLE page is a list of (skip, count, bytes...)
+// runs over the XOR of old and new contents; a page that doesn't shrink
+// under RLE is stored as the raw 256-byte XOR.
+enum { PAGE_RLE = 0, PAGE_RAW = 1 };
+
+#define MAX_DELTA  (RW_PAGES * (2 + RW_PAGE))
+
+// Arena layout of one entry: SAVESTATE_HEADER_SIZE bytes of registers,
+// `delta` bytes of page records, then RAM_SIZE bytes on keyframes.
+typedef struct Entry {
+  size_t offset;
+  uint32_t size;
+  uint32_t delta;
+  int keyframe;
+} Entry;
+
+struct Rewind8080 {
+  uint8_t *arena;
+  size_t cap;
+  size_t head;          // end of the newest entry
+  size_t used;
+
+  Entry *entry;         // ring of entries, oldest at `first`
+  int max_entries;
+  int first;
+  int count;
+
+  int keyframe;
+  int since_key;
+  int have_prev;
+  uint8_t prev[RAM_SIZE];                 // RAM of the newest entry
+  uint8_t scratch[SAVESTATE_HEADER_SIZE + MAX_DELTA];
+};
+
+static Entry *At(Rewind8080 *rw, int i)
+{
+  return &rw->entry[(rw->first + i) % rw->max_entries];
+}
+
+Rewind8080 *InitRewind8080(size_t budget, int keyframe)
+{
+  size_t min = 2 * (SAVESTATE_HEADER_SIZE + MAX_DELTA + RAM_SIZE);
+  if(budget < min)
+    budget = min;
+  if(keyframe < 1)
+    keyframe = 1;
+
+  Rewind8080 *rw = calloc(1, sizeof(Rewind8080));
+  if(rw == NULL)
+    return NULL;
+  rw->arena = malloc(budget);
+  // Smallest possible entry is the register block alone.
+  rw->max_entries = budget / SAVESTATE_HEADER_SIZE + 1;
+  rw->entry = calloc(rw->max_entries, sizeof(Entry));
+  if(rw->arena == NULL || rw->entry == NULL)
+  {
+    FreeRewind8080(rw);
+    return NULL;
+  }
+  rw->cap = budget;
+  rw->keyframe = keyframe;
+  return rw;
+}
+
+void FreeRewind8080(Rewind8080 *rw)
+{
+  if(rw == NULL)
+    return;
+  free(rw->entry);
+  free(rw->arena);
+  free(rw);
+}
+
+void ResetRewind8080(Rewind8080 *rw)
+{
+  rw->head = 0;
+  rw->used = 0;
+  rw->first = 0;
+  rw->count = 0;
+  rw->since_key = 0;
+  rw->have_prev = 0;
+}
+
+int RewindDepth8080(const Rewind8080 *rw)
+{
+  return rw->count > 0 ? rw->count - 1 : 0;
+}
+
+size_t RewindBytesUsed8080(const Rewind8080 *rw)
+{
+  return rw->used;
+}
+
+static void DropOldest(Rewind8080 *rw)
+{
+  rw->used -= At(rw, 0)->size;
+  rw->first = (rw->first + 1) % rw->max_entries;
+  rw->count--;
+  if(rw->count == 0)
+    rw->head = 0;
+}
+
+// Finds room for `size` bytes, dropping the oldest frames as needed.
+static int Place(Rewind8080 *rw, size_t size, size_t *offset)
+{
+  if(size > rw->cap)
+    return 0;
+  for(;;)
+  {
+    if(rw->count == rw->max_entries)
+    {
+      DropOldest(rw);
+      continue;
+    }
+    if(rw->count == 0)
+    {
+      *offset = 0;
+      return 1;
+    }
+    size_t oldest = At(rw, 0)->offset;
+    if(oldest < rw->head)
+    {
+      if(rw->cap - rw->head >= size)
+      {
+        *offset = rw->head;
+        return 1;
+      }
+      if(oldest >= size)
+      {
+        *offset = 0;
+        return 1;
+      }
+    }
+    else if(oldest - rw->head >= size)
+    {
+      *offset = rw->head;
+      return 1;
+    }
+    DropOldest(rw);
+  }
+}
+
+static size_t EncodePage(const uint8_t *x, uint8_t *out)
+{
+  size_t n = 0;
+  int pos = 0;
+  while(pos < RW_PAGE)
+  {
+    int skip = 0, len = 0;
+    while(pos < RW_PAGE && x[pos] == 0 && skip < 255)
+    {
+      skip++;
+      pos++;
+    }
+    size_t at = n;
+    n += 2;
+    while(pos < RW_PAGE && x[pos] != 0 && len < 255)
+      out[n + len++] = x[pos++];
+    out[at] = skip;
+    out[at + 1] = len;
+    n += len;
+  }
+  return n;
+}
+
+// XORs a list of page records into ram.
+static void ApplyDelta(uint8_t *ram, const uint8_t *p, uint32_t size)
+{
+  const uint8_t *end = p + size;
+  while(p < end)
+  {
+    uint8_t *dst = ram + p[0] * RW_PAGE;
+    int mode = p[1];
+    int i;
+    p += 2;
+    if(mode == PAGE_RAW)
+    {
+      for(i = 0; i < RW_PAGE; i++)
+        dst[i] ^= p[i];
+      p += RW_PAGE;
+      continue;
+    }
+    int pos = 0;
+    while(pos < RW_PAGE)
+    {
+      int len = p[1];
+      pos += p[0];
+      p += 2;
+      for(i = 0; i < len; i++)
+        dst[pos++] ^= *p++;
+    }
+  }
+}
+
+int PushRewind8080(Rewind8080 *rw, const State8080 *state)
+{
+  uint8_t *const *ram = &state->rpage[RAM_BASE >> 8];
+  uint8_t *delta = rw->scratch + SAVESTATE_HEADER_SIZE;
+  uint32_t dsize = 0;
+  int page, i;
+
+  SaveStateHeader8080(state, rw->scratch);
+
+  if(rw->have_prev)
+  {
+    for(page = 0; page < RW_PAGES; page++)
+    {
+      const uint8_t *cur = ram[page];
+      uint8_t *old = rw->prev + page * RW_PAGE;
+      uint8_t x[RW_PAGE];
+      uint8_t rle[2 + 3 * RW_PAGE];
+      if(memcmp(cur, old, RW_PAGE) == 0)
+        continue;
+      for(i = 0; i < RW_PAGE; i++)
+        x[i] = cur[i] ^ old[i];
+      memcpy(old, cur, RW_PAGE);
+
+      size_t n = EncodePage(x, rle);
+      delta[dsize++] = page;
+      if(n < RW_PAGE)
+      {
+        delta[dsize++] = PAGE_RLE;
+        memcpy(&delta[dsize], rle, n);
+        dsize += n;
+      }
+      else
+      {
+        delta[dsize++] = PAGE_RAW;
+        memcpy(&delta[dsize], x, RW_PAGE);
+        dsize += RW_PAGE;
+      }
+    }
+  }
+  else
+  {
+    ReadBlock8080(state, RAM_BASE, rw->prev, RAM_SIZE);
+    rw->have_prev = 1;
+    rw->since_key = 0;
+  }
+
+  int key = (rw->since_key == 0);
+  size_t size = SAVESTATE_HEADER_SIZE + dsize + (key ? RAM_SIZE : 0);
+  size = (size + 7) & ~(size_t)7;
+  size_t offset;
+  if(!Place(rw, size, &offset))
+    return EMU_ERR_NOMEM;
+
+  memcpy(rw->arena + offset, rw->scratch, SAVESTATE_HEADER_SIZE + dsize);
+  if(key)
+    ReadBlock8080(state, RAM_BASE, rw->arena + offset + SAVESTATE_HEADER_SIZE + dsize, RAM_SIZE);
+
+  Entry *e = &rw->entry[(rw->first + rw->count) % rw->max_entries];
+  e->offset = offset;
+  e->size = size;
+  e->delta = dsize;
+  e->keyframe = key;
+  rw->count++;
+  rw->head = offset + size;
+  rw->used += size;
+  rw->since_key = (rw->since_key + 1) % rw->keyframe;
+  return EMU_OK;
+}
+
+int StepBackRewind8080(Rewind8080 *rw, State8080 *state, int frames)
+{
+  int newest = rw->count - 1;
+  int target = newest - frames;
+  int key, i;
+  if(frames < 0 || target < 0)
+    return EMU_ERR_FORMAT;
+
+  for(key = target; key >= 0 && !At(rw, key)->keyframe; key--)
+    ;
+
+  if(key >= 0 && target - key < frames)
+  {
+    // Start from the keyframe's RAM and roll forward.
+    Entry *k = At(rw, key);
+    memcpy(rw->prev, rw->arena + k->offset + SAVESTATE_HEADER_SIZE + k->delta, RAM_SIZE);
+    for(i = key + 1; i <= target; i++)
+    {
+      Entry *e = At(rw, i);
+      ApplyDelta(rw->prev, rw->arena + e->offset + SAVESTATE_HEADER_SIZE, e->delta);
+    }
+  }
+  else
+  {
+    // Undo one frame at a time from the newest.
+    for(i = newest; i > target; i--)
+    {
+      Entry *e = At(rw, i);
+      ApplyDelta(rw->prev, rw->arena + e->offset + SAVESTATE_HEADER_SIZE, e->delta);
+    }
+  }
+
+  Entry *t = At(rw, target);
+  if(LoadStateHeader8080(state, rw->arena + t->offset) != EMU_OK)
+    return EMU_ERR_FORMAT;
+  if(WriteBlock8080(state, RAM_BASE, rw->prev, RAM_SIZE) != EMU_OK)
+    return EMU_ERR_NOMEM;
+
+  for(i = newest; i > target; i--)
+    rw->used -= At(rw, i)->size;
+  rw->count = target + 1;
+  rw->head = t->offset + t->size;
+  rw->since_key = (key >= 0) ? (target - key + 1) % rw->keyframe : 0;
+  return EMU_OK;
+}
@@ -0,0 +1,35 @@
+#ifndef EMULATE_REWIND_H
+#define EMULATE_REWIND_H
+
+#include <stddef.h>
+
+#include "8080.h"
+
+// Frame history for stepping a machine backwards.  Every pushed frame
+// stores the register block and an XOR delta of the 256-byte RAM pages
+// that changed since the previous frame, run-length encoded.  Every
+// `keyframe` frames the full RAM is stored as well, so a long jump can
+// start from a keyframe and roll forward instead of undoing every frame.
+// Entries live in a byte ring of `budget` bytes; the oldest frames are
+// dropped when it fills up.
+typedef struct Rewind8080 Rewind8080;
+
+// budget is in bytes; it is raised to two worst-case entries (about
+// 33 KB) if smaller.  Returns NULL on failure.
+Rewind8080 *InitRewind8080(size_t budget, int keyframe);
+void FreeRewind8080(Rewind8080 *rw);
+void ResetRewind8080(Rewind8080 *rw);
+
+// Records the machine's current frame.  Call once per frame.
+int PushRewind8080(Rewind8080 *rw, const State8080 *state);
+
+// Puts the machine back to the frame recorded `frames` pushes before
+// the newest one and forgets everything newer.  Returns EMU_ERR_FORMAT
+// if the history isn't that deep.
+int StepBackRewind8080(Rewind8080 *rw, State8080 *state, int frames);
+
+// Number of frames StepBackRewind8080 can go back.
+int RewindDepth8080(const Rewind8080 *rw);
+size_t RewindBytesUsed8080(const Rewind8080 *rw);
+
+#endif
@@ -0,0 +1,40 @@
+#include "runahead.h"
+
+void InitRunAhead8080(RunAhead8080 *ra, int frames)
+{
+  ra->frames = frames > 0 ? frames : 0;
+  ra->emulated = 0;
+  ra->shown = 0;
+}
+
+int RunAheadFrame8080(RunAhead8080 *ra, State8080 *state, uint32_t *pixels,
+    uint32_t on, uint32_t off)
+{
+  int i, status, hidden = EMU_OK;
+
+  status = RunFrame8080(state);
+  ra->emulated++;
+  if(status != EMU_OK || ra->frames == 0)
+  {
+    if(status == EMU_OK)
+    {
+      ConvertVideo8080(state, pixels, on, off);
+      ra->shown++;
+    }
+    return status;
+  }
+
+  SaveState8080(state, &ra->save, sizeof(ra->save));
+  for(i = 0; i < ra->frames && hidden == EMU_OK; i++)
+  {
+    hidden = RunFrame8080(state);
+    ra->emulated++;
+  }
+  if(hidden == EMU_OK)
+  {
+    ConvertVideo8080(state, pixels, on, off);
+    ra->shown++;
+  }
+  status = LoadState8080(state, &ra->save, sizeof(ra->save));
+  return (status != EMU_OK) ? status : hidden;
+}
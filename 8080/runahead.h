@@ -0,0 +1,35 @@
+#ifndef EMULATE_RUNAHEAD_H
+#define EMULATE_RUNAHEAD_H
+
+#include "8080.h"
+#include "savestate.h"
+#include "video.h"
+
+// Run-ahead hides the frames of input lag the game builds in.  Each
+// displayed frame runs the real frame, saves the machine, runs `frames`
+// more with the same inputs and shows the last of those, then restores
+// the save.  What's on screen is what the game would draw `frames`
+// frames from now if the inputs didn't change, so a button press shows
+// up that many frames sooner.
+//
+// The cost is frames + 1 emulated frames, one save and one restore per
+// displayed frame; video is converted only for the frame shown.  The
+// hidden frames are real work and count in state->metrics like any
+// other; don't run ahead with a profiler or call graph attached.
+typedef struct RunAhead8080 {
+  int frames;           // frames run ahead; 0 is plain emulation
+  uint64_t emulated;    // frames run, hidden ones included
+  uint64_t shown;       // frames displayed
+  SaveImage8080 save;
+} RunAhead8080;
+
+void InitRunAhead8080(RunAhead8080 *ra, int frames);
+
+// Runs one displayed frame with the inputs in state->io.in and converts
+// the frame to show into pixels (VIDEO_WIDTH * VIDEO_HEIGHT).  The
+// machine is left after the real frame.  Returns the first non-EMU_OK
+// status; if a hidden frame fails, the machine is still restored.
+int RunAheadFrame8080(RunAhead8080 *ra, State8080 *state, uint32_t *pixels,
+    uint32_t on, uint32_t off);
+
+#endif
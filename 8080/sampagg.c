@@ -0,0 +1,118 @@
+// Summarises a sample file written by WriteSamples8080:
+//
+//   sampagg samples [rom]
+//
+// prints the opcode mix and the hottest addresses, disassembled from
+// rom when it is given.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "8080.h"
+#include "sampler.h"
+
+typedef struct Hot {
+  uint64_t count;
+  int key;
+} Hot;
+
+static int ByCount(const void *x, const void *y)
+{
+  const Hot *a = x, *b = y;
+  if(a->count != b->count)
+    return a->count < b->count ? 1 : -1;
+  return a->key - b->key;
+}
+
+// Moves the non-zero entries to the front, sorted.  Returns how many.
+static int Rank(Hot *hot, int n)
+{
+  int i, m = 0;
+  for(i = 0; i < n; i++)
+    if(hot[i].count)
+      hot[m++] = hot[i];
+  qsort(hot, m, sizeof(Hot), ByCount);
+  return m;
+}
+
+int main(int argc, char *argv[])
+{
+  static Hot pc[0x10000], op[256];
+  static uint8_t rom[0x10000 + 2];
+  uint32_t header[4];
+  uint64_t total = 0, idle = 0, dropped = 0;
+  int have_rom = 0;
+  int i, t, n;
+
+  if(argc < 2)
+  {
+    printf("usage: %s samples [rom]\n", argv[0]);
+    return 1;
+  }
+  FILE *f = fopen(argv[1], "rb");
+  if(f == NULL || fread(header, sizeof(header), 1, f) != 1 ||
+      header[0] != SAMPLER_MAGIC || header[1] != SAMPLER_VERSION)
+  {
+    printf("Error: %s isn't a sample file\n", argv[1]);
+    return 1;
+  }
+  if(argc > 2)
+  {
+    FILE *r = fopen(argv[2], "rb");
+    if(r == NULL)
+    {
+      printf("Error: couldn't open %s\n", argv[2]);
+      return 1;
+    }
+    fread(rom, 1, 0x10000, r);
+    fclose(r);
+    have_rom = 1;
+  }
+
+  for(i = 0; i < 0x10000; i++)
+    pc[i].key = i;
+  for(i = 0; i < 256; i++)
+    op[i].key = i;
+  for(t = 0; t < (int)header[3]; t++)
+  {
+    uint64_t count[3];
+    Sample8080 s;
+    uint64_t k;
+    if(fread(count, sizeof(count), 1, f) != 1)
+      break;
+    for(k = 0; k < count[0] && fread(&s, sizeof(s), 1, f) == 1; k++)
+    {
+      pc[s.pc].count++;
+      op[s.opcode].count++;
+    }
+    total += k;
+    idle += count[1];
+    dropped += count[2];
+    printf("thread %d: %llu samples, %llu idle, %llu dropped\n", t,
+        (unsigned long long)k, (unsigned long long)count[1], (unsigned long long)count[2]);
+  }
+  fclose(f);
+  printf("# %llu samples at %u Hz, %llu idle, %llu dropped\n\n",
+      (unsigned long long)total, header[2], (unsigned long long)idle, (unsigned long long)dropped);
+
+  n = Rank(op, 256);
+  printf("opcode      samples       %%\n");
+  for(i = 0; i < n; i++)
+    printf("    %02x %12llu  %6.2f\n", op[i].key, (unsigned long long)op[i].count,
+        100.0 * op[i].count / total);
+
+  n = Rank(pc, 0x10000);
+  if(n > 200)
+    n = 200;
+  printf("\n     samples       %%  address\n");
+  for(i = 0; i < n; i++)
+  {
+    printf("%12llu  %6.2f  ", (unsigned long long)pc[i].count, 100.0 * pc[i].count / total);
+    if(have_rom)
+      Disassemble8080f(stdout, &rom[pc[i].key], pc[i].key);
+    else
+      printf("%04x", pc[i].key);
+    printf("\n");
+  }
+  return 0;
+}
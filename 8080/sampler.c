@@ -0,0 +1,170 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "sampler.h"
+
+typedef struct Buffer {
+  Sample8080 *sample;
+  atomic_size_t count;
+  atomic_uint_fast64_t idle;
+  atomic_uint_fast64_t dropped;
+} __attribute__((aligned(64))) Buffer;
+
+static struct {
+  int hz;
+  int max_threads;
+  size_t per_thread;
+  Buffer *buf;
+  Sample8080 *storage;
+  atomic_int claimed;
+  atomic_uint_fast64_t dropped;   // ticks on threads past max_threads
+  struct sigaction old;
+  int running;
+} sampler;
+
+// Slot in sampler.buf, plus one so that zero means "none yet".  The
+// generation guards against a slot claimed under an earlier sampler.
+static _Thread_local int slot;
+static _Thread_local int slot_generation;
+static int generation;
+
+static void OnProf(int sig, siginfo_t *info, void *context)
+{
+  int saved = errno;
+  (void)sig;
+  (void)info;
+  (void)context;
+
+  if(slot == 0 || slot_generation != generation)
+  {
+    int n = atomic_fetch_add_explicit(&sampler.claimed, 1, memory_order_relaxed);
+    slot = (n < sampler.max_threads) ? n + 1 : -1;
+    slot_generation = generation;
+  }
+  if(slot < 0)
+  {
+    atomic_fetch_add_explicit(&sampler.dropped, 1, memory_order_relaxed);
+    errno = saved;
+    return;
+  }
+
+  Buffer *b = &sampler.buf[slot - 1];
+  State8080 *state = running8080;
+  if(state == NULL)
+    atomic_fetch_add_explicit(&b->idle, 1, memory_order_relaxed);
+  else
+  {
+    size_t n = atomic_load_explicit(&b->count, memory_order_relaxed);
+    if(n == sampler.per_thread)
+      atomic_fetch_add_explicit(&b->dropped, 1, memory_order_relaxed);
+    else
+    {
+      uint16_t pc = state->pc;
+      Sample8080 *s = &b->sample[n];
+      s->pc = pc;
+      s->opcode = state->rpage[pc >> 8][pc & 0xff];
+      s->pad = 0;
+      s->frame = (uint32_t)state->frames;
+      atomic_store_explicit(&b->count, n + 1, memory_order_release);
+    }
+  }
+  errno = saved;
+}
+
+int StartSampler8080(int hz, int max_threads, size_t per_thread)
+{
+  int i;
+  if(sampler.running)
+    StopSampler8080();
+  if(hz <= 0)
+    hz = 1000;
+  if(max_threads <= 0)
+    max_threads = 1;
+
+  free(sampler.buf);
+  free(sampler.storage);
+  sampler.buf = calloc(max_threads, sizeof(Buffer));
+  sampler.storage = malloc(sizeof(Sample8080) * max_threads * per_thread);
+  if(sampler.buf == NULL || (sampler.storage == NULL && per_thread > 0))
+  {
+    free(sampler.buf);
+    free(sampler.storage);
+    sampler.buf = NULL;
+    sampler.storage = NULL;
+    return EMU_ERR_NOMEM;
+  }
+  for(i = 0; i < max_threads; i++)
+    sampler.buf[i].sample = sampler.storage + i * per_thread;
+  sampler.hz = hz;
+  sampler.max_threads = max_threads;
+  sampler.per_thread = per_thread;
+  atomic_store(&sampler.claimed, 0);
+  atomic_store(&sampler.dropped, 0);
+  generation++;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = OnProf;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  if(sigaction(SIGPROF, &sa, &sampler.old) != 0)
+    return EMU_ERR_IO;
+
+  struct itimerval it;
+  long usec = 1000000L / hz;
+  if(usec == 0)
+    usec = 1;
+  it.it_interval.tv_sec = usec / 1000000;
+  it.it_interval.tv_usec = usec % 1000000;
+  it.it_value = it.it_interval;
+  if(setitimer(ITIMER_PROF, &it, NULL) != 0)
+  {
+    sigaction(SIGPROF, &sampler.old, NULL);
+    return EMU_ERR_IO;
+  }
+  sampler.running = 1;
+  return EMU_OK;
+}
+
+void StopSampler8080(void)
+{
+  struct itimerval it;
+  if(!sampler.running)
+    return;
+  memset(&it, 0, sizeof(it));
+  setitimer(ITIMER_PROF, &it, NULL);
+  sigaction(SIGPROF, &sampler.old, NULL);
+  sampler.running = 0;
+}
+
+int WriteSamples8080(FILE *out)
+{
+  uint32_t header[4];
+  int i, threads;
+
+  threads = atomic_load(&sampler.claimed);
+  if(threads > sampler.max_threads)
+    threads = sampler.max_threads;
+  header[0] = SAMPLER_MAGIC;
+  header[1] = SAMPLER_VERSION;
+  header[2] = sampler.hz;
+  header[3] = threads;
+  fwrite(header, sizeof(header), 1, out);
+  for(i = 0; i < threads; i++)
+  {
+    Buffer *b = &sampler.buf[i];
+    uint64_t count[3];
+    count[0] = atomic_load_explicit(&b->count, memory_order_acquire);
+    count[1] = atomic_load(&b->idle);
+    count[2] = atomic_load(&b->dropped);
+    if(i == 0)
+      count[2] += atomic_load(&sampler.dropped);
+    fwrite(count, sizeof(count), 1, out);
+    fwrite(b->sample, sizeof(Sample8080), count[0], out);
+  }
+  return ferror(out) ? EMU_ERR_IO : EMU_OK;
+}
@@ -0,0 +1,43 @@
+#ifndef EMULATE_SAMPLER_H
+#define EMULATE_SAMPLER_H
+
+#include <stdio.h>
+
+#include "8080.h"
+
+// Statistical profiler.  A process CPU-time interval timer raises
+// SIGPROF `hz` times a second; the handler looks at running8080 on the
+// thread it interrupted and appends that machine's pc and opcode to the
+// thread's own sample buffer.  The interpreter does nothing extra apart
+// from setting running8080 once per Run8080 or Emulate8080p call.  Ticks
+// that land while a thread isn't inside either are counted as idle.
+// SIGPROF goes to whichever thread is using CPU, so `max_threads` has to
+// cover helper threads (metrics dumps, pipelines) as well.
+//
+// Only one sampler runs per process.  A thread's buffer is taken from a
+// fixed pool the first time the signal lands on it; threads beyond
+// `max_threads` and samples beyond `per_thread` are counted as dropped.
+typedef struct Sample8080 {
+  uint16_t pc;
+  uint8_t opcode;
+  uint8_t pad;
+  uint32_t frame;       // low bits of state->frames
+} Sample8080;
+
+#define SAMPLER_MAGIC   0x504d5353  // "SSMP"
+#define SAMPLER_VERSION 1
+
+// Returns EMU_OK, EMU_ERR_NOMEM, or EMU_ERR_IO if the timer or signal
+// handler can't be installed.
+int StartSampler8080(int hz, int max_threads, size_t per_thread);
+// Stops the timer and puts the previous SIGPROF handler back.  The
+// samples stay until the next StartSampler8080.
+void StopSampler8080(void);
+
+// Writes the samples of a stopped sampler.  The file is four uint32_t
+// (magic, version, hz, thread count) followed, per thread, by count,
+// idle and dropped as uint64_t and `count` Sample8080 records, all in
+// host byte order.  sampagg.c reads it.
+int WriteSamples8080(FILE *out);
+
+#endif
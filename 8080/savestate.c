@@ -0,0 +1,89 @@
+#include <string.h>
+
+#include "savestate.h"
+
+_Static_assert(offsetof(SaveImage8080, ram) == 72, "save state header has padding");
+
+void SaveStateHeader8080(const State8080 *state, void *buf)
+{
+  SaveImage8080 *ss = buf;
+
+  ss->magic = SAVESTATE_MAGIC;
+  ss->version = SAVESTATE_VERSION;
+  ss->header_size = offsetof(SaveImage8080, ram);
+  ss->size = SAVESTATE_SIZE;
+  ss->ram_base = RAM_BASE;
+  ss->ram_size = RAM_SIZE;
+
+  ss->a = state->a;
+  ss->b = state->b;
+  ss->c = state->c;
+  ss->d = state->d;
+  ss->e = state->e;
+  ss->h = state->h;
+  ss->l = state->l;
+  ss->flags = state->cc.z | state->cc.s << 1 | state->cc.p << 2 |
+      state->cc.cy << 3 | state->cc.ac << 4 | state->halted << 7;
+  ss->sp = state->sp;
+  ss->pc = state->pc;
+  ss->int_enable = state->int_enable;
+  ss->shift_offset = state->io.shift_offset;
+  ss->shift = state->io.shift;
+  memcpy(ss->in, state->io.in, sizeof(ss->in));
+  memcpy(ss->out, state->io.out, sizeof(ss->out));
+  ss->counter = state->counter;
+  ss->cycles = state->cycles;
+  ss->frames = state->frames;
+}
+
+int SaveState8080(const State8080 *state, void *buf, size_t size)
+{
+  SaveImage8080 *ss = buf;
+  if(size < SAVESTATE_SIZE)
+    return EMU_ERR_FORMAT;
+  SaveStateHeader8080(state, ss);
+  ReadBlock8080(state, RAM_BASE, ss->ram, RAM_SIZE);
+  return EMU_OK;
+}
+
+int LoadStateHeader8080(State8080 *state, const void *buf)
+{
+  const SaveImage8080 *ss = buf;
+  if(ss->magic != SAVESTATE_MAGIC ||
+     ss->version != SAVESTATE_VERSION || ss->size != SAVESTATE_SIZE ||
+     ss->ram_base != RAM_BASE || ss->ram_size != RAM_SIZE)
+    return EMU_ERR_FORMAT;
+
+  state->a = ss->a;
+  state->b = ss->b;
+  state->c = ss->c;
+  state->d = ss->d;
+  state->e = ss->e;
+  state->h = ss->h;
+  state->l = ss->l;
+  state->cc.z = ss->flags;
+  state->cc.s = ss->flags >> 1;
+  state->cc.p = ss->flags >> 2;
+  state->cc.cy = ss->flags >> 3;
+  state->cc.ac = ss->flags >> 4;
+  state->halted = ss->flags >> 7;
+  state->sp = ss->sp;
+  state->pc = ss->pc;
+  state->int_enable = ss->int_enable;
+  state->io.shift_offset = ss->shift_offset;
+  state->io.shift = ss->shift;
+  memcpy(state->io.in, ss->in, sizeof(ss->in));
+  memcpy(state->io.out, ss->out, sizeof(ss->out));
+  state->counter = ss->counter;
+  state->cycles = ss->cycles;
+  state->frames = ss->frames;
+  return EMU_OK;
+}
+
+int LoadState8080(State8080 *state, const void *buf, size_t size)
+{
+  const SaveImage8080 *ss = buf;
+  if(size < SAVESTATE_SIZE || LoadStateHeader8080(state, ss) != EMU_OK)
+    return EMU_ERR_FORMAT;
+  return WriteBlock8080(state, RAM_BASE, ss->ram, RAM_SIZE);
+}
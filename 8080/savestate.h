@@ -0,0 +1,59 @@
+#ifndef EMULATE_SAVESTATE_H
+#define EMULATE_SAVESTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "8080.h"
+
+// Save states are a fixed-size, host-endian image: a small header, the
+// CPU and device block, then RAM_SIZE bytes of RAM.  ROM isn't stored;
+// restore into a machine that has the same ROM loaded.  Nothing here
+// allocates, and restore is a handful of stores plus one memcpy, so it
+// is cheap enough to call every frame for rollback or run-ahead.
+#define SAVESTATE_MAGIC    0x53303830u   // "080S" read little-endian
+#define SAVESTATE_VERSION  1
+
+typedef struct SaveImage8080 {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;     // offset of ram[]
+  uint32_t size;            // whole image, header included
+  uint16_t ram_base;
+  uint16_t ram_size;
+
+  uint8_t a, b, c, d, e, h, l;
+  uint8_t flags;            // z s p cy ac in bits 0-4; 7: halted
+  uint16_t sp;
+  uint16_t pc;
+  uint8_t int_enable;
+  uint8_t shift_offset;
+  uint16_t shift;
+  uint8_t in[8];
+  uint8_t out[8];
+  uint64_t counter;
+  uint64_t cycles;
+  uint64_t frames;
+
+  uint8_t ram[RAM_SIZE];
+} SaveImage8080;
+
+#define SAVESTATE_SIZE         sizeof(SaveImage8080)
+#define SAVESTATE_HEADER_SIZE  offsetof(SaveImage8080, ram)
+
+// buf must be 8-byte aligned.
+
+// Writes the machine into buf.  Returns EMU_OK, or EMU_ERR_FORMAT if
+// size is smaller than SAVESTATE_SIZE.
+int SaveState8080(const State8080 *state, void *buf, size_t size);
+
+// Restores a machine from buf.  Returns EMU_ERR_FORMAT, leaving the
+// machine untouched, if the image isn't a version this build reads.
+int LoadState8080(State8080 *state, const void *buf, size_t size);
+
+// The same, for everything except RAM (SAVESTATE_HEADER_SIZE bytes).
+// Used by code that keeps RAM some other way, such as rewind deltas.
+void SaveStateHeader8080(const State8080 *state, void *buf);
+int LoadStateHeader8080(State8080 *state, const void *buf);
+
+#endif
@@ -0,0 +1,145 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shmfb.h"
+
+static ShmFb8080 *Map(const char *name, int writer)
+{
+  ShmFb8080 *fb = calloc(1, sizeof(ShmFb8080));
+  int fd;
+  if(fb == NULL)
+    return NULL;
+  snprintf(fb->name, sizeof(fb->name), "%s", name);
+  fb->writer = writer;
+
+  fd = shm_open(name, writer ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if(fd < 0)
+    goto fail;
+  if(writer && ftruncate(fd, sizeof(ShmHeader8080)) < 0)
+  {
+    close(fd);
+    goto fail;
+  }
+  if(!writer)
+  {
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ShmHeader8080))
+    {
+      close(fd);
+      goto fail;
+    }
+  }
+  fb->shm = mmap(NULL, sizeof(ShmHeader8080), writer ? PROT_READ | PROT_WRITE : PROT_READ,
+      MAP_SHARED, fd, 0);
+  close(fd);
+  if(fb->shm == MAP_FAILED)
+    goto fail;
+  return fb;
+
+fail:
+  if(writer)
+    shm_unlink(name);
+  free(fb);
+  return NULL;
+}
+
+ShmFb8080 *OpenShmExport8080(const char *name)
+{
+  ShmFb8080 *fb = Map(name, 1);
+  ShmHeader8080 *h;
+  int i;
+  if(fb == NULL)
+    return NULL;
+  h = fb->shm;
+  // A viewer that mapped an older incarnation sees the magic go away
+  // while this is filled in.
+  h->magic = 0;
+  atomic_thread_fence(memory_order_release);
+  h->version = SHMFB_VERSION;
+  h->slots = SHMFB_SLOTS;
+  h->size = sizeof(ShmHeader8080);
+  h->width = 256;
+  h->height = 224;
+  for(i = 0; i < SHMFB_SLOTS; i++)
+  {
+    atomic_store_explicit(&h->slot[i].seq, 0, memory_order_relaxed);
+    h->slot[i].frame = 0;
+  }
+  atomic_store_explicit(&h->latest, 0, memory_order_relaxed);
+  atomic_store_explicit(&h->published, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  h->magic = SHMFB_MAGIC;
+  return fb;
+}
+
+void PublishShmFrame8080(ShmFb8080 *fb, const State8080 *state)
+{
+  ShmHeader8080 *h = fb->shm;
+  uint32_t next = (atomic_load_explicit(&h->latest, memory_order_relaxed) + 1) % SHMFB_SLOTS;
+  ShmSlot8080 *s = &h->slot[next];
+  uint64_t seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+
+  atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  s->frame = state->frames;
+  ReadBlock8080(state, VRAM_BASE, s->vram, VRAM_SIZE);
+  atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+  atomic_store_explicit(&h->latest, next, memory_order_release);
+  atomic_store_explicit(&h->published,
+      atomic_load_explicit(&h->published, memory_order_relaxed) + 1, memory_order_release);
+}
+
+ShmFb8080 *OpenShmViewer8080(const char *name)
+{
+  ShmFb8080 *fb = Map(name, 0);
+  if(fb == NULL)
+    return NULL;
+  if(fb->shm->magic != SHMFB_MAGIC || fb->shm->version != SHMFB_VERSION ||
+     fb->shm->size != sizeof(ShmHeader8080))
+  {
+    CloseShmFb8080(fb);
+    return NULL;
+  }
+  return fb;
+}
+
+int ReadShmFrame8080(ShmFb8080 *fb, uint8_t *vram, uint64_t *frame)
+{
+  ShmHeader8080 *h = fb->shm;
+  for(;;)
+  {
+    ShmSlot8080 *s = &h->slot[atomic_load_explicit(&h->latest, memory_order_acquire)];
+    uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    uint64_t f;
+    if(seq == 0)          // nothing published yet
+      return 0;
+    if(seq & 1)
+      continue;
+    f = s->frame;
+    if(f == fb->last)
+      return 0;
+    memcpy(vram, s->vram, VRAM_SIZE);
+    atomic_thread_fence(memory_order_acquire);
+    if(atomic_load_explicit(&s->seq, memory_order_relaxed) != seq)
+      continue;
+    fb->last = f;
+    *frame = f;
+    return 1;
+  }
+}
+
+void CloseShmFb8080(ShmFb8080 *fb)
+{
+  if(fb == NULL)
+    return;
+  if(fb->shm)
+    munmap(fb->shm, sizeof(ShmHeader8080));
+  if(fb->writer)
+    shm_unlink(fb->name);
+  free(fb);
+}
@@ -0,0 +1,66 @@
+#ifndef EMULATE_SHMFB_H
+#define EMULATE_SHMFB_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "8080.h"
+
+// Finished frames published in a POSIX shared-memory segment for
+// viewers in other processes.  The segment holds SHMFB_SLOTS copies of
+// VRAM (1bpp, as ConvertVram8080 in video.h reads it), each guarded by
+// its own sequence counter, and the index of the newest.
+//
+// Publishing is a copy of VRAM and a few atomic stores: no syscall and
+// no lock, and the emulator never waits.  It writes the slot after the
+// newest one, so a viewer copying the newest frame has two frames'
+// time before that slot comes round again.  A viewer checks the slot's
+// counter before and after its copy (a seqlock) and tries again if the
+// writer got there first, so it never shows a torn frame.
+#define SHMFB_MAGIC    0x42463830u   // "08FB" read little-endian
+#define SHMFB_VERSION  1
+#define SHMFB_SLOTS    3
+
+typedef struct ShmSlot8080 {
+  _Atomic uint64_t seq;     // odd while being written
+  uint64_t frame;           // state->frames when published
+  uint8_t vram[VRAM_SIZE];
+} __attribute__((aligned(64))) ShmSlot8080;
+
+typedef struct ShmHeader8080 {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t slots;
+  uint32_t size;            // whole segment
+  uint16_t width;           // VRAM as stored: 256 x 224 pixels, 1bpp
+  uint16_t height;
+  _Atomic uint32_t latest;  // slot holding the newest frame
+  _Atomic uint64_t published;
+  ShmSlot8080 slot[SHMFB_SLOTS];
+} ShmHeader8080;
+
+typedef struct ShmFb8080 {
+  ShmHeader8080 *shm;
+  int writer;
+  uint64_t last;            // viewer: frame number of the last read
+  char name[64];
+} ShmFb8080;
+
+// Creates (or reuses) the segment `name` ("/invaders") for publishing.
+// Returns NULL on failure.
+ShmFb8080 *OpenShmExport8080(const char *name);
+// Copies the machine's VRAM into the next slot and makes it the newest.
+void PublishShmFrame8080(ShmFb8080 *fb, const State8080 *state);
+
+// Maps an existing segment read-only.  Returns NULL if it doesn't exist
+// or isn't a version this build reads.
+ShmFb8080 *OpenShmViewer8080(const char *name);
+// Copies the newest frame into vram (VRAM_SIZE bytes).  Returns 1 and
+// sets *frame if there is a frame newer than the last one read, 0 if
+// not.
+int ReadShmFrame8080(ShmFb8080 *fb, uint8_t *vram, uint64_t *frame);
+
+// Unmaps; the exporting side also removes the name.
+void CloseShmFb8080(ShmFb8080 *fb);
+
+#endif
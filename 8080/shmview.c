@@ -0,0 +1,75 @@
+// Reads the frames main -F publishes:
+//
+//   shmview name [out.pgm [count]]
+//
+// waits for the next frame in shared memory `name` and writes it to
+// out.pgm (default frame.pgm).  With count it keeps reading for count
+// frames, reports how many it saw and how many it missed, and writes
+// the last.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "8080.h"
+#include "shmfb.h"
+#include "video.h"
+
+static int WritePgm(const char *path, const uint8_t *vram)
+{
+  static uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+  FILE *f = fopen(path, "wb");
+  int i;
+  if(f == NULL)
+    return EMU_ERR_IO;
+  ConvertVram8080(vram, pixels, 255, 0);
+  fprintf(f, "P5\n%d %d\n255\n", VIDEO_WIDTH, VIDEO_HEIGHT);
+  for(i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++)
+    fputc(pixels[i], f);
+  return fclose(f) == 0 ? EMU_OK : EMU_ERR_IO;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *out = argc > 2 ? argv[2] : "frame.pgm";
+  long count = argc > 3 ? atol(argv[3]) : 1;
+  struct timespec nap = { 0, 1000000 };
+  static uint8_t vram[VRAM_SIZE];
+  uint64_t frame, first = 0, last = 0;
+  long seen = 0;
+  ShmFb8080 *fb;
+
+  if(argc < 2)
+  {
+    printf("usage: %s name [out.pgm [count]]\n", argv[0]);
+    return 1;
+  }
+  if((fb = OpenShmViewer8080(argv[1])) == NULL)
+  {
+    printf("Error: couldn't open shared memory %s\n", argv[1]);
+    return 1;
+  }
+
+  // Polls; the emulator has no way to wake a viewer and isn't meant to.
+  while(seen < count)
+  {
+    if(!ReadShmFrame8080(fb, vram, &frame))
+    {
+      nanosleep(&nap, NULL);
+      continue;
+    }
+    if(seen++ == 0)
+      first = frame;
+    last = frame;
+  }
+  CloseShmFb8080(fb);
+
+  if(count > 1)
+    printf("%ld frames, %llu..%llu, %llu missed\n", seen, (unsigned long long)first,
+        (unsigned long long)last, (unsigned long long)(last - first + 1 - seen));
+  if(WritePgm(out, vram) != EMU_OK)
+  {
+    printf("Error: couldn't write %s\n", out);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,808 @@
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SOA_HAVE_AVX2 1
+#endif
+
+#include "soa.h"
+
+// What the shared decode can do for all lanes at once.  Register work
+// is vectorised; loads, stores and the stack go through each lane's own
+// page table in a loop over the lanes, which still saves every lane its
+// fetch and decode.  Everything else (ADC, SBB, DAA, I/O, HLT and the
+// like) is run by the scalar core, one lane at a time.
+enum {
+  V_NONE = 0,
+  V_NOP,
+  V_MOV,
+  V_MVI,
+  V_LXI,
+  V_INX,
+  V_DCX,
+  V_INR,
+  V_DCR,
+  V_ALU,
+  V_ALUM,     // ALU with (HL)
+  V_ALUI,     // ALU with an immediate
+  V_JMP,
+  V_JCC,
+  V_LOAD,
+  V_STORE,
+  V_PUSH,
+  V_POP,
+  V_CALL,     // CALL and Ccc
+  V_RET,      // RET and Rcc
+  V_DAD,
+  V_XCHG,
+  V_ROT,
+  V_MISC,     // CMA, STC, CMC, DI, EI
+};
+
+// Values match bits 3-5 of the 0x80-0xbf opcodes.  ADC and SBB aren't
+// done in lanes.
+enum { ALU_ADD = 0, ALU_SUB = 2, ALU_ANA = 4, ALU_XRA = 5, ALU_ORA = 6, ALU_CMP = 7 };
+
+// Row of r[] the M forms read memory into.
+#define ROW_M  6
+
+// Lanes that have gone separate ways run alone for this many cycles
+// before they are compared again.
+#define SOA_BATCH  2048
+
+typedef struct Kernels {
+  int (*same_pc)(const Lanes8080 *l);
+  void (*alu)(Lanes8080 *l, int kind, int src);
+  void (*dcr)(Lanes8080 *l, int reg);
+  void (*jcc)(Lanes8080 *l, const uint8_t *flag, int want, uint16_t target, uint16_t next);
+} Kernels;
+
+static const Kernels *kernels;
+
+static int Classify(uint8_t op)
+{
+  switch(op)
+  {
+    case 0x00:
+      return V_NOP;
+    case 0x01: case 0x11: case 0x21: case 0x31:
+      return V_LXI;
+    case 0x03: case 0x13: case 0x23: case 0x33:
+      return V_INX;
+    case 0x0b: case 0x1b: case 0x2b: case 0x3b:
+      return V_DCX;
+    case 0x09: case 0x19: case 0x29: case 0x39:
+      return V_DAD;
+    case 0x0a: case 0x1a: case 0x3a:
+      return V_LOAD;
+    case 0x02: case 0x12: case 0x32:
+      return V_STORE;
+    case 0x07: case 0x0f: case 0x17: case 0x1f:
+      return V_ROT;
+    case 0x2f: case 0x37: case 0x3f: case 0xf3: case 0xfb:
+      return V_MISC;
+    case 0xc3:
+      return V_JMP;
+    case 0xc9:
+      return V_RET;
+    case 0xcd:
+      return V_CALL;
+    case 0xeb:
+      return V_XCHG;
+    case 0xc6: case 0xd6: case 0xe6: case 0xee: case 0xf6: case 0xfe:
+      return V_ALUI;
+    case 0x76:                            // HLT
+      return V_NONE;
+  }
+  if(op < 0x40)
+  {
+    switch(op & 7)
+    {
+      case 4: return V_INR;
+      case 5: return V_DCR;
+      case 6: return V_MVI;
+    }
+    return V_NONE;
+  }
+  if(op < 0x80)
+  {
+    if((op & 7) == 6)
+      return V_LOAD;
+    return ((op & 0x38) == 0x30) ? V_STORE : V_MOV;
+  }
+  if(op < 0xc0)
+  {
+    int kind = (op >> 3) & 7;
+    if(kind == 1 || kind == 3)
+      return V_NONE;
+    return ((op & 7) == 6) ? V_ALUM : V_ALU;
+  }
+  switch(op & 0xcf)
+  {
+    case 0xc1: return V_POP;
+    case 0xc5: return V_PUSH;
+  }
+  switch(op & 7)
+  {
+    case 0: return V_RET;
+    case 2: return V_JCC;
+    case 4: return V_CALL;
+  }
+  return V_NONE;
+}
+
+static int Parity8(uint8_t x)
+{
+  return !__builtin_parity(x);
+}
+
+// Scalar reference kernels.
+
+static int SamePcScalar(const Lanes8080 *l)
+{
+  int i;
+  for(i = 1; i < l->count; i++)
+    if(l->pc[i] != l->pc[0])
+      return 0;
+  return 1;
+}
+
+static void AluScalar(Lanes8080 *l, int kind, int src)
+{
+  int i;
+  for(i = 0; i < SOA_LANES; i++)
+  {
+    uint8_t a = l->r[7][i];
+    uint8_t x = l->r[src][i];
+    uint8_t res;
+    switch(kind)
+    {
+      case ALU_ADD: res = a + x; l->cy[i] = (res < a); l->ac[i] = ((a & 0x0f) + (x & 0x0f)) > 0x0f; break;
+      case ALU_SUB: res = a - x; l->cy[i] = (x > a); l->ac[i] = (a & 0x0f) >= (x & 0x0f); break;
+      case ALU_CMP: res = a - x; l->cy[i] = (x > a); l->ac[i] = (a & 0x0f) >= (x & 0x0f); break;
+      case ALU_ANA: res = a & x; l->cy[i] = 0; l->ac[i] = ((a | x) & 0x08) != 0; break;
+      case ALU_XRA: res = a ^ x; l->cy[i] = 0; l->ac[i] = 0; break;
+      default:      res = a | x; l->cy[i] = 0; l->ac[i] = 0; break;
+    }
+    if(kind != ALU_CMP)
+      l->r[7][i] = res;
+    l->z[i] = (res == 0);
+    l->s[i] = (res >> 7);
+    l->p[i] = Parity8(res);
+  }
+}
+
+static void DcrScalar(Lanes8080 *l, int reg)
+{
+  int i;
+  for(i = 0; i < SOA_LANES; i++)
+  {
+    uint8_t res = l->r[reg][i] - 1;
+    l->r[reg][i] = res;
+    l->ac[i] = (res & 0x0f) != 0x0f;
+    l->z[i] = (res == 0);
+    l->s[i] = (res >> 7);
+    l->p[i] = Parity8(res);
+  }
+}
+
+static void JccScalar(Lanes8080 *l, const uint8_t *flag, int want, uint16_t target, uint16_t next)
+{
+  int i;
+  for(i = 0; i < SOA_LANES; i++)
+    l->pc[i] = (flag[i] == want) ? target : next;
+}
+
+static const Kernels scalar_kernels = {
+  SamePcScalar, AluScalar, DcrScalar, JccScalar,
+};
+
+#if SOA_HAVE_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+
+static AVX2 __m256i Parity256(__m256i r)
+{
+  const __m256i odd = _mm256_setr_epi8(
+      0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+      0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0);
+  const __m256i nib = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(r, nib);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(r, 4), nib);
+  __m256i x = _mm256_xor_si256(_mm256_shuffle_epi8(odd, lo), _mm256_shuffle_epi8(odd, hi));
+  return _mm256_xor_si256(x, _mm256_set1_epi8(1));
+}
+
+static AVX2 void Zsp256(Lanes8080 *l, __m256i res)
+{
+  const __m256i one = _mm256_set1_epi8(1);
+  __m256i z = _mm256_and_si256(_mm256_cmpeq_epi8(res, _mm256_setzero_si256()), one);
+  __m256i s = _mm256_and_si256(_mm256_srli_epi16(res, 7), one);
+  _mm256_storeu_si256((__m256i *)l->z, z);
+  _mm256_storeu_si256((__m256i *)l->s, s);
+  _mm256_storeu_si256((__m256i *)l->p, Parity256(res));
+}
+
+static AVX2 uint32_t LaneMask16(int lanes)
+{
+  if(lanes <= 0)
+    return 0;
+  if(lanes >= 16)
+    return 0xffffffffu;
+  return (1u << (2 * lanes)) - 1;
+}
+
+static AVX2 int SamePcAvx2(const Lanes8080 *l)
+{
+  __m256i first = _mm256_set1_epi16((short)l->pc[0]);
+  __m256i lo = _mm256_loadu_si256((const __m256i *)&l->pc[0]);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)&l->pc[16]);
+  uint32_t m0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(lo, first));
+  uint32_t m1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(hi, first));
+  uint32_t need0 = LaneMask16(l->count);
+  uint32_t need1 = LaneMask16(l->count - 16);
+  return ((m0 & need0) == need0) && ((m1 & need1) == need1);
+}
+
+static AVX2 void AluAvx2(Lanes8080 *l, int kind, int src)
+{
+  const __m256i one = _mm256_set1_epi8(1);
+  __m256i a = _mm256_loadu_si256((const __m256i *)l->r[7]);
+  __m256i x = _mm256_loadu_si256((const __m256i *)l->r[src]);
+  const __m256i nib = _mm256_set1_epi8(0x0f);
+  __m256i res, cy, ac;
+  switch(kind)
+  {
+    case ALU_ADD:
+      {
+        // Carry out of bit 3: bit 4 of the sum of the low nibbles.
+        __m256i lo = _mm256_add_epi8(_mm256_and_si256(a, nib), _mm256_and_si256(x, nib));
+        ac = _mm256_and_si256(_mm256_srli_epi16(lo, 4), one);
+        res = _mm256_add_epi8(a, x);
+        cy = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(res, a), res), one);
+        break;
+      }
+    case ALU_SUB:
+    case ALU_CMP:
+      {
+        // No borrow from bit 4: A's low nibble is at least x's.
+        __m256i alo = _mm256_and_si256(a, nib);
+        ac = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(alo, _mm256_and_si256(x, nib)), alo), one);
+        res = _mm256_sub_epi8(a, x);
+        cy = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, x), a), one);
+        break;
+      }
+    case ALU_ANA:
+      // Bit 3 of the operands ORed together.
+      ac = _mm256_and_si256(_mm256_srli_epi16(_mm256_or_si256(a, x), 3), one);
+      res = _mm256_and_si256(a, x);
+      cy = _mm256_setzero_si256();
+      break;
+    case ALU_XRA:
+      ac = _mm256_setzero_si256();
+      res = _mm256_xor_si256(a, x);
+      cy = _mm256_setzero_si256();
+      break;
+    default:
+      ac = _mm256_setzero_si256();
+      res = _mm256_or_si256(a, x);
+      cy = _mm256_setzero_si256();
+      break;
+  }
+  if(kind != ALU_CMP)
+    _mm256_storeu_si256((__m256i *)l->r[7], res);
+  _mm256_storeu_si256((__m256i *)l->cy, cy);
+  _mm256_storeu_si256((__m256i *)l->ac, ac);
+  Zsp256(l, res);
+}
+
+static AVX2 void DcrAvx2(Lanes8080 *l, int reg)
+{
+  __m256i v = _mm256_loadu_si256((const __m256i *)l->r[reg]);
+  const __m256i nib = _mm256_set1_epi8(0x0f);
+  __m256i res = _mm256_sub_epi8(v, _mm256_set1_epi8(1));
+  __m256i ac = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(res, nib), nib), _mm256_set1_epi8(1));
+  _mm256_storeu_si256((__m256i *)l->r[reg], res);
+  _mm256_storeu_si256((__m256i *)l->ac, ac);
+  Zsp256(l, res);
+}
+
+static AVX2 void JccAvx2(Lanes8080 *l, const uint8_t *flag, int want, uint16_t target, uint16_t next)
+{
+  __m256i t = _mm256_set1_epi16((short)target);
+  __m256i n = _mm256_set1_epi16((short)next);
+  __m256i w = _mm256_set1_epi16((short)want);
+  int half;
+  for(half = 0; half < 2; half++)
+  {
+    __m256i f = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)&flag[16 * half]));
+    __m256i taken = _mm256_cmpeq_epi16(f, w);
+    _mm256_storeu_si256((__m256i *)&l->pc[16 * half], _mm256_blendv_epi8(n, t, taken));
+  }
+}
+
+static const Kernels avx2_kernels = {
+  SamePcAvx2, AluAvx2, DcrAvx2, JccAvx2,
+};
+
+#endif
+
+int SetLanesImpl8080(int impl)
+{
+  kernels = &scalar_kernels;
+#if SOA_HAVE_AVX2
+  if(impl != SOA_SCALAR && __builtin_cpu_supports("avx2"))
+  {
+    kernels = &avx2_kernels;
+    return SOA_AVX2;
+  }
+#endif
+  (void)impl;
+  return SOA_SCALAR;
+}
+
+static void LoadLane(Lanes8080 *l, int i)
+{
+  const State8080 *m = l->machine[i];
+  l->r[0][i] = m->b;
+  l->r[1][i] = m->c;
+  l->r[2][i] = m->d;
+  l->r[3][i] = m->e;
+  l->r[4][i] = m->h;
+  l->r[5][i] = m->l;
+  l->r[7][i] = m->a;
+  l->z[i] = m->cc.z;
+  l->s[i] = m->cc.s;
+  l->p[i] = m->cc.p;
+  l->cy[i] = m->cc.cy;
+  l->ac[i] = m->cc.ac;
+  l->int_enable[i] = m->int_enable;
+  l->halted[i] = m->halted;
+  l->pc[i] = m->pc;
+  l->sp[i] = m->sp;
+  l->counter[i] = m->counter;
+  l->cycles[i] = m->cycles;
+}
+
+static void StoreLane(Lanes8080 *l, int i)
+{
+  State8080 *m = l->machine[i];
+  m->b = l->r[0][i];
+  m->c = l->r[1][i];
+  m->d = l->r[2][i];
+  m->e = l->r[3][i];
+  m->h = l->r[4][i];
+  m->l = l->r[5][i];
+  m->a = l->r[7][i];
+  m->cc.z = l->z[i];
+  m->cc.s = l->s[i];
+  m->cc.p = l->p[i];
+  m->cc.cy = l->cy[i];
+  m->cc.ac = l->ac[i];
+  m->int_enable = l->int_enable[i];
+  m->halted = l->halted[i];
+  m->pc = l->pc[i];
+  m->sp = l->sp[i];
+  m->counter = l->counter[i];
+  m->cycles = l->cycles[i];
+}
+
+int LoadLanes8080(Lanes8080 *lanes, State8080 **machines, int count)
+{
+  int i;
+  if(count > SOA_LANES)
+    count = SOA_LANES;
+  memset(lanes, 0, sizeof(*lanes));
+  lanes->count = count;
+  lanes->shared_top = 0x2000;
+  for(i = 0; i < count; i++)
+  {
+    lanes->machine[i] = machines[i];
+    lanes->status[i] = EMU_OK;
+    LoadLane(lanes, i);
+    // The shared path has none of the instrumentation hooks.
+    if(machines[i]->profile || machines[i]->calls || machines[i]->debug ||
+        machines[i]->cover || machines[i]->trace || machines[i]->cpm)
+      lanes->shared_top = 0;
+  }
+  return count;
+}
+
+void StoreLanes8080(Lanes8080 *lanes)
+{
+  int i;
+  for(i = 0; i < lanes->count; i++)
+    StoreLane(lanes, i);
+}
+
+static inline uint8_t LaneRead(const Lanes8080 *l, int i, uint16_t addr)
+{
+  return l->machine[i]->rpage[addr >> 8][addr & 0xff];
+}
+
+static inline void LaneWrite(Lanes8080 *l, int i, uint16_t addr, uint8_t value)
+{
+  State8080 *m = l->machine[i];
+  uint8_t *page = m->wpage[addr >> 8];
+  if(page)
+    page[addr & 0xff] = value;
+  else
+    WriteSlow8080(m, addr, value);
+}
+
+// Register pair p (BC, DE, HL) of lane i.
+static inline uint16_t Pair(const Lanes8080 *l, int p, int i)
+{
+  return l->r[2 * p][i] << 8 | l->r[2 * p + 1][i];
+}
+
+static inline void SetPair(Lanes8080 *l, int p, int i, uint16_t value)
+{
+  l->r[2 * p][i] = value >> 8;
+  l->r[2 * p + 1][i] = value & 0xff;
+}
+
+static inline void Zsp(Lanes8080 *l, int i, uint8_t res)
+{
+  l->z[i] = (res == 0);
+  l->s[i] = (res >> 7);
+  l->p[i] = Parity8(res);
+}
+
+// Flag row and wanted value for condition field cc (bits 3-5).
+static const uint8_t *Condition(const Lanes8080 *l, int cc, int *want)
+{
+  const uint8_t *flags[4] = { l->z, l->cy, l->p, l->s };
+  *want = cc & 1;
+  return flags[cc >> 1];
+}
+
+// Hands lane i to the scalar core until `end`, or with `until_shared`
+// until it reaches an instruction the lanes can share.
+static void RunLane(Lanes8080 *l, int i, uint64_t end, int until_shared)
+{
+  State8080 *m = l->machine[i];
+  uint64_t counter;
+  int status;
+
+  StoreLane(l, i);
+  counter = m->counter;
+  if(until_shared)
+  {
+    do
+      status = Emulate8080p(m);
+    while(status == EMU_OK && m->cycles < end &&
+        (m->pc + 3 > l->shared_top || Classify(m->rpage[m->pc >> 8][m->pc & 0xff]) == V_NONE));
+    // As Run8080 does, a halted CPU sits out the rest of the run.
+    if(status == EMU_HALT)
+    {
+      if(m->cycles < end)
+        m->cycles = end;
+      status = EMU_OK;
+    }
+  }
+  else
+    status = Run8080(m, (int)(end - m->cycles));
+  if(status == EMU_OK && m->fault)
+    status = m->fault;
+  l->status[i] = status;
+  l->lane_steps += m->counter - counter;
+  LoadLane(l, i);
+}
+
+// Executes the instruction at the common pc for every lane.  Returns 0
+// if the lanes have to run it one at a time instead.
+static int StepShared(Lanes8080 *l, const uint8_t *code)
+{
+  const Kernels *k = kernels;
+  uint8_t op = code[0];
+  uint16_t pc = l->pc[0];
+  uint16_t imm = code[2] << 8 | code[1];
+  int n = l->count;
+  int len = 1;
+  int i, want;
+  const uint8_t *flag;
+
+  switch(Classify(op))
+  {
+    case V_NOP:
+      break;
+    case V_MOV:
+      memmove(l->r[(op >> 3) & 7], l->r[op & 7], SOA_LANES);
+      break;
+    case V_MVI:
+      if(op == 0x36)
+      {
+        for(i = 0; i < n; i++)
+          LaneWrite(l, i, Pair(l, 2, i), code[1]);
+      }
+      else
+        memset(l->r[(op >> 3) & 7], code[1], SOA_LANES);
+      len = 2;
+      break;
+    case V_LXI:
+      if(op == 0x31)
+      {
+        for(i = 0; i < SOA_LANES; i++)
+          l->sp[i] = imm;
+      }
+      else
+      {
+        int hi = (op >> 3) & 6;
+        memset(l->r[hi + 1], code[1], SOA_LANES);
+        memset(l->r[hi], code[2], SOA_LANES);
+      }
+      len = 3;
+      break;
+    case V_INX:
+    case V_DCX:
+      {
+        int p = (op >> 4) & 3, d = (op & 8) ? -1 : 1;
+        for(i = 0; i < SOA_LANES; i++)
+        {
+          if(p == 3)
+            l->sp[i] += d;
+          else
+            SetPair(l, p, i, Pair(l, p, i) + d);
+        }
+        break;
+      }
+    case V_INR:
+    case V_DCR:
+      {
+        int reg = (op >> 3) & 7, d = (op & 1) ? -1 : 1;
+        if(reg != ROW_M && d < 0)
+        {
+          k->dcr(l, reg);
+          break;
+        }
+        for(i = 0; i < n; i++)
+        {
+          uint16_t hl = Pair(l, 2, i);
+          uint8_t res = (reg == ROW_M ? LaneRead(l, i, hl) : l->r[reg][i]) + d;
+          if(reg == ROW_M)
+            LaneWrite(l, i, hl, res);
+          else
+            l->r[reg][i] = res;
+          l->ac[i] = (d > 0) ? (res & 0x0f) == 0 : (res & 0x0f) != 0x0f;
+          Zsp(l, i, res);
+        }
+        break;
+      }
+    case V_ALU:
+      k->alu(l, (op >> 3) & 7, op & 7);
+      break;
+    case V_ALUM:
+      for(i = 0; i < n; i++)
+        l->r[ROW_M][i] = LaneRead(l, i, Pair(l, 2, i));
+      k->alu(l, (op >> 3) & 7, ROW_M);
+      break;
+    case V_ALUI:
+      memset(l->r[ROW_M], code[1], SOA_LANES);
+      k->alu(l, (op >> 3) & 7, ROW_M);
+      len = 2;
+      break;
+    case V_LOAD:
+      {
+        int dst = (op < 0x40) ? 7 : (op >> 3) & 7;
+        for(i = 0; i < n; i++)
+        {
+          uint16_t addr = (op == 0x3a) ? imm : (op < 0x40) ? Pair(l, op >> 4, i) : Pair(l, 2, i);
+          l->r[dst][i] = LaneRead(l, i, addr);
+        }
+        len = (op == 0x3a) ? 3 : 1;
+        break;
+      }
+    case V_STORE:
+      {
+        int src = (op < 0x40) ? 7 : op & 7;
+        for(i = 0; i < n; i++)
+        {
+          uint16_t addr = (op == 0x32) ? imm : (op < 0x40) ? Pair(l, op >> 4, i) : Pair(l, 2, i);
+          LaneWrite(l, i, addr, l->r[src][i]);
+        }
+        len = (op == 0x32) ? 3 : 1;
+        break;
+      }
+    case V_PUSH:
+      {
+        int p = (op >> 4) & 3;
+        for(i = 0; i < n; i++)
+        {
+          uint8_t hi = (p == 3) ? l->r[7][i] : l->r[2 * p][i];
+          uint8_t lo = (p == 3) ? (l->s[i] << 7 | l->z[i] << 6 | l->ac[i] << 4 |
+              l->p[i] << 2 | 0x02 | l->cy[i]) : l->r[2 * p + 1][i];
+          LaneWrite(l, i, l->sp[i] - 1, hi);
+          LaneWrite(l, i, l->sp[i] - 2, lo);
+          l->sp[i] -= 2;
+        }
+        break;
+      }
+    case V_POP:
+      {
+        int p = (op >> 4) & 3;
+        for(i = 0; i < n; i++)
+        {
+          uint8_t lo = LaneRead(l, i, l->sp[i]);
+          uint8_t hi = LaneRead(l, i, l->sp[i] + 1);
+          if(p == 3)
+          {
+            l->r[7][i] = hi;
+            l->s[i] = (lo >> 7) & 1;
+            l->z[i] = (lo >> 6) & 1;
+            l->ac[i] = (lo >> 4) & 1;
+            l->p[i] = (lo >> 2) & 1;
+            l->cy[i] = lo & 1;
+          }
+          else
+          {
+            l->r[2 * p][i] = hi;
+            l->r[2 * p + 1][i] = lo;
+          }
+          l->sp[i] += 2;
+        }
+        break;
+      }
+    case V_CALL:
+      flag = (op == 0xcd) ? NULL : Condition(l, (op >> 3) & 7, &want);
+      for(i = 0; i < n; i++)
+      {
+        uint16_t ret = pc + 3;
+        if(flag && flag[i] != want)
+        {
+          l->pc[i] = ret;
+          continue;
+        }
+        LaneWrite(l, i, l->sp[i] - 1, ret >> 8);
+        LaneWrite(l, i, l->sp[i] - 2, ret & 0xff);
+        l->sp[i] -= 2;
+        l->pc[i] = imm;
+        if(flag)
+          l->cycles[i] += 6;
+      }
+      len = 0;
+      break;
+    case V_RET:
+      flag = (op == 0xc9) ? NULL : Condition(l, (op >> 3) & 7, &want);
+      for(i = 0; i < n; i++)
+      {
+        if(flag && flag[i] != want)
+        {
+          l->pc[i] = pc + 1;
+          continue;
+        }
+        l->pc[i] = LaneRead(l, i, l->sp[i] + 1) << 8 | LaneRead(l, i, l->sp[i]);
+        l->sp[i] += 2;
+        if(flag)
+          l->cycles[i] += 6;
+      }
+      len = 0;
+      break;
+    case V_JMP:
+      for(i = 0; i < SOA_LANES; i++)
+        l->pc[i] = imm;
+      len = 0;
+      break;
+    case V_JCC:
+      flag = Condition(l, (op >> 3) & 7, &want);
+      k->jcc(l, flag, want, imm, pc + 3);
+      len = 0;
+      break;
+    case V_DAD:
+      {
+        int p = (op >> 4) & 3;
+        for(i = 0; i < SOA_LANES; i++)
+        {
+          uint32_t res = (uint32_t)Pair(l, 2, i) + (p == 3 ? l->sp[i] : Pair(l, p, i));
+          SetPair(l, 2, i, res);
+          l->cy[i] = (res > 0xffff);
+        }
+        break;
+      }
+    case V_XCHG:
+      {
+        uint8_t t[SOA_LANES];
+        memcpy(t, l->r[2], SOA_LANES);
+        memcpy(l->r[2], l->r[4], SOA_LANES);
+        memcpy(l->r[4], t, SOA_LANES);
+        memcpy(t, l->r[3], SOA_LANES);
+        memcpy(l->r[3], l->r[5], SOA_LANES);
+        memcpy(l->r[5], t, SOA_LANES);
+        break;
+      }
+    case V_ROT:
+      for(i = 0; i < SOA_LANES; i++)
+      {
+        uint8_t a = l->r[7][i];
+        switch(op)
+        {
+          case 0x07: l->r[7][i] = a << 1 | a >> 7; l->cy[i] = a >> 7; break;
+          case 0x0f: l->r[7][i] = a << 7 | a >> 1; l->cy[i] = a & 1; break;
+          case 0x17: l->r[7][i] = a << 1 | l->cy[i]; l->cy[i] = a >> 7; break;
+          default:   l->r[7][i] = l->cy[i] << 7 | a >> 1; l->cy[i] = a & 1; break;
+        }
+      }
+      break;
+    case V_MISC:
+      for(i = 0; i < SOA_LANES; i++)
+        switch(op)
+        {
+          case 0x2f: l->r[7][i] = ~l->r[7][i]; break;
+          case 0x37: l->cy[i] = 1; break;
+          case 0x3f: l->cy[i] ^= 1; break;
+          case 0xf3: l->int_enable[i] = 0; break;
+          default:   l->int_enable[i] = 1; break;
+        }
+      break;
+    default:
+      return 0;
+  }
+
+  if(len)
+  {
+    for(i = 0; i < SOA_LANES; i++)
+      l->pc[i] = pc + len;
+  }
+  for(i = 0; i < n; i++)
+  {
+    l->counter[i]++;
+    l->cycles[i] += cycles8080[op];
+  }
+  l->shared_steps++;
+  return 1;
+}
+
+int RunLanes8080(Lanes8080 *lanes, int cycles)
+{
+  uint64_t end[SOA_LANES];
+  uint32_t all = (lanes->count >= 32) ? 0xffffffffu : ((1u << lanes->count) - 1);
+  int i;
+
+  if(kernels == NULL)
+    SetLanesImpl8080(SOA_AUTO);
+
+  for(i = 0; i < lanes->count; i++)
+    end[i] = lanes->cycles[i] + cycles;
+
+  for(;;)
+  {
+    uint32_t run = 0, halted = 0;
+    for(i = 0; i < lanes->count; i++)
+    {
+      if(lanes->status[i] == EMU_OK && lanes->cycles[i] < end[i])
+        run |= 1u << i;
+      if(lanes->halted[i])
+        halted |= 1u << i;
+    }
+    if(run == 0)
+      break;
+
+    // A halted lane sits at the pc after its HLT, where the others may
+    // well be too; it is left to RunLane, which lets it wait out the run.
+    uint16_t pc = lanes->pc[0];
+    if(run == all && halted == 0 && pc + 3 <= lanes->shared_top && kernels->same_pc(lanes))
+    {
+      uint8_t code[3];
+      ReadBlock8080(lanes->machine[0], pc, code, sizeof(code));
+      if(StepShared(lanes, code))
+        continue;
+      // Together, on an instruction they can't share: each lane runs
+      // it alone, and on to the next one they can, where they meet
+      // again unless their data sent them different ways.
+      for(i = 0; i < lanes->count; i++)
+        RunLane(lanes, i, end[i], 1);
+      continue;
+    }
+
+    // Apart: each lane runs a batch on its own.  They are compared
+    // again after it, so lanes that come back together share again.
+    for(i = 0; i < lanes->count; i++)
+      if(run & (1u << i))
+      {
+        uint64_t stop = lanes->halted[i] ? end[i] : lanes->cycles[i] + SOA_BATCH;
+        RunLane(lanes, i, stop < end[i] ? stop : end[i], 0);
+      }
+  }
+  return EMU_OK;
+}
@@ -0,0 +1,64 @@
+#ifndef EMULATE_SOA_H
+#define EMULATE_SOA_H
+
+#include "8080.h"
+
+// Lockstep interpreter for a group of machines running the same ROM.
+// Registers are stored structure-of-arrays, one lane per machine, so
+// while every lane sits on the same pc a single decode drives all of
+// them and the ALU work is done with one vector operation.  An
+// instruction the shared path doesn't handle is run by each lane on its
+// own up to the next one it does.  Lanes that disagree on pc run alone
+// through Run8080 in batches, and share again once they meet.  Machines
+// with a profile, call graph, debugger, coverage, trace or CP/M attached
+// never share.
+#define SOA_LANES 32
+
+enum {
+  SOA_AUTO = 0,   // AVX2 when the CPU has it, scalar otherwise
+  SOA_SCALAR,     // plain C reference kernels
+  SOA_AVX2,
+};
+
+typedef struct Lanes8080 {
+  // r[reg][lane], indexed like the opcode's register field:
+  // B C D E H L (M) A.  Row 6 holds the operand of ALU M and the
+  // immediate forms.
+  uint8_t r[8][SOA_LANES];
+  uint8_t z[SOA_LANES];
+  uint8_t s[SOA_LANES];
+  uint8_t p[SOA_LANES];
+  uint8_t cy[SOA_LANES];
+  uint8_t ac[SOA_LANES];
+  uint8_t int_enable[SOA_LANES];
+  uint8_t halted[SOA_LANES];
+  uint16_t pc[SOA_LANES];
+  uint16_t sp[SOA_LANES];
+  uint64_t counter[SOA_LANES];
+  uint64_t cycles[SOA_LANES];
+  int status[SOA_LANES];
+
+  State8080 *machine[SOA_LANES];  // memory and write-back target per lane
+  int count;
+  // Code below this address is identical in every lane (the shared
+  // ROM), so its bytes can be read once from lane 0.
+  uint16_t shared_top;
+
+  uint64_t shared_steps;   // instructions executed for all lanes at once
+  uint64_t lane_steps;     // instructions executed for a single lane
+} __attribute__((aligned(32))) Lanes8080;
+
+// Copies up to SOA_LANES machines into the lanes.  Returns the number of
+// lanes loaded.  shared_top defaults to 0x2000, the Invaders ROM.
+int LoadLanes8080(Lanes8080 *lanes, State8080 **machines, int count);
+// Writes the lane registers back into their machines.
+void StoreLanes8080(Lanes8080 *lanes);
+
+// Runs every lane for at least `cycles` cycles or until it stops.  A
+// lane's stop reason is left in lanes->status.
+int RunLanes8080(Lanes8080 *lanes, int cycles);
+
+// Picks the kernel set.  Returns the one actually in use.
+int SetLanesImpl8080(int impl);
+
+#endif
@@ -0,0 +1,2149 @@
+// The instruction core.  8080.c includes this file once per variant:
+// STEP_NAME is the function to define, STEP_PROFILE (0 or 1) says
+// whether it updates state->profile and state->calls, STEP_DEBUG
+// whether it checks state->debug, and STEP_COVER whether it sets bits
+// in state->cover.  STEP_TRACE writes each instruction to state->trace
+// and STEP_CPM honours state->cpm; both default to 0.  The plain
+// variant has no trace of any of them in it.  With STEP_DECODED defined
+// as 1 the function takes the three instruction bytes from the caller
+// rather than fetching them.  No include guard, on purpose.
+
+#ifndef STEP_DECODED
+#define STEP_DECODED  0
+#endif
+#ifndef STEP_TRACE
+#define STEP_TRACE  0
+#endif
+#ifndef STEP_CPM
+#define STEP_CPM  0
+#endif
+
+#if STEP_DECODED
+static inline int STEP_NAME(State8080 *state, const uint8_t *opcode)
+#else
+static inline int STEP_NAME(State8080 *state)
+#endif
+{
+#if STEP_PROFILE || STEP_DEBUG || STEP_COVER
+  uint16_t at = state->pc;
+#endif
+#if STEP_PROFILE
+  uint16_t sp = state->sp;
+  uint64_t cycles = state->cycles;
+#endif
+#if !STEP_DECODED
+  uint8_t opcode[3];
+#endif
+#if STEP_DEBUG
+  if(BreakAt8080(state->debug, at))
+    return EMU_BREAK;
+#endif
+#if !STEP_DECODED
+  opcode[0] = ReadMem(state, state->pc);
+  opcode[1] = ReadMem(state, state->pc + 1);
+  opcode[2] = ReadMem(state, state->pc + 2);
+#endif
+
+#if STEP_DEBUG
+  // Operand reads from here on go past the watchpoints; the fetch above
+  // doesn't.  Writes to a watched page reach WriteSlow8080 by
+  // themselves.
+#define ReadMem(state, addr)          ReadWatched(state, addr)
+#endif
+
+#if STEP_TRACE
+  if(state->trace)
+    Disassemble8080f(state->trace, opcode, state->pc);
+#endif
+
+  state->pc+=1;
+
+  switch(*opcode)
+  {
+    case 0x00:  // NOP
+    case 0x08: case 0x10: case 0x18: case 0x20:     // undocumented NOPs
+    case 0x28: case 0x30: case 0x38:
+      break;
+    case 0x01: // LXI B
+      {
+        state->bc = (opcode[2] << 8) | opcode[1];
+        state->pc += 2;
+        break;
+      }
+    case 0x02:  // STAX B
+      {
+        WriteMem(state, state->bc, state->a);
+        break;
+      }
+    case 0x03:  // INX B
+      {
+        state->bc++;
+        break;
+      }
+    case 0x04:  // INR B
+      {
+        // AC: a carry out of the low nibble, or for DCR no borrow into
+        // it.
+        state->b += 1;
+        state->cc.ac = (state->b & 0x0f) == 0;
+        state->cc.z = (state->b == 0);
+        state->cc.s = ((state->b & 0x80) != 0);
+        state->cc.p = Parity(state->b, 8);
+        break;
+      }
+    case 0x05:  // DCR B
+      {
+        state->b -= 1;
+        state->cc.ac = (state->b & 0x0f) != 0x0f;
+        state->cc.z = (state->b == 0);
+        state->cc.s = ((state->b & 0x80) != 0);
+        state->cc.p = Parity(state->b, 8);
+        break;
+      }
+    case 0x06:  // MVI B
+      {
+        state->b = opcode[1];
+        state->pc += 1;
+        break;
+      }
+    case 0x07:  // RLC
+      {
+        uint8_t t = state->a;
+        state->a = (t << 1) | (t >> 7);
+        state->cc.cy = (t >> 7);
+        break;
+      }
+    case 0x09:  // DAD B
+      {
+        uint32_t res = (uint32_t)state->hl + state->bc;
+        state->hl = res;
+        state->cc.cy = (res > 0xffff);
+        break;
+      }
+    case 0x0a:  // LDAX B
+      {
+        state->a = ReadMem(state, state->bc);
+        break;
+      }
+    case 0x0b:  // DCX B
+      {
+        state->bc--;
+        break;
+      }
+    case 0x0c:  // INR C
+      {
+        state->c += 1;
+        state->cc.ac = (state->c & 0x0f) == 0;
+        state->cc.z = (state->c == 0);
+        state->cc.s = ((state->c & 0x80) != 0);
+        state->cc.p = Parity(state->c, 8);
+        break;
+      }
+    case 0x0d:  // DCR C
+      {
+        state->c -= 1;
+        state->cc.ac = (state->c & 0x0f) != 0x0f;
+        state->cc.z = (state->c == 0);
+        state->cc.s = ((state->c & 0x80) != 0);
+        state->cc.p = Parity(state->c, 8);
+        break;
+      }
+    case 0x0e:  // MVI C
+      {
+        state->c = opcode[1];
+        state->pc += 1;
+        break;
+      }
+    case 0x0f:  // RRC
+      {
+        uint8_t t = state->a;
+        state->a = ((t & 1) << 7) | (t >> 1);
+        state->cc.cy = ((t & 0x1) == 1);
+        break;
+      }
+    case 0x11:  // LXI D
+      {
+        state->de = (opcode[2] << 8) | opcode[1];
+        state->pc += 2;
+        break;
+      }
+    case 0x12:  // STAX D
+      {
+        WriteMem(state, state->de, state->a);
+        break;
+      }
+    case 0x13:  // INX  D
+      {
+        state->de++;
+        break;
+      }
+    case 0x14:  // INR D
+      {
+        state->d += 1;
+        state->cc.ac = (state->d & 0x0f) == 0;
+        state->cc.z = (state->d == 0);
+        state->cc.s = ((state->d & 0x80) != 0);
+        state->cc.p = Parity(state->d, 8);
+        break;
+      }
+    case 0x15:  // DCR D
+      {
+        state->d -= 1;
+        state->cc.ac = (state->d & 0x0f) != 0x0f;
+        state->cc.z = (state->d == 0);
+        state->cc.s = ((state->d & 0x80) != 0);
+        state->cc.p = Parity(state->d, 8);
+        break;
+      }
+    case 0x16:  // MVI D
+    {
+      state->d = opcode[1];
+      state->pc += 1;
+      break; 
+    }
+    case 0x17:  // RAL
+      {
+        uint8_t t = state->a;
+        state->a = (t << 1) | state->cc.cy;
+        state->cc.cy = (t >> 7);
+        break;
+      }
+    case 0x19:  // DAD D
+      {
+        uint32_t res = (uint32_t)state->hl + state->de;
+        state->hl = res;
+        state->cc.cy = (res > 0xffff);
+        break;
+      }
+    case 0x1a:  // LDAX D
+      {
+        state->a = ReadMem(state, state->de);
+        break;
+      }
+    case 0x1b:  // DCX D
+      {
+        state->de--;
+        break;
+      }
+    case 0x1c:  // INR E
+      {
+        state->e += 1;
+        state->cc.ac = (state->e & 0x0f) == 0;
+        state->cc.z = (state->e == 0);
+        state->cc.s = ((state->e & 0x80) != 0);
+        state->cc.p = Parity(state->e, 8);
+        break;
+      }
+    case 0x1d:  // DCR E
+      {
+        state->e -= 1;
+        state->cc.ac = (state->e & 0x0f) != 0x0f;
+        state->cc.z = (state->e == 0);
+        state->cc.s = ((state->e & 0x80) != 0);
+        state->cc.p = Parity(state->e, 8);
+        break;
+      }
+    case 0x1e:  // MVI E
+    {
+      state->e = opcode[1];
+      state->pc += 1;
+      break;
+    }
+    case 0x1f:  // RAR
+      {
+        uint8_t t = state->a;
+        state->a = (state->cc.cy << 7) | (t >> 1);
+        state->cc.cy = (t & 1);
+        break;
+      }
+    case 0x21:  // LXI H
+      {
+        state->hl = (opcode[2] << 8) | opcode[1];
+        state->pc += 2;
+        break;
+      }
+    case 0x22:  // SHLD
+      {
+        uint16_t addr = (opcode[2] << 8) | opcode[1];
+        WriteMem(state, addr, state->l);
+        WriteMem(state, addr + 1, state->h);
+        state->pc += 2;
+        break;
+      }
+    case 0x23:  // INX H
+      {
+        state->hl++;
+        break;
+      }
+    case 0x24:  // INR H
+      {
+        state->h += 1;
+        state->cc.ac = (state->h & 0x0f) == 0;
+        state->cc.z = (state->h == 0);
+        state->cc.s = ((state->h & 0x80) != 0);
+        state->cc.p = Parity(state->h, 8);
+        break;
+      }
+    case 0x25:  // DCR H
+      {
+        state->h -= 1;
+        state->cc.ac = (state->h & 0x0f) != 0x0f;
+        state->cc.z = (state->h == 0);
+        state->cc.s = ((state->h & 0x80) != 0);
+        state->cc.p = Parity(state->h, 8);
+        break;
+      }
+    case 0x26:  // MVI H
+      {
+        state->h = opcode[1];
+        state->pc += 1;
+        break;
+      }
+    case 0x27:  // DAA
+      {
+        uint16_t t = state->a;
+        if((t & 0x0f) > 9 || state->cc.ac)
+        {
+          state->cc.ac = ((t & 0x0f) + 6 > 0x0f);
+          t += 6;
+        }
+        if((t & 0x1f0) > 0x90 || state->cc.cy)
+        {
+          t += 0x60;
+          state->cc.cy = 1;
+        }
+        state->a = (uint8_t)t;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x29:  // DAD H
+      {
+        uint32_t res = (uint32_t)state->hl << 1;
+        state->hl = res;
+        state->cc.cy = (res > 0xffff);
+        break;
+      }
+    case 0x2a:  // LHLD
+      {
+        uint16_t addr = (opcode[2] << 8) | opcode[1];
+        state->l = ReadMem(state, addr);
+        state->h = ReadMem(state, addr + 1);
+        state->pc += 2;
+        break;
+      }
+    case 0x2b:  // DCX H
+      {
+        state->hl--;
+        break;
+      }
+    case 0x2c:  // INR L
+      {
+        state->l += 1;
+        state->cc.ac = (state->l & 0x0f) == 0;
+        state->cc.z = (state->l == 0);
+        state->cc.s = ((state->l & 0x80) != 0);
+        state->cc.p = Parity(state->l, 8);
+        break;
+      }
+    case 0x2d:  // DCR L
+      {
+        state->l -= 1;
+        state->cc.ac = (state->l & 0x0f) != 0x0f;
+        state->cc.z = (state->l == 0);
+        state->cc.s = ((state->l & 0x80) != 0);
+        state->cc.p = Parity(state->l, 8);
+        break;
+      }
+    case 0x2e:  // MVI L
+    {
+      state->l = opcode[1];
+      state->pc += 1;
+      break;
+    }
+    case 0x2f:  // CMA
+      {
+        state->a = ~state->a;
+        break;
+      }
+    case 0x31:  // LXI SP
+      {
+        state->sp = (opcode[2] << 8 | opcode[1]);
+        state->pc += 2;
+        break;
+      }
+    case 0x33:  // INX SP
+      {
+        state->sp++;
+        break;
+      }
+    case 0x34:  // INR M
+      {
+        uint8_t t = ReadMem(state, state->hl) + 1;
+        WriteMem(state, state->hl, t);
+        state->cc.ac = (t & 0x0f) == 0;
+        state->cc.z = (t == 0);
+        state->cc.s = ((t & 0x80) != 0);
+        state->cc.p = Parity(t, 8);
+        break;
+      }
+    case 0x35:  // DCR M
+      {
+        uint8_t t = ReadMem(state, state->hl) - 1;
+        WriteMem(state, state->hl, t);
+        state->cc.ac = (t & 0x0f) != 0x0f;
+        state->cc.z = (t == 0);
+        state->cc.s = ((t & 0x80) != 0);
+        state->cc.p = Parity(t, 8);
+        break;
+      }
+    case 0x36:  // MVI M
+      {
+        WriteMem(state, state->hl, opcode[1]);
+        state->pc += 1;
+        break;
+      }
+    case 0x32:  // STA
+      {
+        uint16_t offset = ((opcode[2] << 8) | opcode[1]);
+        WriteMem(state, offset, state->a);
+        state->pc += 2;
+        break;
+      }
+    case 0x37:  // STC
+      {
+        state->cc.cy = 1;
+        break;
+      }
+    case 0x39:  // DAD SP
+      {
+        uint32_t res = (uint32_t)state->hl + state->sp;
+        state->hl = res;
+        state->cc.cy = (res > 0xffff);
+        break;
+      }
+    case 0x3a:  // LDA
+      {
+        uint16_t offset = ((opcode[2] << 8) | opcode[1]);
+        state->a = ReadMem(state, offset);
+        state->pc += 2;
+        break;
+      }
+    case 0x3b:  // DCX SP
+      {
+        state->sp--;
+        break;
+      }
+    case 0x3c:  // INR A
+      {
+        state->a += 1;
+        state->cc.ac = (state->a & 0x0f) == 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x3d:  // DCR A
+      {
+        state->a -= 1;
+        state->cc.ac = (state->a & 0x0f) != 0x0f;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x3e:  // MVI A
+      {
+        state->a = opcode[1];
+        state->pc += 1;
+        break;
+      }
+    case 0x3f:  // CMC
+      {
+        state->cc.cy = !state->cc.cy;
+        break;
+      }
+    case 0x40:  // MOV B,B
+    {
+      state->b = state->b;
+      break;
+    }
+    case 0x41:  // MOV B,C
+    {
+      state->b = state->c;
+      break;
+    }
+    case 0x42:  // MOV B,D
+      {
+        state->b = state->d;
+        break;
+      }
+    case 0x43:  // MOV B,E
+      {
+        state->b = state->e;
+        break;
+      }
+    case 0x44:  // MOV B,H
+      {
+        state->b = state->h;
+        break;
+      }
+    case 0x45:  // MOV B,L
+      {
+        state->b = state->l;
+        break;
+      }
+    case 0x46:  // MOV B,M
+    {
+      state->b = ReadMem(state, state->hl);
+      break;
+    }
+    case 0x47:  // MOV B,A
+      {
+        state->b = state->a;
+        break;
+      }
+    case 0x48:  // MOV C,B
+      {
+        state->c = state->b;
+        break;
+      }
+    case 0x49:  // MOV C,C
+    {
+      state->c = state->c;
+      break;
+    }
+    case 0x4a:  // MOV C,D
+    {
+      state->c = state->d;
+      break;
+    }
+    case 0x4b:  // MOV C,E
+      {
+        state->c = state->e;
+        break;
+      }
+    case 0x4c:  // MOV C,H
+    {
+      state->c = state->h;
+      break;
+    }
+    case 0x4d:  // MOV C,L
+      {
+        state->c = state->l;
+        break;
+      }
+    case 0x4e:  // MOV C,M
+      {
+        state->c = ReadMem(state, state->hl);
+        break;
+      }
+    case 0x4f:  // MOV C,A
+      {
+        state->c = state->a;
+        break;
+      }
+    case 0x50:  // MOV D,B
+      {
+        state->d = state->b;
+        break;
+      }
+    case 0x51:  // MOV D,C
+      {
+        state->d = state->c;
+        break;
+      }
+    case 0x52:  // MOV D,D
+    {
+      state->d = state->d;
+      break;
+    }
+    case 0x53:  // MOV D,E
+    {
+      state->d = state->e;
+      break;
+    }
+    case 0x54:  // MOV D,H
+    {
+      state->d = state->h;
+      break;
+    }
+    case 0x55:  // MOV D,L
+      {
+        state->d = state->l;
+        break;
+      }
+    case 0x56:  // MOV D,M
+      {
+        state->d = ReadMem(state, state->hl);
+        break;
+      }
+    case 0x57:  // MOV D,A
+      {
+        state->d = state->a;
+        break;
+      }
+    case 0x58:  // MOV E,B
+      {
+        state->e = state->b;
+        break;
+      }
+    case 0x59:  // MOV E,C
+      {
+        state->e = state->c;
+        break;
+      }
+    case 0x5a:  // MOV E,D
+      {
+        state->e = state->d;
+        break;
+      }
+    case 0x5b:  // MOV E,E
+    {
+      state->e = state->e;
+      break;
+    }
+    case 0x5c:  // MOV E,H
+    {
+      state->e = state->h;
+      break;
+    }
+    case 0x5d:  // MOV E,L
+    {
+      state->e = state->l;
+      break;
+    }
+    case 0x5e:  // MOV E,M
+      {
+        state->e = ReadMem(state, state->hl);
+        break;
+      }
+    case 0x5f:  // MOV E,A
+      {
+        state->e = state->a;
+        break;
+      }
+    case 0x60:  // MOV H,B
+      {
+        state->h = state->b;
+        break;
+      }
+    case 0x61:  // MOV H,C
+      {
+        state->h = state->c;
+        break;
+      }
+    case 0x62:  // MOV H,D
+      {
+        state->h = state->d;
+        break;
+      }
+    case 0x63:  // MOV H,E
+      {
+        state->h = state->e;
+        break;
+      }
+    case 0x64:  // MOV H,H
+    {
+      state->h = state->h;
+      break;
+    }
+    case 0x65:  // MOV H,L
+    {
+      state->h = state->l;
+      break;
+    }
+    case 0x66:  // MOV H,M
+      {
+        state->h = ReadMem(state, state->hl);
+        break;
+      }
+    case 0x67:  // MOV H,A
+      {
+        state->h = state->a;
+        break;
+      }
+    case 0x68:  // MOV L,B
+      {
+        state->l = state->b;
+        break;
+      }
+    case 0x69:  // MOV L,C
+      {
+        state->l = state->c;
+        break;
+      }
+    case 0x6a:  // MOV L,D
+      {
+        state->l = state->d;
+        break;
+      }
+    case 0x6b:  // MOV L,E
+      {
+        state->l = state->e;
+        break;
+      }
+    case 0x6c:  // MOV L,H
+      {
+        state->l = state->h;
+        break;
+      }
+    case 0x6d:  // MOV L,L
+    {
+      state->l = state->l;
+      break;
+    }
+    case 0x6e:  // MOV L,M
+    {
+      state->l = ReadMem(state, state->hl);
+      break;
+    }
+    case 0x6f:  // MOV L,A
+      {
+        state->l = state->a;
+        break;
+      }
+    case 0x70:  // MOV M,B
+    {
+      WriteMem(state, state->hl, state->b);
+      break;
+    }
+    case 0x71:  // MOV M,C
+      {
+        WriteMem(state, state->hl, state->c);
+        break;
+      }
+    case 0x72:  // MOV M,D
+    {
+      WriteMem(state, state->hl, state->d);
+      break;
+    }
+    case 0x73:  // MOV M,E
+    {
+      WriteMem(state, state->hl, state->e);
+      break;
+    }
+    case 0x74:  // MOV M,H
+    {
+      WriteMem(state, state->hl, state->h);
+      break;
+    }
+    case 0x75:  // MOV M,L
+    {
+      WriteMem(state, state->hl, state->l);
+      break;
+    }
+    case 0x76:  // HLT
+      {
+        // The run loop skips to the next interrupt.
+        state->halted = 1;
+        break;
+      }
+    case 0x77:  // MOV M,A
+      {
+        WriteMem(state, state->hl, state->a);
+        break;
+      }
+    case 0x78:  // MOV A,B
+    {
+      state->a = state->b;
+      break;
+    }
+    case 0x79:  // MOV A,C
+      {
+        state->a = state->c;
+        break;
+      }
+    case 0x7a:  // MOV A,D
+      {
+        state->a = state->d;
+        break;
+      }
+    case 0x7b:  // MOV A,E
+      {
+        state->a = state->e;
+        break;
+      }
+    case 0x7c:  // MOV A,H
+      {
+        state->a = state->h;
+        break;
+      }
+    case 0x7d:  // MOV A,L
+      {
+        state->a = state->l;
+        break;
+      }
+    case 0x7e:  // MOV A,M
+      {
+        state->a = ReadMem(state, state->hl);
+        break;
+      }
+    case 0x7f:  // MOV A,A
+    {
+      state->a = state->a;
+      break;
+    }
+    case 0x80:  // ADD B
+      {
+        uint8_t x = state->b;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x81:  // ADD C
+      {
+        uint8_t x = state->c;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x82:  // ADD D
+      {
+        uint8_t x = state->d;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x83:  // ADD E
+      {
+        uint8_t x = state->e;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x84:  // ADD H
+      {
+        uint8_t x = state->h;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x85:  // ADD L
+      {
+        uint8_t x = state->l;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x86:  // ADD M
+      {
+        uint8_t x = ReadMem(state, state->hl);
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x87:  // ADD A
+      {
+        uint8_t x = state->a;
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x88:  // ADC B
+      {
+        uint8_t x = state->b;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x89:  // ADC C
+      {
+        uint8_t x = state->c;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x8a:  // ADC D
+      {
+        uint8_t x = state->d;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x8b:  // ADC E
+      {
+        uint8_t x = state->e;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x8c:  // ADC H
+      {
+        uint8_t x = state->h;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x8d:  // ADC L
+      {
+        uint8_t x = state->l;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x8e:  // ADC M
+      {
+        uint8_t x = ReadMem(state, state->hl);
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x8f:  // ADC A
+      {
+        uint8_t x = state->a;
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x90:  // SUB B
+      {
+        // Subtraction adds the complement, so AC is the carry out of
+        // bit 3 of that sum: set when there is no borrow from bit 4.
+        uint8_t x = state->b;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x91:  // SUB C
+      {
+        uint8_t x = state->c;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x92:  // SUB D
+      {
+        uint8_t x = state->d;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x93:  // SUB E
+      {
+        uint8_t x = state->e;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x94:  // SUB H
+      {
+        uint8_t x = state->h;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x95:  // SUB L
+      {
+        uint8_t x = state->l;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x96:  // SUB M
+      {
+        uint8_t x = ReadMem(state, state->hl);
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x97:  // SUB A
+      {
+        uint8_t x = state->a;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x98:  // SBB B
+      {
+        uint8_t x = state->b;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x99:  // SBB C
+      {
+        uint8_t x = state->c;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x9a:  // SBB D
+      {
+        uint8_t x = state->d;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x9b:  // SBB E
+      {
+        uint8_t x = state->e;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x9c:  // SBB H
+      {
+        uint8_t x = state->h;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x9d:  // SBB L
+      {
+        uint8_t x = state->l;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x9e:  // SBB M
+      {
+        uint8_t x = ReadMem(state, state->hl);
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0x9f:  // SBB A
+      {
+        uint8_t x = state->a;
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa0:  // ANA B
+      {
+        // The 8080 sets AC from bit 3 of the operands ORed together.
+        uint8_t x = state->b;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa1:  // ANA C
+      {
+        uint8_t x = state->c;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa2:  // ANA D
+      {
+        uint8_t x = state->d;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa3:  // ANA E
+      {
+        uint8_t x = state->e;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa4:  // ANA H
+      {
+        uint8_t x = state->h;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa5:  // ANA L
+      {
+        uint8_t x = state->l;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa6:  // ANA M
+      {
+        uint8_t x = ReadMem(state, state->hl);
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa7:  // ANA A
+      {
+        uint8_t x = state->a;
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa8:  // XRA B
+      {
+        state->a ^= state->b;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xa9:  // XRA C
+      {
+        state->a ^= state->c;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xaa:  // XRA D
+      {
+        state->a ^= state->d;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xab:  // XRA E
+      {
+        state->a ^= state->e;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xac:  // XRA H
+      {
+        state->a ^= state->h;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xad:  // XRA L
+      {
+        state->a ^= state->l;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xae:  // XRA M
+      {
+        state->a ^= ReadMem(state, state->hl);
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xaf:  // XRA A
+      {
+        state->a ^= state->a;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb0:  // ORA B
+      {
+        state->a |= state->b;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb1:  // ORA C
+      {
+        state->a |= state->c;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb2:  // ORA D
+      {
+        state->a |= state->d;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb3:  // ORA E
+      {
+        state->a |= state->e;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb4:  // ORA H
+      {
+        state->a |= state->h;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb5:  // ORA L
+      {
+        state->a |= state->l;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb6:  // ORA M
+      {
+        state->a |= ReadMem(state, state->hl);
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb7:  // ORA A
+      {
+        state->a |= state->a;
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        break;
+      }
+    case 0xb8:  // CMP B
+      {
+        uint8_t x = state->b;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xb9:  // CMP C
+      {
+        uint8_t x = state->c;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xba:  // CMP D
+      {
+        uint8_t x = state->d;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xbb:  // CMP E
+      {
+        uint8_t x = state->e;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xbc:  // CMP H
+      {
+        uint8_t x = state->h;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xbd:  // CMP L
+      {
+        uint8_t x = state->l;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xbe:  // CMP M
+      {
+        uint8_t x = ReadMem(state, state->hl);
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xbf:  // CMP A
+      {
+        uint8_t x = state->a;
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        break;
+      }
+    case 0xc0:  // RNZ
+      {
+        if(!state->cc.z) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;    // taken: 11 cycles, not 5
+        }
+        break;
+      }
+    case 0xc1:  // POP B
+      {
+        state->bc = (ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp);
+        state->sp += 2;
+        break;
+      }
+    case 0xc2:  // JNZ
+      {
+        if(state->cc.z == 0)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xc3:  // JMP
+    case 0xcb:  // undocumented JMP
+#if STEP_CPM
+      // JMP WBOOT: cpudiag's exit to CP/M after reporting a failure.
+      if(state->cpm && ((opcode[2] << 8) | opcode[1]) == 0)
+        return EMU_EXIT;
+#endif
+      {
+        state->pc = ((opcode[2] << 8) | opcode[1]);
+        break;
+      }
+    case 0xc4:  // CNZ
+      {
+        if(!state->cc.z) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;    // taken: 17 cycles, not 11
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xc5:  // PUSH B
+      {
+        WriteMem(state, state->sp-1, state->b);
+        WriteMem(state, state->sp-2, state->c);
+        state->sp -= 2;
+        break;
+      }
+    case 0xc6:  // ADI
+      {
+        uint8_t x = opcode[1];
+        uint16_t result = (uint16_t)state->a + x;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f)) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xc7:  // RST 0
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xc8:  // RZ
+      {
+        if(state->cc.z) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xc9:  // RET
+    case 0xd9:  // undocumented RET
+      {
+        state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+        state->sp += 2;
+        break;
+      }
+    case 0xca:  // JZ
+      {
+        if(state->cc.z)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xcc:  // CZ
+      {
+        if(state->cc.z) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xcd:  // CALL
+    case 0xdd: case 0xed: case 0xfd:    // undocumented CALLs
+#if STEP_CPM
+      if(state->cpm && ((opcode[2] << 8) | opcode[1]) == 5)
+      {
+        // BDOS: 2 writes the character in E, 9 the string at DE up to
+        // a '$'.  The rest are ignored.
+        FILE *f = state->console;
+        if(f && state->c == 2)
+          fputc(state->e, f);
+        else if(f && state->c == 9)
+        {
+          uint16_t str = state->de;
+          int n;
+          for(n = 0; n < 0x10000 && ReadMem(state, str) != '$'; n++)
+            fputc(ReadMem(state, str++), f);
+        }
+        state->pc += 2;
+        break;
+      }
+      else if(state->cpm && ((opcode[2] << 8) | opcode[1]) == 0)
+      {
+        return EMU_EXIT;
+      }
+      else
+#endif
+      {
+        uint16_t ret = state->pc+2;
+        WriteMem(state, state->sp-1, (ret >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (ret & 0xff));
+        state->sp = state->sp-2;
+        state->pc = ((opcode[2] << 8) | opcode[1]);
+        break;
+      }
+    case 0xce:  // ACI
+      {
+        uint8_t x = opcode[1];
+        uint16_t result = (uint16_t)state->a + x + state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) + (x & 0x0f) + state->cc.cy) > 0x0f;
+        state->cc.cy = (result > 0xff);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xcf:  // RST 1
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xd0:  // RNC
+      {
+        if(!state->cc.cy) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xd1:  // POP D
+      {
+        state->de = (ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp);
+        state->sp += 2;
+        break;
+      }
+    case 0xd2:  // JNC
+      {
+        if(!state->cc.cy)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xd3:  // OUT
+      {
+        MachineOut(state, opcode[1], state->a);
+        state->pc += 1;
+        break;
+      }
+    case 0xd4:  // CNC
+      {
+        if(!state->cc.cy) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xd5:  // PUSH D
+      {
+        WriteMem(state, state->sp-1, state->d);
+        WriteMem(state, state->sp-2, state->e);
+        state->sp -= 2;
+        break;
+      }
+    case 0xd6:  // SUI
+      {
+        uint8_t x = opcode[1];
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xd7:  // RST 2
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xd8:  // RC
+      {
+        if(state->cc.cy) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xda:  // JC
+      {
+        if(state->cc.cy)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xdb:  // IN
+      {
+        state->a = MachineIn(state, opcode[1]);
+        state->pc += 1;
+        break;
+      }
+    case 0xdc:  // CC
+      {
+        if(state->cc.cy) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xde:  // SBI
+      {
+        uint8_t x = opcode[1];
+        uint16_t result = (uint16_t)state->a - x - state->cc.cy;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f) - state->cc.cy) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->a = (uint8_t)result;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xdf:  // RST 3
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xe0:  // RPO
+      {
+        if(!state->cc.p) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xe1:  // POP H
+      {
+        state->hl = (ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp);
+        state->sp += 2;
+        break;
+      }
+    case 0xe2:  // JPO
+      {
+        if(!state->cc.p)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xe3:  // XTHL
+      {
+        uint16_t t = (ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp);
+        WriteMem(state, state->sp, state->l);
+        WriteMem(state, state->sp+1, state->h);
+        state->hl = t;
+        break;
+      }
+    case 0xe4:  // CPO
+      {
+        if(!state->cc.p) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xe5:  // PUSH H
+      {
+        WriteMem(state, state->sp-1, state->h);
+        WriteMem(state, state->sp-2, state->l);
+        state->sp -= 2;
+        break;
+      }
+    case 0xe6:  // ANI
+      {
+        uint8_t x = opcode[1];
+        state->cc.ac = ((state->a | x) & 0x08) != 0;
+        state->a &= x;
+        state->cc.cy = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xe7:  // RST 4
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xe8:  // RPE
+      {
+        if(state->cc.p) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xe9:  // PCHL
+      {
+        state->pc = state->hl;
+        break;
+      }
+    case 0xea:  // JPE
+      {
+        if(state->cc.p)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xeb:  // XCHG
+      {
+        uint16_t t = state->hl;
+        state->hl = state->de;
+        state->de = t;
+        break;
+      }
+    case 0xec:  // CPE
+      {
+        if(state->cc.p) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xee:  // XRI
+      {
+        state->a ^= opcode[1];
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xef:  // RST 5
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xf0:  // RP
+      {
+        if(!state->cc.s) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xf1:  // POP PSW
+      {
+        state->a = ReadMem(state, state->sp+1);
+        uint8_t psw = ReadMem(state, state->sp);
+        state->cc.s = ((psw & 0x80) != 0);
+        state->cc.z = ((psw & 0x40) != 0);
+        state->cc.ac = ((psw & 0x10) != 0);
+        state->cc.p = ((psw & 0x04) != 0);
+        state->cc.cy = ((psw & 0x01) != 0);
+        state->sp += 2;
+        break;
+      }
+    case 0xf2:  // JP
+      {
+        if(!state->cc.s)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xf3:  // DI
+      {
+        state->int_enable = 0;
+        break;
+      }
+    case 0xf4:  // CP
+      {
+        if(!state->cc.s) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xf5:  // PUSH PSW
+      {
+        WriteMem(state, state->sp-1, state->a);
+        uint8_t psw = (state->cc.s << 7 | state->cc.z << 6 | state->cc.ac << 4 | state->cc.p << 2 | 0x02 | state->cc.cy);
+        WriteMem(state, state->sp-2, psw);
+        state->sp -= 2;
+        break;
+      }
+    case 0xf6:  // ORI
+      {
+        state->a |= opcode[1];
+        state->cc.cy = 0;
+        state->cc.ac = 0;
+        state->cc.z = (state->a == 0);
+        state->cc.s = ((state->a & 0x80) != 0);
+        state->cc.p = Parity(state->a, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xf7:  // RST 6
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    case 0xf8:  // RM
+      {
+        if(state->cc.s) {
+          state->pc = ((ReadMem(state, state->sp+1) << 8) | ReadMem(state, state->sp));
+          state->sp += 2;
+          state->cycles += 6;
+        }
+        break;
+      }
+    case 0xf9:  // SPHL
+      {
+        state->sp = state->hl;
+        break;
+      }
+    case 0xfa:  // JM
+      {
+        if(state->cc.s)
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xfb:  //EI
+      {
+        state->int_enable = 1;
+        break;
+      }
+    case 0xfc:  // CM
+      {
+        if(state->cc.s) {
+          uint16_t ret = state->pc +2;
+          WriteMem(state, state->sp -1, (ret >> 8) & 0xff);
+          WriteMem(state, state->sp -2, (ret & 0xff));
+          state->sp = state->sp -2;
+          state->pc = ((opcode[2] << 8) | opcode[1]);
+          state->cycles += 6;
+        }
+        else
+          state->pc += 2;
+        break;
+      }
+    case 0xfe:  // CPI
+      {
+        uint8_t x = opcode[1];
+        uint16_t result = (uint16_t)state->a - x;
+        state->cc.ac = ((state->a & 0x0f) - (x & 0x0f)) >= 0;
+        state->cc.cy = ((result & 0x100) != 0);
+        state->cc.z = ((uint8_t)result == 0);
+        state->cc.s = (((uint8_t)result & 0x80) != 0);
+        state->cc.p = Parity((uint8_t)result, 8);
+        state->pc += 1;
+        break;
+      }
+    case 0xff:  // RST 7
+      {
+        WriteMem(state, state->sp-1, (state->pc >> 8) & 0xff);
+        WriteMem(state, state->sp-2, (state->pc & 0xff));
+        state->sp = state->sp-2;
+        state->pc = *opcode & 0x38;
+        break;
+      }
+    default:
+      {
+        return UnimplementedInstruction(state);
+      }
+  }
+#if STEP_TRACE
+  if(state->trace)
+  {
+    FILE *f = state->trace;
+    fprintf(f, "\t");
+    fprintf(f, "%c", state->cc.z ? 'z' : '.');
+    fprintf(f, "%c", state->cc.s ? 's' : '.');
+    fprintf(f, "%c", state->cc.p ? 'p' : '.');
+    fprintf(f, "%c", state->cc.cy ? 'c' : '.');
+    fprintf(f, "%c  ", state->cc.ac ? 'a' : '.');
+    fprintf(f, "A $%02x B $%02x C $%02x D $%02x E $%02x H $%02x L $%02x SP %04x\n", state->a, state->b, state->c,
+        state->d, state->e, state->h, state->l, state->sp);
+  }
+#endif
+  state->cycles += cycles8080[*opcode];
+  state->counter++;
+#if STEP_PROFILE
+  if(state->profile)
+  {
+    Profile8080 *prof = state->profile;
+    prof->op[*opcode]++;
+    prof->pc[at]++;
+    prof->cycles[at] += state->cycles - cycles;
+  }
+  if(state->calls)
+  {
+    // CALL, Ccc and RST push; RET and Rcc pop.  A conditional one that
+    // wasn't taken leaves sp alone.
+    uint8_t op = *opcode;
+    if(state->sp == (uint16_t)(sp - 2) &&
+        ((op & 0xcf) == 0xcd || (op & 0xc7) == 0xc4 || (op & 0xc7) == 0xc7))
+      EnterCall8080(state->calls, state->pc, state->sp, state->cycles);
+    else if(state->sp == (uint16_t)(sp + 2) && ((op & 0xef) == 0xc9 || (op & 0xc7) == 0xc0))
+      LeaveCall8080(state->calls, state->sp, state->cycles);
+  }
+#endif
+#if STEP_COVER
+  if(state->cover)
+  {
+    Cover8080 *cover = state->cover;
+    CoverPc8080(cover, at);
+    // Only a transfer of control enters a new block.
+    if(cover->edges && state->pc != (uint16_t)(at + opcodes8080[*opcode].size))
+      CoverEdge8080(cover, state->pc);
+  }
+#endif
+#if STEP_DEBUG
+  if(state->debug->stop.reason != STOP_NONE)
+  {
+    state->debug->stop.pc = at;
+    return EMU_BREAK;
+  }
+#endif
+  return (*opcode == 0x76) ? EMU_HALT : EMU_OK;
+}
+
+#if STEP_DEBUG
+#undef ReadMem
+#endif
+#undef STEP_NAME
+#undef STEP_PROFILE
+#undef STEP_DEBUG
+#undef STEP_COVER
+#undef STEP_DECODED
+#undef STEP_TRACE
+#undef STEP_CPM
@@ -0,0 +1,180 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tcache.h"
+
+// The body is nblocks TierBlock8080s, each with `first` counting from
+// the start of the instruction array, then ninsns TierInsn8080s.  Both
+// are stored as the host lays them out; the build ID covers that.
+typedef struct TCacheHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;
+  uint16_t block_size;
+  uint16_t insn_size;
+  uint32_t nblocks;
+  uint32_t ninsns;
+  uint32_t pad;
+  uint64_t rom_hash;
+  uint64_t checksum;        // of the body
+  char build[32];
+} TCacheHeader;
+
+static uint64_t Fnv(uint64_t h, const void *p, size_t n)
+{
+  const uint8_t *b = p;
+  size_t i;
+  for(i = 0; i < n; i++)
+    h = (h ^ b[i]) * 0x100000001b3ull;
+  return h;
+}
+
+#define FNV_BASIS  0xcbf29ce484222325ull
+
+uint64_t RomHash8080(const State8080 *state)
+{
+  uint64_t h = FNV_BASIS;
+  int page;
+  for(page = 0; page < RAM_BASE / PAGE_SIZE; page++)
+    h = Fnv(h, state->rpage[page], PAGE_SIZE);
+  return h;
+}
+
+static void BuildId(char out[32])
+{
+  memset(out, 0, 32);
+  strncpy(out, TCACHE_BUILD_ID, 31);
+}
+
+static int RomBlock(const Tier8080 *tier, int i)
+{
+  const TierBlock8080 *b = &tier->block[i];
+  int j;
+  if(b->tier == TIER_DEAD || tier->entry[b->start] != i + 1)
+    return 0;
+  for(j = 0; j < b->npages; j++)
+    if(b->page[j] >= RAM_BASE / PAGE_SIZE)
+      return 0;
+  return 1;
+}
+
+int SaveTierCache8080(const State8080 *state, const char *path)
+{
+  const Tier8080 *tier = state->tier;
+  TCacheHeader h = { .magic = TCACHE_MAGIC, .version = TCACHE_VERSION,
+      .header_size = sizeof(TCacheHeader), .block_size = sizeof(TierBlock8080),
+      .insn_size = sizeof(TierInsn8080) };
+  TierBlock8080 *blocks;
+  TierInsn8080 *insns;
+  char tmp[4096];
+  FILE *f;
+  int i, status = EMU_OK;
+
+  if(tier == NULL)
+    return EMU_ERR_IO;
+  blocks = malloc((tier->nblocks + 1) * sizeof(TierBlock8080));
+  insns = malloc((tier->ninsns + 1) * sizeof(TierInsn8080));
+  if(blocks == NULL || insns == NULL)
+  {
+    free(blocks);
+    free(insns);
+    return EMU_ERR_NOMEM;
+  }
+  for(i = 0; i < tier->nblocks; i++)
+  {
+    if(!RomBlock(tier, i))
+      continue;
+    TierBlock8080 *b = &blocks[h.nblocks++];
+    *b = tier->block[i];
+    memcpy(&insns[h.ninsns], &tier->insn[b->first], b->ninsns * sizeof(TierInsn8080));
+    b->first = h.ninsns;
+    b->runs = 0;
+    b->covered = 0;
+    b->link[0] = b->link[1] = -1;
+    b->link_pc[0] = b->link_pc[1] = 0;
+    h.ninsns += b->ninsns;
+  }
+  h.rom_hash = RomHash8080(state);
+  h.checksum = Fnv(Fnv(FNV_BASIS, blocks, h.nblocks * sizeof(TierBlock8080)),
+      insns, h.ninsns * sizeof(TierInsn8080));
+  BuildId(h.build);
+
+  snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+  if((f = fopen(tmp, "wb")) == NULL)
+    status = EMU_ERR_IO;
+  else
+  {
+    if(fwrite(&h, sizeof(h), 1, f) != 1 ||
+        fwrite(blocks, sizeof(TierBlock8080), h.nblocks, f) != h.nblocks ||
+        fwrite(insns, sizeof(TierInsn8080), h.ninsns, f) != h.ninsns)
+      status = EMU_ERR_IO;
+    if(fclose(f) != 0)
+      status = EMU_ERR_IO;
+    if(status == EMU_OK && rename(tmp, path) != 0)
+      status = EMU_ERR_IO;
+    if(status != EMU_OK)
+      unlink(tmp);
+  }
+  free(blocks);
+  free(insns);
+  return status;
+}
+
+int LoadTierCache8080(State8080 *state, const char *path, int *loaded)
+{
+  const TCacheHeader *h;
+  const TierBlock8080 *blocks;
+  const TierInsn8080 *insns;
+  struct stat st;
+  char build[32];
+  void *map;
+  size_t body;
+  uint32_t i;
+  int fd, n = 0, status = EMU_OK;
+
+  if(loaded)
+    *loaded = 0;
+  if(state->tier == NULL || (fd = open(path, O_RDONLY)) < 0)
+    return EMU_ERR_IO;
+  if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(TCacheHeader))
+  {
+    close(fd);
+    return EMU_ERR_FORMAT;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return EMU_ERR_IO;
+
+  h = map;
+  BuildId(build);
+  body = (size_t)h->nblocks * sizeof(TierBlock8080) + (size_t)h->ninsns * sizeof(TierInsn8080);
+  blocks = (const TierBlock8080 *)(h + 1);
+  insns = (const TierInsn8080 *)(blocks + h->nblocks);
+  if(h->magic != TCACHE_MAGIC || h->version != TCACHE_VERSION ||
+      h->header_size != sizeof(TCacheHeader) || h->block_size != sizeof(TierBlock8080) ||
+      h->insn_size != sizeof(TierInsn8080) || memcmp(h->build, build, sizeof(build)) != 0 ||
+      (size_t)st.st_size != sizeof(TCacheHeader) + body ||
+      h->rom_hash != RomHash8080(state) ||
+      h->checksum != Fnv(Fnv(FNV_BASIS, blocks, h->nblocks * sizeof(TierBlock8080)),
+          insns, h->ninsns * sizeof(TierInsn8080)))
+    status = EMU_ERR_FORMAT;
+
+  // The checksum vouches for the bytes, not for what they claim; check
+  // every block before installing any.
+  for(i = 0; status == EMU_OK && i < h->nblocks; i++)
+    if((uint64_t)blocks[i].first + blocks[i].ninsns > h->ninsns)
+      status = EMU_ERR_FORMAT;
+  for(i = 0; status == EMU_OK && i < h->nblocks; i++)
+    if(InstallBlock8080(state, &blocks[i], &insns[blocks[i].first]) >= 0)
+      n++;
+  munmap(map, st.st_size);
+  if(loaded)
+    *loaded = n;
+  return status;
+}
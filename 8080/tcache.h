@@ -0,0 +1,43 @@
+#ifndef EMULATE_TCACHE_H
+#define EMULATE_TCACHE_H
+
+#include <stdint.h>
+
+#include "8080.h"
+#include "tier.h"
+
+// Tier caches (tier.h) saved to disk, so a new machine running a ROM
+// that others have run starts with its hot blocks already built instead
+// of warming them up again.
+//
+// The file is keyed by a hash of the ROM (everything below RAM_BASE) and
+// the build ID, and the body carries a checksum.  A file written by
+// another build, for another ROM, truncated or damaged is rejected as a
+// whole with EMU_ERR_FORMAT; the caller runs without it and writes a
+// fresh one later.  Only blocks read entirely from ROM are saved, since
+// RAM can hold anything by the time the next machine looks.
+#define TCACHE_MAGIC    0x43543830u   // "08TC" read little-endian
+#define TCACHE_VERSION  1
+
+// Identifies the build that wrote a cache.  Anything that changes how
+// blocks are built or what the core does with them must change it;
+// building with -DTCACHE_BUILD_ID=\"...\" from the version control
+// revision does.  The default changes with every compile of tcache.c.
+#ifndef TCACHE_BUILD_ID
+#define TCACHE_BUILD_ID  __DATE__ " " __TIME__
+#endif
+
+// Hash of mem[0..RAM_BASE) as the machine sees it.
+uint64_t RomHash8080(const State8080 *state);
+
+// Writes the live ROM blocks of state->tier to path, through a
+// temporary file renamed into place so readers never see half a cache.
+// Returns EMU_OK or EMU_ERR_IO.
+int SaveTierCache8080(const State8080 *state, const char *path);
+
+// Maps path and installs its blocks into state->tier.  Returns EMU_OK,
+// EMU_ERR_IO if there's no such file, or EMU_ERR_FORMAT if it is stale
+// or corrupt; *loaded, if not NULL, gets the number of blocks installed.
+int LoadTierCache8080(State8080 *state, const char *path, int *loaded);
+
+#endif
@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "tier.h"
+
+// The instruction pool never grows past this; when it would, the whole
+// cache is emptied and refilled from what is hot now.
+#define TIER_MAX_POOL  (1 << 20)
+
+Tier8080 *InitTier8080(const TierConfig8080 *config)
+{
+  Tier8080 *tier = calloc(1, sizeof(Tier8080));
+  if(tier == NULL)
+    return NULL;
+  if(config)
+    tier->config = *config;
+  else
+    tier->config = (TierConfig8080){ TIER_WARM, TIER_HOT, TIER_DEMOTE, TIER_MAX_INSNS };
+  if(tier->config.warm == 0)
+    tier->config.warm = 1;
+  if(tier->config.max_insns == 0)
+    tier->config.max_insns = TIER_MAX_INSNS;
+  if(tier->config.demote == 0)
+    tier->config.demote = TIER_DEMOTE;
+  return tier;
+}
+
+void FreeTier8080(Tier8080 *tier)
+{
+  if(tier == NULL)
+    return;
+  free(tier->block);
+  free(tier->insn);
+  free(tier);
+}
+
+static void Guard(State8080 *state, int page)
+{
+  Tier8080 *tier = state->tier;
+  if(TierGuarded8080(tier, page))
+    return;
+  tier->guarded[page >> 3] |= 1 << (page & 7);
+  tier->saved[page] = state->wpage[page];
+  state->wpage[page] = NULL;
+}
+
+static void Unguard(State8080 *state, int page)
+{
+  Tier8080 *tier = state->tier;
+  tier->guarded[page >> 3] &= ~(1 << (page & 7));
+  if(tier->saved[page])
+    state->wpage[page] = tier->saved[page];
+  tier->saved[page] = NULL;
+}
+
+void DetachTier8080(State8080 *state)
+{
+  int i;
+  if(state->tier == NULL)
+    return;
+  for(i = 0; i < PAGES; i++)
+    if(TierGuarded8080(state->tier, i))
+      Unguard(state, i);
+  state->tier = NULL;
+}
+
+void ForgetWritePages8080(Tier8080 *tier)
+{
+  memset(tier->saved, 0, sizeof(tier->saved));
+}
+
+// Empties the cache.  Heat goes too, so only what is still hot comes
+// back.
+static void Flush(State8080 *state)
+{
+  Tier8080 *tier = state->tier;
+  int i;
+  for(i = 0; i < PAGES; i++)
+    if(TierGuarded8080(tier, i))
+      Unguard(state, i);
+  memset(tier->entry, 0, sizeof(tier->entry));
+  memset(tier->heat, 0, sizeof(tier->heat));
+  tier->nblocks = 0;
+  tier->ninsns = 0;
+  tier->dirty = 1;
+  tier->stats.flushes++;
+}
+
+// Room for one more block of up to max_insns instructions.
+static int Reserve(State8080 *state)
+{
+  Tier8080 *tier = state->tier;
+  uint32_t need = tier->ninsns + tier->config.max_insns;
+  if(need > TIER_MAX_POOL)
+  {
+    Flush(state);
+    need = tier->config.max_insns;
+  }
+  if(need > tier->insn_cap)
+  {
+    uint32_t cap = tier->insn_cap ? 2 * tier->insn_cap : 4096;
+    while(cap < need)
+      cap *= 2;
+    TierInsn8080 *insn = realloc(tier->insn, cap * sizeof(TierInsn8080));
+    if(insn == NULL)
+      return EMU_ERR_NOMEM;
+    tier->insn = insn;
+    tier->insn_cap = cap;
+  }
+  if(tier->nblocks == tier->block_cap)
+  {
+    int cap = tier->block_cap ? 2 * tier->block_cap : 256;
+    TierBlock8080 *block = realloc(tier->block, cap * sizeof(TierBlock8080));
+    if(block == NULL)
+      return EMU_ERR_NOMEM;
+    tier->block = block;
+    tier->block_cap = cap;
+  }
+  return EMU_OK;
+}
+
+// Adds page to the block's list.  Returns 0 if the list is full.
+static int Touch(TierBlock8080 *b, int page)
+{
+  int i;
+  for(i = 0; i < b->npages; i++)
+    if(b->page[i] == page)
+      return 1;
+  if(b->npages == TIER_BLOCK_PAGES)
+    return 0;
+  b->page[b->npages++] = page;
+  return 1;
+}
+
+// Makes the block just built at the end of the pool live: guards its
+// pages and points its entry at it, retiring whatever was there.
+static int Commit(State8080 *state)
+{
+  Tier8080 *tier = state->tier;
+  TierBlock8080 *b = &tier->block[tier->nblocks];
+  int i, old;
+  for(i = 0; i < b->npages; i++)
+    Guard(state, b->page[i]);
+  tier->ninsns += b->ninsns;
+  if((old = tier->entry[b->start] - 1) >= 0)
+    tier->block[old].tier = TIER_DEAD;
+  tier->entry[b->start] = tier->nblocks + 1;
+  return tier->nblocks++;
+}
+
+int TranslateBlock8080(State8080 *state, uint16_t pc, int kind)
+{
+  Tier8080 *tier = state->tier;
+  TierBlock8080 *b;
+  uint16_t addr = pc;
+
+  if(TierCold8080(tier, pc >> 8) || Reserve(state) != EMU_OK)
+    return -1;
+  b = &tier->block[tier->nblocks];
+  *b = (TierBlock8080){ .start = pc, .tier = kind, .first = tier->ninsns,
+      .link = { -1, -1 } };
+
+  while(b->ninsns < tier->config.max_insns)
+  {
+    TierInsn8080 *in = &tier->insn[b->first + b->ninsns];
+    const Opcode8080 *op;
+    uint16_t target;
+    int stop = 0;
+
+    if(TierCold8080(tier, addr >> 8) || TierCold8080(tier, (uint16_t)(addr + 2) >> 8))
+      break;
+    ReadBlock8080(state, addr, in->code, 3);
+    op = &opcodes8080[in->code[0]];
+    // A block is dropped when any page it was read from is written.
+    if(!Touch(b, addr >> 8) || !Touch(b, (uint16_t)(addr + op->size - 1) >> 8))
+      break;
+    in->pad = 0;
+    in->next = addr + op->size;
+    target = in->code[1] | in->code[2] << 8;
+
+    // A decoded block ends at the first transfer of control.  A
+    // superblock goes where unconditional transfers go and past
+    // conditional ones; the guest leaving the path is a side exit.
+    switch(op->flow)
+    {
+      case FLOW_NEXT:
+        break;
+      case FLOW_JUMP:
+      case FLOW_CALL:
+        stop = (kind == TIER_DECODED);
+        if(!stop)
+          in->next = target;
+        break;
+      case FLOW_RST:
+        stop = (kind == TIER_DECODED);
+        if(!stop)
+          in->next = in->code[0] & 0x38;
+        break;
+      case FLOW_BRANCH:
+      case FLOW_CCALL:
+      case FLOW_CRET:
+        stop = (kind == TIER_DECODED);
+        break;
+      default:    // RET, PCHL, HLT
+        stop = 1;
+        break;
+    }
+    b->last = addr;
+    b->ninsns++;
+    addr = in->next;
+    if(stop)
+      break;
+  }
+  if(b->ninsns == 0)
+    return -1;
+  if(kind == TIER_DECODED)
+    tier->stats.decoded++;
+  else
+    tier->stats.chained++;
+  return Commit(state);
+}
+
+int InstallBlock8080(State8080 *state, const TierBlock8080 *block, const TierInsn8080 *insn)
+{
+  Tier8080 *tier = state->tier;
+  TierBlock8080 *b;
+  int i;
+  if(block->ninsns == 0 || block->ninsns > tier->config.max_insns ||
+      block->npages == 0 || block->npages > TIER_BLOCK_PAGES ||
+      (block->tier != TIER_DECODED && block->tier != TIER_CHAINED))
+    return -1;
+  for(i = 0; i < block->npages; i++)
+    if(TierCold8080(tier, block->page[i]))
+      return -1;
+  if(Reserve(state) != EMU_OK)
+    return -1;
+  b = &tier->block[tier->nblocks];
+  *b = *block;
+  b->first = tier->ninsns;
+  b->runs = 0;
+  b->covered = 0;
+  b->link[0] = b->link[1] = -1;
+  memcpy(&tier->insn[b->first], insn, b->ninsns * sizeof(TierInsn8080));
+  tier->stats.loaded++;
+  return Commit(state);
+}
+
+void InvalidatePage8080(State8080 *state, int page)
+{
+  Tier8080 *tier = state->tier;
+  int i, j;
+  for(i = 0; i < tier->nblocks; i++)
+  {
+    TierBlock8080 *b = &tier->block[i];
+    b->link[0] = b->link[1] = -1;
+    if(b->tier == TIER_DEAD)
+      continue;
+    for(j = 0; j < b->npages; j++)
+      if(b->page[j] == page)
+        break;
+    if(j == b->npages)
+      continue;
+    b->tier = TIER_DEAD;
+    if(tier->entry[b->start] == i + 1)
+      tier->entry[b->start] = 0;
+    tier->stats.invalidated++;
+  }
+  memset(&tier->heat[page * PAGE_SIZE], 0, PAGE_SIZE * sizeof(tier->heat[0]));
+  Unguard(state, page);
+  tier->dirty = 1;
+  if(tier->invalidations[page] < 255 && ++tier->invalidations[page] >= tier->config.demote)
+  {
+    if(!TierCold8080(tier, page))
+      tier->stats.demoted++;
+    tier->cold[page >> 3] |= 1 << (page & 7);
+  }
+}
@@ -0,0 +1,142 @@
+#ifndef EMULATE_TIER_H
+#define EMULATE_TIER_H
+
+#include <stdint.h>
+
+#include "8080.h"
+
+// Tiered execution.  Point state->tier at one of these and Run8080 and
+// RunFrame8080 stop treating every instruction alike:
+//
+//   interpreted   the plain core, one fetch and decode per instruction.
+//                 Every entry to a basic block bumps a counter for its
+//                 address.
+//   decoded       after `warm` entries the block is decoded once into a
+//                 list of instructions with their operands, and runs
+//                 from that list with no fetching.
+//   chained       after `hot` runs it is rebuilt as a superblock that
+//                 follows unconditional jumps and calls and runs on past
+//                 untaken branches, leaving early if the guest goes
+//                 elsewhere, and it remembers the blocks it exits to so
+//                 the next one is found without a lookup.
+//
+// Code that runs once, like the start-up tests, never costs more than
+// interpreting it.  Every tier stops at the same cycle as the plain core
+// does, so results are identical whichever tier ran the code.
+//
+// Pages holding translated code lose their write pointer, so a store to
+// one takes the slow path and throws away the blocks on that page.  A
+// page invalidated `demote` times is left to the interpreter for good.
+// Coverage and CP/M mode run tiered too: a block marks each of its
+// instructions in the coverage the first time it reaches it, and edges
+// as the interpreter does.  The profiling and trace variants, which
+// account for every instruction, take precedence over tiering while
+// they are attached.  A debugger doesn't: only blocks with code on a
+// page that has a breakpoint are left alone (debug.h).
+typedef struct TierConfig8080 {
+  uint16_t warm;        // block entries before decoding
+  uint32_t hot;         // decoded runs before building a superblock
+  uint8_t demote;       // invalidations before a page stays interpreted
+  uint16_t max_insns;   // longest superblock
+} TierConfig8080;
+
+#define TIER_WARM       8
+#define TIER_HOT        256
+#define TIER_DEMOTE     4
+#define TIER_MAX_INSNS  128
+
+enum {
+  TIER_DEAD = 0,        // invalidated or replaced
+  TIER_DECODED,
+  TIER_CHAINED,
+};
+
+typedef struct TierInsn8080 {
+  uint8_t code[3];
+  uint8_t pad;
+  uint16_t next;        // pc it must leave behind to stay in the block
+} TierInsn8080;
+
+#define TIER_BLOCK_PAGES  4
+
+typedef struct TierBlock8080 {
+  uint16_t start;
+  uint16_t last;        // address of the last instruction
+  uint8_t tier;
+  uint8_t npages;
+  uint8_t page[TIER_BLOCK_PAGES];   // pages its code was read from
+  uint16_t ninsns;
+  uint32_t first;       // index of its first instruction in insn[]
+  uint32_t runs;
+  int link[2];          // blocks entered from here, or -1
+  uint16_t link_pc[2];
+  uint16_t covered;     // leading instructions already marked in the coverage
+} TierBlock8080;
+
+typedef struct TierStats8080 {
+  uint64_t decoded;     // blocks promoted to decoded
+  uint64_t chained;     // promoted to superblocks
+  uint64_t invalidated; // blocks thrown away after a write
+  uint64_t demoted;     // pages left to the interpreter
+  uint64_t flushes;     // times the whole cache filled and was emptied
+  uint64_t loaded;      // blocks installed from a saved cache (tcache.h)
+  uint64_t block_runs;  // blocks entered, either tier
+  uint64_t linked_runs; // of those, entered through a link
+} TierStats8080;
+
+typedef struct Tier8080 {
+  TierConfig8080 config;
+  TierStats8080 stats;
+  uint16_t heat[0x10000];         // interpreted entries per address
+  int entry[0x10000];             // block starting here, plus 1; 0 if none
+  uint8_t guarded[PAGES / 8];     // pages with blocks on them
+  uint8_t cold[PAGES / 8];        // demoted pages
+  uint8_t invalidations[PAGES];
+  uint8_t *saved[PAGES];          // write pointers taken off guarded pages
+  int dirty;                      // a block was invalidated mid-run
+  const struct Cover8080 *cover;  // bitmap the blocks' `covered` refer to
+  uint32_t cover_resets;          // its resets when they were counted
+  TierBlock8080 *block;
+  int nblocks;
+  int block_cap;
+  TierInsn8080 *insn;
+  uint32_t ninsns;
+  uint32_t insn_cap;
+} Tier8080;
+
+// config NULL uses the TIER_* defaults.  Returns NULL if allocation
+// fails.  A tier belongs to one machine: set state->tier to attach it,
+// and detach it with DetachTier8080, which gives back the write
+// pointers it took, before freeing it.
+Tier8080 *InitTier8080(const TierConfig8080 *config);
+void FreeTier8080(Tier8080 *tier);
+void DetachTier8080(State8080 *state);
+
+// Used by the core.
+static inline int TierGuarded8080(const Tier8080 *tier, int page)
+{
+  return tier->guarded[page >> 3] & (1 << (page & 7));
+}
+
+static inline int TierCold8080(const Tier8080 *tier, int page)
+{
+  return tier->cold[page >> 3] & (1 << (page & 7));
+}
+
+// Decodes the block at pc as a TIER_DECODED or TIER_CHAINED block.
+// Returns its index, or -1 if it can't be (a demoted page, or no
+// memory).
+int TranslateBlock8080(State8080 *state, uint16_t pc, int kind);
+// Adds a copy of a block built earlier, by this machine or another
+// with the same code, as TranslateBlock8080 would have built it.
+// Returns its index, or -1 if it doesn't fit this tier's limits, lies on
+// a demoted page, or there's no memory.
+int InstallBlock8080(State8080 *state, const TierBlock8080 *block, const TierInsn8080 *insn);
+// Throws away every block on `page` and gives the page its write
+// pointer back.
+void InvalidatePage8080(State8080 *state, int page);
+// Forgets the saved write pointers; Fork8080 calls it because the pages
+// behind them are now shared.
+void ForgetWritePages8080(Tier8080 *tier);
+
+#endif
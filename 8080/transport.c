@@ -0,0 +1,215 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "transport.h"
+
+static uint64_t Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Loopback.  One link holds a queue per direction; packets wait in it
+// until their delivery time.
+
+#define LOOPBACK_QUEUE  256
+
+typedef struct Packet {
+  uint64_t due;
+  uint16_t size;
+  uint8_t data[TRANSPORT_MTU];
+} Packet;
+
+typedef struct Link {
+  pthread_mutex_t lock;
+  Packet queue[2][LOOPBACK_QUEUE];  // queue[i]: packets for end i
+  int count[2];
+  uint64_t latency_ns;
+  uint64_t jitter_ns;
+  uint32_t drop;        // loss scaled to 2^32
+  uint32_t rng;
+  int open;
+} Link;
+
+typedef struct End {
+  Link *link;
+  int side;
+} End;
+
+static uint32_t Random(Link *link)
+{
+  // xorshift32
+  uint32_t x = link->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return link->rng = x;
+}
+
+static int LoopbackSend(Transport8080 *t, const void *buf, size_t n)
+{
+  End *end = t->impl;
+  Link *link = end->link;
+  int to = !end->side;
+
+  if(n > TRANSPORT_MTU)
+    return EMU_ERR_IO;
+  pthread_mutex_lock(&link->lock);
+  if(Random(link) >= link->drop && link->count[to] < LOOPBACK_QUEUE)
+  {
+    Packet *p = &link->queue[to][link->count[to]++];
+    p->due = Now() + link->latency_ns;
+    if(link->jitter_ns)
+      p->due += Random(link) % (2 * link->jitter_ns) - link->jitter_ns;
+    p->size = n;
+    memcpy(p->data, buf, n);
+  }
+  pthread_mutex_unlock(&link->lock);
+  return EMU_OK;
+}
+
+static int LoopbackRecv(Transport8080 *t, void *buf, size_t size)
+{
+  End *end = t->impl;
+  Link *link = end->link;
+  Packet *q = link->queue[end->side];
+  uint64_t now = Now();
+  int i, first = -1, n = 0;
+
+  pthread_mutex_lock(&link->lock);
+  for(i = 0; i < link->count[end->side]; i++)
+    if(q[i].due <= now && (first < 0 || q[i].due < q[first].due))
+      first = i;
+  if(first >= 0)
+  {
+    n = q[first].size < size ? q[first].size : size;
+    memcpy(buf, q[first].data, n);
+    q[first] = q[--link->count[end->side]];
+  }
+  pthread_mutex_unlock(&link->lock);
+  return n;
+}
+
+static void LoopbackClose(Transport8080 *t)
+{
+  End *end = t->impl;
+  Link *link = end->link;
+  int last;
+
+  pthread_mutex_lock(&link->lock);
+  last = (--link->open == 0);
+  pthread_mutex_unlock(&link->lock);
+  if(last)
+  {
+    pthread_mutex_destroy(&link->lock);
+    free(link);
+  }
+  free(end);
+  t->impl = NULL;
+}
+
+int LoopbackPair8080(Transport8080 *a, Transport8080 *b,
+    int latency_ms, int jitter_ms, double loss, uint32_t seed)
+{
+  Link *link = calloc(1, sizeof(Link));
+  End *ea = malloc(sizeof(End));
+  End *eb = malloc(sizeof(End));
+  if(link == NULL || ea == NULL || eb == NULL)
+  {
+    free(link);
+    free(ea);
+    free(eb);
+    return EMU_ERR_NOMEM;
+  }
+  pthread_mutex_init(&link->lock, NULL);
+  link->latency_ns = (uint64_t)(latency_ms > 0 ? latency_ms : 0) * 1000000;
+  link->jitter_ns = (uint64_t)(jitter_ms > 0 ? jitter_ms : 0) * 1000000;
+  if(link->jitter_ns > link->latency_ns)
+    link->jitter_ns = link->latency_ns;
+  link->drop = loss <= 0 ? 0 : loss >= 1 ? UINT32_MAX : (uint32_t)(loss * 4294967296.0);
+  link->rng = seed ? seed : 1;
+  link->open = 2;
+
+  ea->link = eb->link = link;
+  ea->side = 0;
+  eb->side = 1;
+  a->send = b->send = LoopbackSend;
+  a->recv = b->recv = LoopbackRecv;
+  a->close = b->close = LoopbackClose;
+  a->impl = ea;
+  b->impl = eb;
+  return EMU_OK;
+}
+
+// UDP.  The socket is connect()ed, so datagrams from anyone but the
+// peer are filtered out by the kernel.
+
+static int UdpSend(Transport8080 *t, const void *buf, size_t n)
+{
+  int fd = (int)(intptr_t)t->impl;
+  // A peer that isn't up yet shows up as ECONNREFUSED; that's loss.
+  if(send(fd, buf, n, 0) < 0 && errno != ECONNREFUSED && errno != EAGAIN)
+    return EMU_ERR_IO;
+  return EMU_OK;
+}
+
+static int UdpRecv(Transport8080 *t, void *buf, size_t size)
+{
+  int fd = (int)(intptr_t)t->impl;
+  ssize_t n = recv(fd, buf, size, MSG_TRUNC);
+  // Nothing waiting, or an ICMP error from a peer that isn't up yet.
+  if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED))
+    return 0;
+  if(n < 0)
+    return -1;
+  return (size_t)n < size ? (int)n : (int)size;
+}
+
+static void UdpClose(Transport8080 *t)
+{
+  close((int)(intptr_t)t->impl);
+}
+
+int UdpTransport8080(Transport8080 *t, int local_port, const char *host, int port)
+{
+  struct sockaddr_in local, remote;
+  struct addrinfo hints, *ai;
+  int fd;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  if(getaddrinfo(host, NULL, &hints, &ai) != 0)
+    return EMU_ERR_IO;
+  remote = *(struct sockaddr_in *)ai->ai_addr;
+  remote.sin_port = htons(port);
+  freeaddrinfo(ai);
+
+  if((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+    return EMU_ERR_IO;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  local.sin_port = htons(local_port);
+  if(bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0 ||
+     connect(fd, (struct sockaddr *)&remote, sizeof(remote)) < 0 ||
+     fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0)
+  {
+    close(fd);
+    return EMU_ERR_IO;
+  }
+  t->send = UdpSend;
+  t->recv = UdpRecv;
+  t->close = UdpClose;
+  t->impl = (void *)(intptr_t)fd;
+  return EMU_OK;
+}
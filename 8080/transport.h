@@ -0,0 +1,44 @@
+#ifndef EMULATE_TRANSPORT_H
+#define EMULATE_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "8080.h"
+
+// Unreliable datagram transport for netplay.h.  Packets may be lost,
+// duplicated or reordered; the session copes.  Neither call blocks.
+typedef struct Transport8080 Transport8080;
+struct Transport8080 {
+  // Returns EMU_OK or EMU_ERR_IO.  A dropped packet is still EMU_OK.
+  int (*send)(Transport8080 *t, const void *buf, size_t n);
+  // Returns the size of the next packet copied into buf (truncated to
+  // size), 0 if none is waiting, or -1 on error.
+  int (*recv)(Transport8080 *t, void *buf, size_t size);
+  void (*close)(Transport8080 *t);
+  void *impl;
+};
+
+#define TRANSPORT_MTU  512
+
+// Two connected in-process endpoints for tests on one machine.  Each
+// packet is delivered latency_ms after it was sent, give or take
+// jitter_ms, and dropped with probability loss (0..1).  Delivery order
+// follows delivery time, so jitter reorders packets.  Both ends may be
+// used from different threads.  Close both.  Returns EMU_OK or
+// EMU_ERR_NOMEM.
+int LoopbackPair8080(Transport8080 *a, Transport8080 *b,
+    int latency_ms, int jitter_ms, double loss, uint32_t seed);
+
+// UDP socket bound to local_port and talking to host:port.  Returns
+// EMU_OK or EMU_ERR_IO.
+int UdpTransport8080(Transport8080 *t, int local_port, const char *host, int port);
+
+static inline void CloseTransport8080(Transport8080 *t)
+{
+  if(t->close)
+    t->close(t);
+  t->close = NULL;
+}
+
+#endif
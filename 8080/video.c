@@ -0,0 +1,26 @@
+#include "video.h"
+
+void ConvertVideo8080(const State8080 *state, uint32_t *pixels, uint32_t on, uint32_t off)
+{
+  uint8_t vram[VRAM_SIZE];
+  ReadBlock8080(state, VRAM_BASE, vram, VRAM_SIZE);
+  ConvertVram8080(vram, pixels, on, off);
+}
+
+void ConvertVram8080(const uint8_t *vram, uint32_t *pixels, uint32_t on, uint32_t off)
+{
+  int x, i, bit;
+  for(x = 0; x < VIDEO_WIDTH; x++)
+  {
+    // Column x runs up the screen: byte i covers rows 255 - 8i down to
+    // 248 - 8i.
+    const uint8_t *col = &vram[x * (VIDEO_HEIGHT / 8)];
+    for(i = 0; i < VIDEO_HEIGHT / 8; i++)
+    {
+      uint32_t *p = &pixels[(VIDEO_HEIGHT - 1 - 8 * i) * VIDEO_WIDTH + x];
+      uint8_t b = col[i];
+      for(bit = 0; bit < 8; bit++, p -= VIDEO_WIDTH)
+        *p = (b >> bit & 1) ? on : off;
+    }
+  }
+}
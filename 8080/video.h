@@ -0,0 +1,19 @@
+#ifndef EMULATE_VIDEO_H
+#define EMULATE_VIDEO_H
+
+#include "8080.h"
+
+// Invaders video: VRAM is 224 columns of 256 1bpp pixels, bit 0 of the
+// first byte of a column at the bottom.  The monitor is mounted turned
+// 90 degrees, so the picture is 224 wide and 256 tall.
+#define VIDEO_WIDTH   224
+#define VIDEO_HEIGHT  256
+
+// Converts the machine's VRAM into VIDEO_WIDTH * VIDEO_HEIGHT pixels,
+// row-major from the top left, `on` for set bits and `off` for clear
+// ones.  Reads through the page table, so forked machines work.
+void ConvertVideo8080(const State8080 *state, uint32_t *pixels, uint32_t on, uint32_t off);
+// The same from a VRAM_SIZE-byte copy of VRAM.
+void ConvertVram8080(const uint8_t *vram, uint32_t *pixels, uint32_t on, uint32_t off);
+
+#endif